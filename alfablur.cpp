@@ -32,6 +32,22 @@
 #include <string.h>
 #include <assert.h>
 #include "demo.h"
+#include "trace.h"
+
+namespace {
+    // Returns the 8-bit alpha value of the pixel at (x,y) in a source
+    // image that's either 32 bits per pixel, with alpha in the top byte,
+    // or 8 bits per pixel, alpha only
+    inline COLOR GetSourceAlpha(const PIXEL_BUFFER *image, int x, int y)
+    {
+        const char *row = reinterpret_cast<const char*>(image->pixels) + y*image->pitch;
+
+        if (image->depth == 8)
+            return reinterpret_cast<const unsigned char*>(row)[x];
+
+        return reinterpret_cast<const COLOR*>(row)[x] >> 24;
+    }
+}
 
 //---------------------------------------------------------------------
 //
@@ -40,19 +56,70 @@
 // blurs only the alpha fields in the source image. The RGB fields in
 // the source image are ignored and replaced with a solid color. This
 // color can be customized if the caller prefers not to use the
-// default color, which is black with 8-bit alpha = 127. The user can
-// create a custom filter kernel by specifying the filter width
-// (always an odd integer) and standard deviation, or simply accept
-// the defaults for these parameters.
+// default color, which is black with 8-bit alpha = 127. The source
+// image can also be an 8-bit, alpha-only image (a PIXEL_BUFFER with a
+// depth of 8), in which case the blurred image is also 8-bit alpha
+// only, and the RGB fields of the color are ignored. The user can
+// create a custom filter kernel by specifying the filter
+// width (always an odd integer) and standard deviation, or simply
+// accept the defaults for these parameters. The optional 'alloc'
+// parameter specifies the allocator for the blurred image and other
+// internal buffers (see Allocator in shapegen.h).
+//
+// If only part of the blurred image will be visible -- for example, a
+// drop shadow that's partly clipped by the window -- the caller can
+// specify a region of interest, and the AlphaBlur object will then
+// blur and store only that part of the image. The region of interest
+// is specified in the source image's coordinate space, in which the
+// top-left pixel of the source image is at (0,0). Thus, the full
+// blurred image extends from -rad to width+rad-1 in x, and from -rad
+// to height+rad-1 in y, where rad = floor(kwidth/2). If the region of
+// interest lies entirely outside the blurred image, the blurred image
+// is empty (its width and height are zero), but is still valid.
+//
+// Blurs with large standard deviations are slow to calculate, but are
+// also very smooth, so they can be calculated at reduced resolution
+// with little loss of accuracy. The image is downsampled by a factor
+// of two or four, blurred with a kernel that's scaled to match, and
+// then bilinearly upsampled. The 'qthresh' parameter is the quality
+// threshold: the standard deviation of the scaled kernel, in reduced-
+// resolution pixels, must be at least this large. If the standard
+// deviation is too small to satisfy the threshold at a reduction
+// factor of two, or if qthresh <= 0, the image is blurred at full
+// resolution.
 //
 //---------------------------------------------------------------------
 
-// Public constructor
-AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage,
-                     int kwidth, float stddev, COLOR color) :
-             _kwidth(0), _stddev(0), _numpixels(0), _index(0)
+// Public constructor: Blurs the entire source image
+AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage, int kwidth, float stddev,
+                     COLOR color, Allocator *alloc, float qthresh) :
+             _kwidth(0), _stddev(0), _kcoeff(0), _qthresh(qthresh),
+             _factor(1), _numpixels(0), _index(0),
+             _alloc((alloc != 0) ? alloc : GetHeapAllocator())
+{
+    Init(srcimage, 0, kwidth, stddev, color);
+}
+
+// Public constructor: Blurs only the pixels in the region of interest
+// specified by the 'roi' parameter
+AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage, const SGRect& roi,
+                     int kwidth, float stddev, COLOR color, Allocator *alloc,
+                     float qthresh) :
+             _kwidth(0), _stddev(0), _kcoeff(0), _qthresh(qthresh),
+             _factor(1), _numpixels(0), _index(0),
+             _alloc((alloc != 0) ? alloc : GetHeapAllocator())
+{
+    Init(srcimage, &roi, kwidth, stddev, color);
+}
+
+// Private function: Initialization code common to both constructors.
+// If 'roi' is null, the entire image is blurred.
+void AlphaBlur::Init(const PIXEL_BUFFER *srcimage, const SGRect *roi,
+                     int kwidth, float stddev, COLOR color)
 {
     memset(&_blurbuf, 0, sizeof(_blurbuf));
+    memset(&_roi, 0, sizeof(_roi));
+    _fullwidth = _fullheight = 0;
     if (CreateFilterKernel(kwidth, stddev) == false)
     {
         assert(_kwidth > 0);
@@ -61,7 +128,7 @@ AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage,
     _rgba = color;
     _alpha = color >> 24;
     _rgb = color & 0x00ffffff;
-    if (BlurImage(srcimage) == false)
+    if (BlurImage(srcimage, roi) == false)
     {
         _kwidth = 0;
         assert(_kwidth);
@@ -73,8 +140,9 @@ AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage,
 
 AlphaBlur::~AlphaBlur()
 {
-    DeleteRawPixels(_blurbuf.pixels);
-    delete[] _kcoeff;
+    DeleteRawPixels(_blurbuf.pixels, _alloc);
+    if (_kcoeff != 0)
+        _alloc->Free(_kcoeff);
 }
 
 // Public function: Retrieves filter parameters and blur color.
@@ -100,9 +168,11 @@ bool AlphaBlur::GetBlurParams(int *kwidth, float *stddev, COLOR *color)
 // structure. The dimensions of the blurred image are obtained by
 // extending all four sides of the input image's bounding box outward
 // by rad = floor(kwidth/2) pixels, where kwidth is the kernel width.
-// Returns true if (1) the blurred image was successfully created and
-// (2) the width and height specified in 'bbox' match those in the
-// input image supplied to the AlphaBlur constructor.
+// If the constructor was given a region of interest, the bounding box
+// is reduced to the part of the blurred image that lies inside this
+// region. Returns true if (1) the blurred image was successfully
+// created and (2) the width and height specified in 'bbox' match
+// those in the input image supplied to the AlphaBlur constructor.
 //
 bool AlphaBlur::GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox)
 {
@@ -111,27 +181,61 @@ bool AlphaBlur::GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox)
     if (_kwidth == 0)
         return false;  // fail - blurred image not created
 
-    if ((_blurbuf.width != bbox->w + 2*rad) ||
-        (_blurbuf.height != bbox->h + 2*rad))
+    if ((_fullwidth != bbox->w + 2*rad) ||
+        (_fullheight != bbox->h + 2*rad))
     {
-        assert(_blurbuf.width == bbox->w + 2*rad);
-        assert(_blurbuf.height == bbox->h + 2*rad);
+        assert(_fullwidth == bbox->w + 2*rad);
+        assert(_fullheight == bbox->h + 2*rad);
         return false;  // fail - invalid input parameters
     }
-    blurbbox->x = bbox->x - rad;
-    blurbbox->y = bbox->y - rad;
-    blurbbox->w = bbox->w + 2*rad;
-    blurbbox->h = bbox->h + 2*rad;
+    blurbbox->x = bbox->x - rad + _roi.x;
+    blurbbox->y = bbox->y - rad + _roi.y;
+    blurbbox->w = _roi.w;
+    blurbbox->h = _roi.h;
     return true;  // success
 }
 
-// Private function: Calculates the coefficients for the Gaussian
-// filter kernel. Due to symmetry, only the coefficients on the right
-// side (and center) of the kernel need to be explicitly calculated
-// and stored in the kcoeff array. Note that this array's length is
-// 1+kwidth/2, not kwidth! The coefficients are stored as 16-bit
-// integer alpha values in the range 0 to 1.0, where 1.0 is
-// represented as 0x0000ffff. Returns true if successful.
+// Private function: Calculates the coefficients for a Gaussian filter
+// kernel of width 2*rad+1 and the specified standard deviation. Due
+// to symmetry, only the coefficients on the right side (and center)
+// of the kernel need to be explicitly calculated and stored in the
+// returned array, whose length is rad+1. The coefficients are stored
+// as 16-bit integer alpha values in the range 0 to 1.0, where 1.0 is
+// represented as 0x0000ffff. Returns null if out of memory.
+//
+COLOR* AlphaBlur::CreateKernelCoeffs(int rad, float stddev)
+{
+    float *ktemp = static_cast<float*>(_alloc->Allocate((rad+1)*sizeof(float)));
+    if (ktemp == 0)
+    {
+        assert(ktemp);
+        return 0;  // fail - out of memory
+    }
+    float denom = 2*stddev*stddev;
+    float sum = ktemp[0] = 1.0f;
+    for (int i = 1; i <= rad; ++i)
+    {
+        ktemp[i] = exp(-(i*i)/denom);
+        sum += 2*ktemp[i];
+    }
+    COLOR *kcoeff = static_cast<COLOR*>(_alloc->Allocate((rad+1)*sizeof(COLOR)));
+    if (kcoeff == 0)
+    {
+        assert(kcoeff);
+        _alloc->Free(ktemp);
+        return 0;  // fail - out of memory
+    }
+    float norm = 0x0000ffff/sum;
+    for (int i = 0; i <= rad; ++i)
+        kcoeff[i] = norm*ktemp[i];  // normalize
+
+    _alloc->Free(ktemp);
+    return kcoeff;
+}
+
+// Private function: Sets up the Gaussian filter kernel for the blur,
+// and chooses the resolution at which the blur is calculated. Returns
+// true if successful.
 //
 bool AlphaBlur::CreateFilterKernel(int kwidth, float stddev)
 {
@@ -149,55 +253,52 @@ bool AlphaBlur::CreateFilterKernel(int kwidth, float stddev)
         kwidth = 3*stddev;
     }
     kwidth |= 1;  // kernel width must be odd integer
-    int rad = kwidth/2;
-    float *ktemp = new float[rad+1];
-    if (ktemp == 0)
-    {
-        assert(ktemp);
-        return false;  // fail - out of memory
-    }
-    float denom = 2*stddev*stddev;
-    float sum = ktemp[0] = 1.0f;
-    for (int i = 1; i <= rad; ++i)
-    {
-        ktemp[i] = exp(-(i*i)/denom);
-        sum += 2*ktemp[i];
-    }
-    _kcoeff = new COLOR[rad+1];
+    _kcoeff = CreateKernelCoeffs(kwidth/2, stddev);
     if (_kcoeff == 0)
-    {
-        assert(_kcoeff);
         return false;  // fail - out of memory
-    }
-    float norm = 0x0000ffff/sum;
-    for (int i = 0; i <= rad; ++i)
-        _kcoeff[i] = norm*ktemp[i];  // normalize
 
+    // Use the largest reduction factor that satisfies the quality
+    // threshold, but only if the scaled kernel is at least 3 wide
+    _factor = 1;
+    for (int f = BLUR_MAXFACTOR; f > 1; f /= 2)
+    {
+        if (_qthresh > 0 && stddev/f >= _qthresh && kwidth/(2*f) > 0)
+        {
+            _factor = f;
+            break;
+        }
+    }
     _stddev = stddev;
     _kwidth = kwidth;
-    delete[] ktemp;
     return true;  // success
 }
 
 // Private function: Convolves a 1-D source image 'src' with a
 // Gaussian filter kernel of width 'kwidth', and writes the result to
-// destination image 'dst'. The 'src' array is of length 'len', and
-// the 'dst' array has length len+2*rad, where rad = floor(kwidth/2).
-// Kernel width 'kwidth' is always odd. This function assumes that
-// the caller previously set the 2*rad pixels on either side of the
-// 'len' pixels in the 'src' array to zero.
+// destination image 'dst'. The function calculates 'len' destination
+// pixels, and the filter for dst[i] is centered on src[i]. Kernel
+// width 'kwidth' is always odd. This function assumes that the caller
+// has set any pixels in the range src[-rad] to src[len-1+rad] that
+// lie outside the source image to zero, where rad = floor(kwidth/2).
 //
 void AlphaBlur::ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len)
 {
-    int rad = _kwidth/2;
-    const COLOR *psrc = &src[-rad], *pR, *pL;
-    COLOR *pdst = &dst[0], *pK, sum;
+    ApplyFilter(dst, src, len, _kcoeff, _kwidth/2);
+}
+
+// Private function: Same as ApplyGaussianFilter, but uses the filter
+// kernel of width 2*rad+1 whose coefficients are in the kcoeff array
+//
+void AlphaBlur::ApplyFilter(COLOR dst[], const COLOR src[], int len,
+                            const COLOR kcoeff[], int rad)
+{
+    const COLOR *psrc = &src[0], *pR, *pL, *pK;
+    COLOR *pdst = &dst[0], sum;
 
-    len += _kwidth;
     for (int i = 0; i < len; ++i)
     {
         pR = pL = psrc++;
-        pK = &_kcoeff[0];
+        pK = &kcoeff[0];
         sum = (pK[0]*pR[0]) >> 16;
         for (int j = 0; j < rad; ++j)
             sum += (*++pK * (*++pR + *--pL)) >> 16;
@@ -206,162 +307,422 @@ void AlphaBlur::ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len)
     }
 }
 
-// Private function: Uses a Gaussian filter to blur the 32-bpp input
-// image in the pixel buffer specified by input parameter 'srcimage'.
-// The function allocates an output buffer and writes the blurred
-// image to this buffer. Blurring will expand the rectangular image
-// by rad = 2*floor(kwidth/2) pixels on each of its four sides. Only
+// Private function: Uses a Gaussian filter to blur the 32-bpp (or
+// 8-bpp, alpha-only) input image in the pixel buffer specified by input parameter 'srcimage'.
+// The function allocates an output buffer of the same pixel depth and
+// writes the blurred image to this buffer. Blurring will expand the rectangular image
+// by rad = floor(kwidth/2) pixels on each of its four sides. Only
 // the alpha channel in the source image is filtered; the source RGB
 // values are ignored, and the specified fill color (in the '_color'
-// member) is used instead to color the resulting blurred image.
+// member) is used instead to color the resulting blurred image. If
+// 'roi' is not null, only the part of the blurred image inside this
+// region of interest is calculated and stored, and only the source
+// rows and columns that contribute to this part are filtered. The
+// pixels in this part are identical to the corresponding pixels in
+// the full blurred image.
 //
-bool AlphaBlur::BlurImage(const PIXEL_BUFFER *srcimage)
+bool AlphaBlur::BlurImage(const PIXEL_BUFFER *srcimage, const SGRect *roi)
 {
+    TRACE_SCOPE("AlphaBlur::BlurImage");
+
     if (srcimage->pixels == 0 || srcimage->width < 1 || srcimage->height < 1 ||
-        srcimage->pitch < srcimage->width || srcimage->depth != 32)
+        (srcimage->depth != 32 && srcimage->depth != 8) ||
+        srcimage->pitch < srcimage->width*(srcimage->depth/8))
     {
         assert(0);
         return false;  // fail - invalid input image descriptor
     }
 
-    // Allocate pixel buffer to store blurred image
+    // Clip the region of interest to the full blurred image. The _roi
+    // rectangle is in the blurred image's coordinate space, in which
+    // the top-left pixel of the source image is at (rad,rad).
     int rad = _kwidth/2;
-    _blurbuf.width = srcimage->width + 2*rad;
-    _blurbuf.height = srcimage->height + 2*rad;
-    _blurbuf.pitch = _blurbuf.width*sizeof(COLOR);
+    _fullwidth = srcimage->width + 2*rad;
+    _fullheight = srcimage->height + 2*rad;
+    _roi.x = _roi.y = 0;
+    _roi.w = _fullwidth, _roi.h = _fullheight;
+    if (roi != 0)
+    {
+        int x0 = max(roi->x + rad, 0), y0 = max(roi->y + rad, 0);
+        int x1 = min(roi->x + roi->w + rad, _fullwidth);
+        int y1 = min(roi->y + roi->h + rad, _fullheight);
+
+        _roi.x = x0, _roi.y = y0;
+        _roi.w = max(x1 - x0, 0), _roi.h = max(y1 - y0, 0);
+    }
     _blurbuf.depth = srcimage->depth;
+    if (_roi.w == 0 || _roi.h == 0)
+    {
+        // Region lies outside blurred image, so the result is empty
+        _roi.w = _roi.h = 0;
+        return true;
+    }
+
+    // Allocate pixel buffer to store blurred image, which has the same
+    // pixel depth as the source image
+    _blurbuf.width = _roi.w;
+    _blurbuf.height = _roi.h;
+    _blurbuf.pitch = _blurbuf.width*(_blurbuf.depth/8);
     _numpixels = _blurbuf.width*_blurbuf.height;
-    _blurbuf.pixels = new COLOR[_numpixels];
+    _blurbuf.pixels = static_cast<COLOR*>(_alloc->Allocate(_numpixels*(_blurbuf.depth/8)));
     if (_blurbuf.pixels == 0)
     {
         assert(_blurbuf.pixels);
         _numpixels = _blurbuf.width = _blurbuf.height = 0;
         return false;  // fail - out of memory
     }
-    COLOR *pincol = &srcimage->pixels[0];
-    COLOR *poutcol = &_blurbuf.pixels[rad];
-    int instride = srcimage->pitch/sizeof(srcimage->pixels[0]);
-    int outstride = _blurbuf.width;
+
+    // For a large blur, calculate the blur at reduced resolution
+    if (_factor > 1)
+    {
+        if (BlurReduced(srcimage))
+            return true;
+
+        _blurbuf.pixels = DeleteRawPixels(_blurbuf.pixels, _alloc);
+        _numpixels = _blurbuf.width = _blurbuf.height = 0;
+        return false;  // fail - out of memory
+    }
+
+    // Find the source columns and rows that contribute to the pixels
+    // in the region of interest. Each blurred pixel is a weighted sum
+    // of the source pixels within rad pixels of it, and the blurred
+    // pixel at (rad,rad) is centered on the source pixel at (0,0).
+    int sx0 = max(_roi.x - 2*rad, 0);
+    int sx1 = min(_roi.x + _roi.w, srcimage->width);
+    int sy0 = max(_roi.y - 2*rad, 0);
+    int sy1 = min(_roi.y + _roi.h, srcimage->height);
+
+    // Allocate an intermediate image to hold the vertically filtered
+    // source columns. Its rows are the rows in the region of interest.
+    // The filter coefficients sum to less than 1.0, so each filtered
+    // 16-bit alpha value fits in an unsigned short.
+    int midwidth = max(sx1 - sx0, 0);
+    unsigned short *midbuf = 0;
+    if (midwidth > 0 && sy0 < sy1)
+    {
+        midbuf = static_cast<unsigned short*>(
+                     _alloc->Allocate(midwidth*_roi.h*sizeof(unsigned short)));
+        if (midbuf == 0)
+        {
+            assert(midbuf);
+            _blurbuf.pixels = DeleteRawPixels(_blurbuf.pixels, _alloc);
+            _numpixels = _blurbuf.width = _blurbuf.height = 0;
+            return false;  // fail - out of memory
+        }
+    }
 
     // Allocate scratch buffer to filter columns from input image.
     int scratchwidth = srcimage->height + 4*rad;
-    COLOR *scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0));
+    COLOR *scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0), _alloc);
 
     // First, process the image in the vertical direction by
-    // convolving each column with a 1-D filter. Blurring will
-    // increase the height of each column by 2*rad pixels. Each
-    // for-loop iteration below vertically filters one column
-    // of pixels.
-    for (int i = 0; i < srcimage->width; ++i)
-    {
-        // Copy the next column of pixels from the input image to
-        // the first row of the scratch buffer. Leave margins of
-        // 2*rad pixels (set to zero) on either side of the copied
-        // pixels so we don't have to deal with boundary conditions.
-        // Only the alpha fields of the copied pixels are preserved.
-        // To improve filtering precision, each 8-bit alpha value is
-        // converted to a 16-bit alpha value.
-        COLOR *pin = pincol++;
-        COLOR *pdst = &scratch[2*rad];
-        for (int j = 0; j < srcimage->height; ++j)
+    // convolving each contributing column with a 1-D filter. Each
+    // for-loop iteration below vertically filters one column of
+    // pixels, but only for the rows in the region of interest.
+    for (int i = sx0; midbuf != 0 && i < sx1; ++i)
+    {
+        // Copy the contributing pixels in the next column of the input
+        // image to the first row of the scratch buffer, in which the
+        // source pixel in row 0 is at offset 2*rad. The other pixels in
+        // the scratch buffer stay zero, so we don't have to deal with
+        // boundary conditions. Only the alpha fields of the copied
+        // pixels are preserved. To improve filtering precision, each
+        // 8-bit alpha value is converted to a 16-bit alpha value.
+        COLOR *pdst = &scratch[2*rad + sy0];
+        for (int j = sy0; j < sy1; ++j)
         {
-            COLOR alpha = *pin >> 24;
+            COLOR alpha = GetSourceAlpha(srcimage, i, j);
             *pdst++ = alpha | (alpha << 8);
-            pin = &pin[instride];
         }
 
         // Convolve the input pixels in the scratch buffer's first
         // row with the 1-D Gaussian filter. Write the blurred result
-        // to the second row of the scratch buffer.
-        COLOR *psrc = &scratch[2*rad];
-        pdst = &scratch[rad + scratchwidth];
-        ApplyGaussianFilter(pdst, psrc, srcimage->height);
+        // to the second row of the scratch buffer. The filter for
+        // blurred row y is centered on source row y - rad.
+        COLOR *psrc = &scratch[rad + _roi.y];
+        pdst = &scratch[scratchwidth];
+        ApplyGaussianFilter(pdst, psrc, _roi.h);
         psrc = pdst;
 
         // Copy the blurred pixels from the second row of the scratch
-        // buffer to the next column of the blurred image buffer
-        COLOR *pout = poutcol++;
-        for (int j = 0; j < _blurbuf.height; ++j)
-            *pout = *psrc++, pout = &pout[outstride];
+        // buffer to the next column of the intermediate image
+        unsigned short *pout = &midbuf[i - sx0];
+        for (int j = 0; j < _roi.h; ++j)
+            *pout = *psrc++, pout = &pout[midwidth];
     }
-    DeleteRawPixels(scratch);
+    DeleteRawPixels(scratch, _alloc);
 
-    // So far, vertical filtering has increased the height of the
-    // image by 2*rad. Next, this intermediate image will be filtered
-    // horizontally, which will increase the image width by 2*rad.
-    COLOR *pinrow = &_blurbuf.pixels[rad];
-    COLOR *poutrow = &_blurbuf.pixels[0];
+    // Next, the intermediate image will be filtered horizontally
+    const unsigned short *pinrow = midbuf;
 
     // Allocate scratch buffer to filter rows from intermediate image
     scratchwidth = srcimage->width + 4*rad;
-    scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0));
+    scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0), _alloc);
 
     // To construct the final output image, each for-loop iteration
     // below horizontally filters one row from the intermediate image
     for (int j = 0; j < _blurbuf.height; ++j)
     {
-        // Copy the next row of pixels from the intermediate image
-        // to the first row of the scratch buffer, and leave
-        // margins of 2*rad pixels (set to zero) on either side.
-        COLOR *pin = pinrow;
-        COLOR *pdst = &scratch[2*rad];
-        pinrow = &pinrow[outstride];
-        for (int i = 0; i < srcimage->width; ++i)
-            *pdst++ = *pin++;
+        // Copy the next row of pixels from the intermediate image to
+        // the first row of the scratch buffer, in which source column
+        // 0 is at offset 2*rad. The other pixels stay zero.
+        if (midbuf != 0)
+        {
+            const unsigned short *pin = pinrow;
+            COLOR *pdst = &scratch[2*rad + sx0];
+            pinrow = &pinrow[midwidth];
+            for (int i = sx0; i < sx1; ++i)
+                *pdst++ = *pin++;
+        }
 
         // Convolve input pixels with Gaussian filter. The blurred
         // result resides in the second row of the scratch buffer.
-        COLOR *psrc = &scratch[2*rad];
-        pdst = &scratch[rad + scratchwidth];
-        ApplyGaussianFilter(pdst, psrc, srcimage->width);
+        COLOR *psrc = &scratch[rad + _roi.x];
+        COLOR *pdst = &scratch[scratchwidth];
+        ApplyGaussianFilter(pdst, psrc, _blurbuf.width);
         psrc = pdst;
 
         // Combine the 16-bit alpha values from the current row of the
         // blurred image with the 8-bit alpha field in the fill color
-        COLOR *pout = poutrow;
-        poutrow = &poutrow[outstride];
-        if (_alpha == 255)
+        WriteRow(j, psrc);
+    }
+    DeleteRawPixels(scratch, _alloc);
+    if (midbuf != 0)
+        _alloc->Free(midbuf);
+
+    return true;
+}
+
+// Private function: Writes row 'j' of the blurred image from the
+// 16-bit alpha values in the 'ablur' array. A 32-bit blurred image is
+// colorized with the fill color. An 8-bit blurred image receives only
+// the blurred alphas scaled by the fill color's alpha.
+//
+void AlphaBlur::WriteRow(int j, const COLOR ablur[])
+{
+    char *row = reinterpret_cast<char*>(_blurbuf.pixels) + j*_blurbuf.pitch;
+
+    if (_blurbuf.depth == 32)
+    {
+        ColorizeRow(reinterpret_cast<COLOR*>(row), ablur, _blurbuf.width);
+        return;
+    }
+
+    unsigned char *pout = reinterpret_cast<unsigned char*>(row);
+    for (int i = 0; i < _blurbuf.width; ++i)
+    {
+        COLOR alpha = ablur[i] >> 8;
+
+        // Same alpha as ColorizeRow would produce for this pixel
+        if (_alpha != 255 && alpha != 0)
+            alpha = (alpha == 255) ? _alpha : (_alpha*ablur[i] + 0x00008000) >> 16;
+
+        pout[i] = alpha;
+    }
+}
+
+// Private function: Combines the 16-bit alpha values in the 'ablur'
+// array with the 8-bit alpha field in the fill color, and writes the
+// resulting 'len' pixels to the 'dst' array
+//
+void AlphaBlur::ColorizeRow(COLOR dst[], const COLOR ablur[], int len)
+{
+    const COLOR *psrc = &ablur[0];
+    COLOR *pout = &dst[0];
+
+    if (_alpha == 255)
+    {
+        // The fill color is fully opaque, so just truncate the
+        // 16-bit alpha to 8 bits and plug it into the fill color
+        for (int i = 0; i < len; ++i)
         {
-            // The fill color is fully opaque, so just truncate the
-            // 16-bit alpha to 8 bits and plug it into the fill color
-            for (int i = 0; i < _blurbuf.width; ++i)
-            {
-                COLOR ablur = *psrc++ >> 8;
-                *pout++ = (ablur << 24) | _rgb;
-            }
+            COLOR ablur = *psrc++ >> 8;
+            *pout++ = (ablur << 24) | _rgb;
         }
-        else
+    }
+    else
+    {
+        for (int i = 0; i < len; ++i)
         {
-            for (int i = 0; i < _blurbuf.width; ++i)
+            COLOR ablur16 = *psrc++;
+            COLOR ablur8 = ablur16 >> 8;
+            if (ablur8 == 0)
+            {
+                *pout++ = 0;
+            }
+            else if (ablur8 == 255)
+            {
+                *pout++ = _rgba;
+            }
+            else
             {
-                COLOR ablur16 = *psrc++;
-                COLOR ablur8 = ablur16 >> 8;
-                if (ablur8 == 0)
-                {
-                    *pout++ = 0;
-                }
-                else if (ablur8 == 255)
-                {
-                    *pout++ = _rgba;
-                }
-                else
-                {
-                    // Multiply the 8-bit alpha from the fill color
-                    // by the 16-bit alpha from the blurred image
-                    int alpha = _alpha*ablur16;
-                    alpha += 0x00008000;
-                    alpha >>= 16;
-                    *pout++ = (alpha << 24) | _rgb;
-                }
+                // Multiply the 8-bit alpha from the fill color
+                // by the 16-bit alpha from the blurred image
+                int alpha = _alpha*ablur16;
+                alpha += 0x00008000;
+                alpha >>= 16;
+                *pout++ = (alpha << 24) | _rgb;
             }
         }
     }
-    DeleteRawPixels(scratch);
-    return true;
+}
+
+// Private function: Calculates the pixels in the region of interest
+// at reduced resolution. The alpha values in the source image are
+// box-averaged over blocks of f-by-f pixels, where f = _factor, and
+// the resulting low-resolution image is blurred with a kernel whose
+// width and standard deviation are scaled down by f. The pixels in
+// the region of interest are then bilinearly interpolated from the
+// blurred low-resolution image. The caller has already allocated the
+// _blurbuf pixel buffer. Returns true if successful.
+//
+bool AlphaBlur::BlurReduced(const PIXEL_BUFFER *srcimage)
+{
+    const int MARGIN = 4;  // zero padding for interpolation
+    int f = _factor, fshift = (f == 2) ? 1 : 2;
+    int rad = _kwidth/2;
+    int lrad = rad/f;  // radius of scaled kernel
+    int lw = (srcimage->width + f - 1)/f;  // low-res image width
+    int lh = (srcimage->height + f - 1)/f;  // low-res image height
+    int bw = lw + 2*lrad, bh = lh + 2*lrad;  // blurred low-res image
+
+    assert(f == 2 || f == 4);
+    assert(lrad > 0);
+    COLOR *lkcoeff = CreateKernelCoeffs(lrad, _stddev/f);
+    COLOR *lowbuf = AllocateRawPixels(lw, bh, RGBA(0,0,0,0), _alloc);
+    COLOR *blurbuf = AllocateRawPixels(bw + 2*MARGIN, bh, RGBA(0,0,0,0), _alloc);
+    int scratchwidth = max(lw, lh) + 4*lrad;
+    COLOR *scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0), _alloc);
+    COLOR *rowbuf = AllocateRawPixels(max(bw + 2*MARGIN, _blurbuf.width), 2,
+                                      RGBA(0,0,0,0), _alloc);
+    if (lkcoeff == 0 || lowbuf == 0 || blurbuf == 0 || scratch == 0 || rowbuf == 0)
+    {
+        assert(lkcoeff != 0 && lowbuf != 0 && blurbuf != 0);
+        assert(scratch != 0 && rowbuf != 0);
+        if (lkcoeff != 0)
+            _alloc->Free(lkcoeff);
+        DeleteRawPixels(lowbuf, _alloc);
+        DeleteRawPixels(blurbuf, _alloc);
+        DeleteRawPixels(scratch, _alloc);
+        DeleteRawPixels(rowbuf, _alloc);
+        return false;  // fail - out of memory
+    }
+
+    // Downsample the source alphas into the top lh rows of lowbuf.
+    // Each low-res pixel is the average of an f-by-f block of 16-bit
+    // alphas. Blocks at the right and bottom edges are padded with
+    // zeros.
+    for (int j = 0; j < srcimage->height; ++j)
+    {
+        COLOR *prow = &lowbuf[(j >> fshift)*lw];
+
+        for (int i = 0; i < srcimage->width; ++i)
+        {
+            COLOR alpha = GetSourceAlpha(srcimage, i, j);
+            prow[i >> fshift] += alpha | (alpha << 8);
+        }
+    }
+    for (int i = 0; i < lw*lh; ++i)
+        lowbuf[i] >>= 2*fshift;
+
+    // Filter the low-res image vertically, column by column. The
+    // blurred columns, which are bh pixels tall, replace the original
+    // columns in lowbuf.
+    for (int i = 0; i < lw; ++i)
+    {
+        COLOR *pin = &lowbuf[i];
+        COLOR *pdst = &scratch[2*lrad];
+        for (int j = 0; j < lh; ++j)
+            *pdst++ = *pin, pin = &pin[lw];
+
+        pdst = &scratch[scratchwidth];
+        ApplyFilter(pdst, &scratch[lrad], bh, lkcoeff, lrad);
+        pin = &lowbuf[i];
+        for (int j = 0; j < bh; ++j)
+            *pin = *pdst++, pin = &pin[lw];
+    }
+
+    // Filter the low-res image horizontally, row by row. Each row of
+    // blurbuf has MARGIN pixels of zero padding on either side.
+    memset(scratch, 0, scratchwidth*sizeof(COLOR));
+    for (int j = 0; j < bh; ++j)
+    {
+        memcpy(&scratch[2*lrad], &lowbuf[j*lw], lw*sizeof(COLOR));
+        ApplyFilter(&blurbuf[j*(bw + 2*MARGIN) + MARGIN], &scratch[lrad],
+                    bw, lkcoeff, lrad);
+    }
+
+    // For each column x in the region of interest, find the blurred
+    // low-res pixel to its left, and the 8-bit interpolation weight.
+    // Full-res blurred pixel x is centered on source column x - rad,
+    // and low-res blurred pixel u is centered on source column
+    // (u - lrad)*f + (f-1)/2. The calculations are biased by two
+    // low-res pixels to avoid dividing negative numbers.
+    int *xindex = reinterpret_cast<int*>(&rowbuf[0]);
+    COLOR *xweight = &rowbuf[_blurbuf.width];
+    assert(sizeof(int) == sizeof(COLOR));
+    for (int i = 0; i < _blurbuf.width; ++i)
+    {
+        int x = _roi.x + i - rad;
+        int t = ((2*x - (f - 1) + 2*f*(lrad + 2)) << 8) >> (fshift + 1);
+
+        xindex[i] = min(max((t >> 8) - 2, -MARGIN), bw + MARGIN - 2);
+        xweight[i] = t & 255;
+    }
+
+    // Each iteration of this for-loop interpolates one row of the
+    // region of interest. First interpolate vertically between two
+    // rows of the blurred low-res image, then horizontally.
+    COLOR *lrow = &lowbuf[0];  // reuse lowbuf for interpolated row
+    COLOR *arow = &scratch[0];  // 16-bit alphas for output row
+    if (lw*bh < bw + 2*MARGIN)
+    {
+        // lowbuf is too narrow to hold a row of blurbuf
+        _alloc->Free(lowbuf);
+        lrow = lowbuf = AllocateRawPixels(bw + 2*MARGIN, 1, RGBA(0,0,0,0), _alloc);
+    }
+    if (2*scratchwidth < _blurbuf.width)
+    {
+        DeleteRawPixels(scratch, _alloc);
+        arow = scratch = AllocateRawPixels(_blurbuf.width, 1, RGBA(0,0,0,0), _alloc);
+    }
+    for (int j = 0; lrow != 0 && arow != 0 && j < _blurbuf.height; ++j)
+    {
+        int y = _roi.y + j - rad;
+        int t = ((2*y - (f - 1) + 2*f*(lrad + 2)) << 8) >> (fshift + 1);
+        int v = (t >> 8) - 2;
+        COLOR wy = t & 255;
+        const COLOR *row0 = (v < 0 || v >= bh) ? 0 : &blurbuf[v*(bw + 2*MARGIN)];
+        const COLOR *row1 = (v + 1 < 0 || v + 1 >= bh) ? 0 : &blurbuf[(v + 1)*(bw + 2*MARGIN)];
+
+        for (int i = 0; i < bw + 2*MARGIN; ++i)
+        {
+            COLOR a = (row0 != 0) ? row0[i] : 0;
+            COLOR b = (row1 != 0) ? row1[i] : 0;
+            lrow[i] = (a*(256 - wy) + b*wy + 128) >> 8;
+        }
+        for (int i = 0; i < _blurbuf.width; ++i)
+        {
+            const COLOR *p = &lrow[xindex[i] + MARGIN];
+            COLOR wx = xweight[i];
+            arow[i] = (p[0]*(256 - wx) + p[1]*wx + 128) >> 8;
+        }
+        WriteRow(j, arow);
+    }
+    bool bstatus = (lrow != 0 && arow != 0);
+    assert(bstatus);
+    _alloc->Free(lkcoeff);
+    DeleteRawPixels(lowbuf, _alloc);
+    DeleteRawPixels(blurbuf, _alloc);
+    DeleteRawPixels(scratch, _alloc);
+    DeleteRawPixels(rowbuf, _alloc);
+    return bstatus;
 }
 
 // Public function: Retrieves a description of the blurred image
-// buffer. Returns true if creation of the blurred image succeeded.
+// buffer, which is 8 bits per pixel if the source image was 8 bits
+// per pixel, and otherwise is 32 bits per pixel. Returns true if
+// creation of the blurred image succeeded.
 //
 bool AlphaBlur::GetBlurredImage(PIXEL_BUFFER *blurbuf)
 {
@@ -381,6 +742,18 @@ int AlphaBlur::ReadPixels(COLOR *buffer, int count)
     if (count > (_numpixels - _index))
         count = _numpixels - _index;
 
+    if (_blurbuf.depth == 8)
+    {
+        // Expand the 8-bit alphas with the fill color
+        const unsigned char *pa = reinterpret_cast<const unsigned char*>(_blurbuf.pixels) + _index;
+
+        for (int i = 0; i < count; ++i)
+            *buffer++ = (static_cast<COLOR>(pa[i]) << 24) | _rgb;
+
+        _index += count;
+        return count;
+    }
+
     COLOR *ptr = &_blurbuf.pixels[_index];
 
     for (int i = 0; i < count; ++i)
@@ -31,6 +31,8 @@
 #include "shapepri.h"
 
 namespace {
+    const double PI = 3.14159265358979;
+
     //-------------------------------------------------------------------
     //
     // Returns the approximate length of vector (x,y). The error in the
@@ -171,6 +173,132 @@ void PathMgr::EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
     }
 }
 
+//---------------------------------------------------------------------
+//
+// Private function: Returns true if the ellipse lies entirely inside
+// the 16.16 coordinate range; otherwise, returns false. Parameter vC
+// is the center of the ellipse, and vP and vQ are the center-relative
+// end points of a pair of conjugate diameters. All coordinates are
+// unclipped.
+//
+//---------------------------------------------------------------------
+
+bool PathMgr::IsEllipseInside(const VERTD& vC, const VERTD& vP, const VERTD& vQ)
+{
+    VERTD vmin, vmax;
+    double dx = fabs(vP.x) + fabs(vQ.x);
+    double dy = fabs(vP.y) + fabs(vQ.y);
+
+    vmin.x = vC.x - dx;
+    vmin.y = vC.y - dy;
+    vmax.x = vC.x + dx;
+    vmax.y = vC.y + dy;
+    return (IsInsideRange(vmin) && IsInsideRange(vmax));
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Clipped version of the EllipseCore function, for
+// use with an elliptic arc that extends outside the 16.16 range. The
+// parameters are unclipped, double-precision values. Parameter vC is
+// the center of the ellipse, and vP and vQ are the center-relative
+// end points of a pair of conjugate diameters. The arc starts at vP
+// (the current point) and sweeps through the angle specified by
+// parameter sweep (in radians) in the direction of vQ. As with the
+// EllipseCore function, the caller is responsible for appending the
+// end point of the arc. The function subdivides the arc until each
+// piece lies either entirely inside the 16.16 range, in which case
+// it's flattened, or entirely outside the range, in which case
+// no points are generated, and the piece is replaced by its chord.
+// Parameter level is the current subdivision level.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::ClipArc(const VERTD& vC, const VERTD& vP, const VERTD& vQ, double sweep, int level)
+{
+    VERTD vmin, vmax;
+
+    if (sweep > PI/2)
+    {
+        // Use the bounding box for the whole ellipse
+        double dx = fabs(vP.x) + fabs(vQ.x);
+        double dy = fabs(vP.y) + fabs(vQ.y);
+
+        vmin.x = vC.x - dx;
+        vmin.y = vC.y - dy;
+        vmax.x = vC.x + dx;
+        vmax.y = vC.y + dy;
+    }
+    else
+    {
+        // The arc lies inside the triangle formed by its two end
+        // points and the point where the tangents at the end points
+        // intersect. Get the bounding box for this triangle.
+        double t = tan(sweep/2);
+        double cosa = cos(sweep), sina = sin(sweep);
+        VERTD v[3];
+
+        v[0].x = vC.x + vP.x;
+        v[0].y = vC.y + vP.y;
+        v[1].x = v[0].x + t*vQ.x;
+        v[1].y = v[0].y + t*vQ.y;
+        v[2].x = vC.x + vP.x*cosa + vQ.x*sina;
+        v[2].y = vC.y + vP.y*cosa + vQ.y*sina;
+        vmin = vmax = v[0];
+        for (int i = 1; i < 3; ++i)
+        {
+            vmin.x = min(v[i].x, vmin.x);
+            vmin.y = min(v[i].y, vmin.y);
+            vmax.x = max(v[i].x, vmax.x);
+            vmax.y = max(v[i].y, vmax.y);
+        }
+    }
+    if (vmax.x <= -MAXVAL16 || MAXVAL16 <= vmin.x ||
+        vmax.y <= -MAXVAL16 || MAXVAL16 <= vmin.y)
+    {
+        return;  // arc lies entirely outside 16.16 range
+    }
+    if ((IsInsideRange(vmin) && IsInsideRange(vmax)) ||
+        level == MAXCLIPLEVELS)
+    {
+        // Arc lies inside 16.16 range. The angular increment is chosen
+        // so that the error between each chord and the arc is within
+        // the flatness tolerance.
+        double r = sqrt(vP.x*vP.x + vP.y*vP.y + vQ.x*vQ.x + vQ.y*vQ.y);
+        double da = sqrt(8.0*_flatness/r);
+        int count = ceil(sweep/da);
+
+        da = sweep/count;
+        for (int i = 1; i < count; ++i)
+        {
+            double cosa = cos(i*da);
+            double sina = sin(i*da);
+            VERTD v;
+
+            v.x = vC.x + vP.x*cosa + vQ.x*sina;
+            v.y = vC.y + vP.y*cosa + vQ.y*sina;
+            ClipLine(v);
+        }
+        return;
+    }
+
+    // Split the arc in two. Rotating the conjugate diameters through
+    // half the sweep angle gives the conjugate diameters for the
+    // second half of the arc.
+    double cosa = cos(sweep/2), sina = sin(sweep/2);
+    VERTD uP, uQ, v;
+
+    uP.x = vP.x*cosa + vQ.x*sina;
+    uP.y = vP.y*cosa + vQ.y*sina;
+    uQ.x = vQ.x*cosa - vP.x*sina;
+    uQ.y = vQ.y*cosa - vP.y*sina;
+    ClipArc(vC, vP, vQ, sweep/2, level + 1);
+    v.x = vC.x + uP.x;
+    v.y = vC.y + uP.y;
+    ClipLine(v);
+    ClipArc(vC, uP, uQ, sweep/2, level + 1);
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Adds a rotated ellipse to the current path. The
@@ -188,6 +316,28 @@ void PathMgr::EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
 
 void PathMgr::Ellipse(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2)
 {
+    double scale = 1 << _fixshift;
+    VERTD uC, uP, uQ;
+
+    uC.x = scale*v0.x;
+    uC.y = scale*v0.y;
+    uP.x = scale*v1.x - uC.x;
+    uP.y = scale*v1.y - uC.y;
+    uQ.x = scale*v2.x - uC.x;
+    uQ.y = scale*v2.y - uC.y;
+    if (!IsEllipseInside(uC, uP, uQ))
+    {
+        // Ellipse extends outside 16.16 range
+        EndFigure();
+        _upoint.x = uC.x + uP.x;
+        _upoint.y = uC.y + uP.y;
+        _cpoint = _fpoint;
+        ClipPoint(_cpoint, _upoint);
+        ClipArc(uC, uP, uQ, 2*PI, 0);
+        CloseFigure();
+        return;
+    }
+
     FIX16 xC = v0.x << _fixshift;
     FIX16 yC = v0.y << _fixshift;
     FIX16 xP = (v1.x - v0.x) << _fixshift;
@@ -233,6 +383,46 @@ void PathMgr::EllipticArc(const SGPoint& v0, const SGPoint& v1, const SGPoint& v
     FIX16 yQ = (v2.y - v0.y) << _fixshift;
     float cosb, sinb;
     FIX16 swangle;
+    double scale = 1 << _fixshift;
+    VERTD uC, uP, uQ;
+
+    uC.x = scale*v0.x;
+    uC.y = scale*v0.y;
+    uP.x = scale*v1.x - uC.x;
+    uP.y = scale*v1.y - uC.y;
+    uQ.x = scale*v2.x - uC.x;
+    uQ.y = scale*v2.y - uC.y;
+    if (!IsEllipseInside(uC, uP, uQ) ||
+        (_cpoint != 0 && !IsInsideRange(_upoint)))
+    {
+        // Elliptic arc extends outside 16.16 range. Rotate points P and
+        // Q by angle astart, and make the sweep angle positive.
+        double cosa = cos(astart), sina = sin(astart);
+        double sign = (asweep < 0) ? -1 : 1;
+        VERTD u = uP, v;
+
+        uP.x = u.x*cosa + uQ.x*sina;
+        uP.y = u.y*cosa + uQ.y*sina;
+        uQ.x = sign*(uQ.x*cosa - u.x*sina);
+        uQ.y = sign*(uQ.y*cosa - u.y*sina);
+        asweep = sign*asweep;
+        v.x = uC.x + uP.x;
+        v.y = uC.y + uP.y;
+        if (_cpoint == 0)
+        {
+            _upoint = _ufirst = v;
+            _cpoint = _fpoint;
+            ClipPoint(_cpoint, _upoint);
+        }
+        else
+            ClipLine(v);
+
+        ClipArc(uC, uP, uQ, asweep, 0);
+        v.x = uC.x + uP.x*cos(asweep) + uQ.x*sin(asweep);
+        v.y = uC.y + uP.y*cos(asweep) + uQ.y*sin(asweep);
+        ClipLine(v);
+        return;
+    }
 
     if (astart != 0)
     {
@@ -261,7 +451,11 @@ void PathMgr::EllipticArc(const SGPoint& v0, const SGPoint& v1, const SGPoint& v
     // Set the current point to the arc starting point, and call the
     // EllipseCore function to add the points in the arc to the path.
     if (_cpoint == 0)
+    {
         _cpoint = _fpoint;
+        _ufirst.x = xC + xP;
+        _ufirst.y = yC + yP;
+    }
     else
         PathCheck(++_cpoint);
 
@@ -277,6 +471,8 @@ void PathMgr::EllipticArc(const SGPoint& v0, const SGPoint& v1, const SGPoint& v
     PathCheck(++_cpoint);
     _cpoint->x = xC + xP;
     _cpoint->y = yC + yP;
+    _upoint.x = _cpoint->x;
+    _upoint.y = _cpoint->y;
 }
 
 //----------------------------------------------------------------------
@@ -298,6 +494,25 @@ bool PathMgr::EllipticSpline(const SGPoint& v1, const SGPoint& v2)
         return false;
     }
 
+    double scale = 1 << _fixshift;
+    VERTD uC, uP, uQ, v;
+
+    v.x = scale*v2.x;
+    v.y = scale*v2.y;
+    uC.x = _upoint.x + v.x - scale*v1.x;
+    uC.y = _upoint.y + v.y - scale*v1.y;
+    uP.x = _upoint.x - uC.x;
+    uP.y = _upoint.y - uC.y;
+    uQ.x = v.x - uC.x;
+    uQ.y = v.y - uC.y;
+    if (!IsEllipseInside(uC, uP, uQ))
+    {
+        // Spline extends outside 16.16 range
+        ClipArc(uC, uP, uQ, PI/2, 0);
+        ClipLine(v);
+        return true;
+    }
+
     FIX16 xP = _cpoint->x;
     FIX16 yP = _cpoint->y;
     FIX16 xQ = v2.x << _fixshift;
@@ -309,6 +524,7 @@ bool PathMgr::EllipticSpline(const SGPoint& v1, const SGPoint& v2)
     PathCheck(++_cpoint);
     _cpoint->x = xQ;
     _cpoint->y = yQ;
+    _upoint = v;
     return true;
 }
 
@@ -365,6 +581,55 @@ void PathMgr::RoundedRectangle(const SGRect& rect, const SGPoint& round)
         return;
     }
 
+    double scale = 1 << _fixshift;
+    VERTD umin, umax;
+
+    umin.x = scale*rect.x;
+    umin.y = scale*rect.y;
+    umax.x = umin.x + scale*rect.w;
+    umax.y = umin.y + scale*rect.h;
+    if (!IsInsideRange(umin) || !IsInsideRange(umax))
+    {
+        // Rectangle extends outside 16.16 range, so construct each
+        // of the four rounded corners separately. The P point for
+        // each corner is the Q point for the preceding corner.
+        double xr = scale*round.x, yr = scale*round.y;
+        VERTD uC[4], uP[4+1];
+
+        uC[0].x = umin.x + xr;  uC[0].y = umin.y + yr;  // top left
+        uC[1].x = umax.x - xr;  uC[1].y = umin.y + yr;  // top right
+        uC[2].x = umax.x - xr;  uC[2].y = umax.y - yr;  // bottom right
+        uC[3].x = umin.x + xr;  uC[3].y = umax.y - yr;  // bottom left
+        uP[0].x = -xr;  uP[0].y = 0;
+        uP[1].x = 0;    uP[1].y = -yr;
+        uP[2].x = xr;   uP[2].y = 0;
+        uP[3].x = 0;    uP[3].y = yr;
+        uP[4] = uP[0];
+        EndFigure();
+        for (int i = 0; i < 4; ++i)
+        {
+            VERTD v;
+
+            v.x = uC[i].x + uP[i].x;
+            v.y = uC[i].y + uP[i].y;
+            if (i == 0)
+            {
+                _upoint = v;
+                _cpoint = _fpoint;
+                ClipPoint(_cpoint, _upoint);
+            }
+            else
+                ClipLine(v);
+
+            ClipArc(uC[i], uP[i], uP[i+1], PI/2, 0);
+            v.x = uC[i].x + uP[i+1].x;
+            v.y = uC[i].y + uP[i+1].y;
+            ClipLine(v);
+        }
+        CloseFigure();
+        return;
+    }
+
     // Convert input parameters to internal fixed-point format
     FIX16 xmin = rect.x << _fixshift;
     FIX16 ymin = rect.y << _fixshift;
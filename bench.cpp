@@ -0,0 +1,1213 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+//  bench.cpp:
+//    Kernel-level micro-benchmarks for ShapeGen and the enhanced
+//    renderer. Each benchmark times one hot kernel in isolation on
+//    synthetic input data, over a range of input sizes, and prints
+//    the average time per run and per item. The program draws only to
+//    offscreen pixel buffers, so it needs no graphics display and no
+//    platform-specific code. Usage:  bench [seconds-per-measurement]
+//
+//    The command  bench -scale [seed]  instead runs scaling studies on
+//    synthetic stress scenes (see stress.cpp) of increasing size, and
+//    reports the time and peak memory used for each scene size.
+//
+//    Kernels that are private to ShapeGen or the renderer are timed
+//    through the public interfaces that exercise them. For example,
+//    NormalizeEdges is timed by filling paths with a renderer that
+//    discards the finished shapes, and the shape feeder is timed by a
+//    renderer that only drains the feeder of subpixel spans.
+//
+//---------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include "demo.h"
+
+namespace {
+    // Size of offscreen pixel buffers
+    const int BUFFER_WIDTH = 1024;
+    const int BUFFER_HEIGHT = 1024;
+
+    // Default minimum time (in seconds) spent on each measurement
+    const double MEASURE_TIME_DEFAULT = 0.25;
+
+    double _measuretime = MEASURE_TIME_DEFAULT;
+
+    //-------------------------------------------------------------------
+    //
+    // A Kernel object runs one hot kernel on a fixed set of synthetic
+    // inputs. The Run function is called repeatedly to time the kernel.
+    //
+    //-------------------------------------------------------------------
+
+    class Kernel
+    {
+    public:
+        virtual ~Kernel() {}
+        virtual void Run() = 0;
+    };
+
+    // Returns the average time, in microseconds, of one Run call. The
+    // first call is an untimed warm-up call.
+    double TimeKernel(Kernel *kernel)
+    {
+        clock_t limit = (clock_t)(_measuretime*CLOCKS_PER_SEC);
+        clock_t start, elapsed;
+        int count = 0;
+
+        kernel->Run();
+        start = clock();
+        do
+        {
+            kernel->Run();
+            ++count;
+            elapsed = clock() - start;
+        } while (elapsed < limit);
+
+        return 1.0e6*elapsed/CLOCKS_PER_SEC/count;
+    }
+
+    // Times a kernel and prints one line of results. Parameter 'size'
+    // is the number of items (vertices, pixels, and so on) that each
+    // Run call processes, and 'units' names the item type.
+    void Measure(const char *name, Kernel *kernel, int size, const char *units)
+    {
+        double usec = TimeKernel(kernel);
+
+        printf("%-36s %9d %-8s %12.2f us %10.2f ns/item\n",
+               name, size, units, usec, 1000*usec/size);
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // A CountingAllocator object supplies memory to ShapeGen and the
+    // renderer, and keeps track of the current and peak number of bytes
+    // in use. Each block is preceded by a header that records its size.
+    //
+    //-------------------------------------------------------------------
+
+    class CountingAllocator : public Allocator
+    {
+        union HEADER {
+            size_t size;
+            double align;  // keep blocks suitably aligned
+        };
+
+    public:
+        size_t _current;  // bytes currently allocated
+        size_t _peak;     // peak bytes allocated since last reset
+
+        CountingAllocator() : _current(0), _peak(0) {}
+        void* Allocate(size_t size)
+        {
+            HEADER *hdr = reinterpret_cast<HEADER*>(new char[sizeof(HEADER) + size]);
+
+            hdr->size = size;
+            _current += size;
+            _peak = max(_peak, _current);
+            return hdr + 1;
+        }
+        void Free(void *block)
+        {
+            if (block == 0)
+                return;
+
+            HEADER *hdr = static_cast<HEADER*>(block) - 1;
+
+            _current -= hdr->size;
+            delete[] reinterpret_cast<char*>(hdr);
+        }
+        void ResetPeak() { _peak = _current; }
+    };
+
+    //-------------------------------------------------------------------
+    //
+    // Renderers used to isolate the ShapeGen kernels. A NullRenderer
+    // discards each shape without reading its spans, so a fill or
+    // stroke costs only path construction, edge setup, clipping, and
+    // edge normalization. A SpanDrain renderer reads every subpixel
+    // span from the shape feeder, but draws nothing.
+    //
+    //-------------------------------------------------------------------
+
+    class NullRenderer : public Renderer
+    {
+    public:
+        void RenderShape(ShapeFeeder *feeder) {}
+        int QueryYResolution() { return 2; }  // same as AA renderer
+    };
+
+    class SpanDrain : public Renderer
+    {
+    public:
+        int _count;  // number of spans read from feeder
+
+        SpanDrain() : _count(0) {}
+        void RenderShape(ShapeFeeder *feeder)
+        {
+            SGSpan span;
+
+            while (feeder->GetNextSGSpan(&span))
+                ++_count;
+        }
+        int QueryYResolution() { return 2; }
+    };
+
+    //-------------------------------------------------------------------
+    //
+    // Synthetic path generators. Coordinates are 16.16 fixed-point.
+    //
+    //-------------------------------------------------------------------
+
+    enum POLYTYPE {
+        POLY_CONVEX,   // regular polygon
+        POLY_STAR,     // star polygon whose edges cross near the center
+        POLY_RANDOM,   // random vertices with many self-intersections
+        POLY_COMB,     // n/4 long, parallel, slanted teeth of staggered lengths
+    };
+
+    const char *polyname[] = { "convex", "star", "self-intersecting", "comb" };
+
+    // Fills array xy with the n vertices of a polygon of the specified
+    // type, centered in the pixel buffer. For a comb, n is a multiple
+    // of 4, and the teeth hang from a line near the top of the buffer.
+    void MakePolygon(SGPoint xy[], int n, POLYTYPE type)
+    {
+        const double cx = BUFFER_WIDTH/2, cy = BUFFER_HEIGHT/2;
+        const double r = 0.45*min(BUFFER_WIDTH, BUFFER_HEIGHT);
+        const double pitch = 0.7*BUFFER_WIDTH/(n/4);
+        int step = (type == POLY_STAR) ? n/2 - 1 : 1;
+
+        srand(n);
+        for (int i = 0; i < n; ++i)
+        {
+            double x, y;
+
+            if (type == POLY_COMB)
+            {
+                int tooth = i/4, corner = i % 4;
+                double ytip = 0.5 + 0.4*((37*tooth) % (n/4))/(n/4);
+
+                x = 0.05*BUFFER_WIDTH + tooth*pitch;
+                x += (corner == 1 || corner == 2) ? 0.2*BUFFER_WIDTH : 0;
+                x += (corner == 2 || corner == 3) ? pitch/2 : 0;
+                y = BUFFER_HEIGHT*((corner == 1 || corner == 2) ? ytip : 0.05);
+            }
+            else if (type == POLY_RANDOM)
+            {
+                x = cx + r*(2.0*rand()/RAND_MAX - 1);
+                y = cy + r*(2.0*rand()/RAND_MAX - 1);
+            }
+            else
+            {
+                double a = 2*PI*((i*step) % n)/n;
+
+                x = cx + r*cos(a);
+                y = cy + r*sin(a);
+            }
+            xy[i].x = (SGCoord)(65536*x);
+            xy[i].y = (SGCoord)(65536*y);
+        }
+    }
+
+    // Fills array xy with the n vertices of a zigzag polyline
+    void MakeZigzag(SGPoint xy[], int n)
+    {
+        double dx = 0.9*BUFFER_WIDTH/n;
+
+        for (int i = 0; i < n; ++i)
+        {
+            xy[i].x = (SGCoord)(65536*(0.05*BUFFER_WIDTH + i*dx));
+            xy[i].y = (SGCoord)(65536*((i & 1) ? 0.3 : 0.7)*BUFFER_HEIGHT);
+        }
+    }
+
+    // Adds a polygon or polyline to the current path
+    void AddPolygon(ShapeGen *sg, const SGPoint xy[], int n, bool bclose)
+    {
+        sg->BeginPath();
+        sg->Move(xy[0].x, xy[0].y);
+        sg->PolyLine(&xy[1], n - 1);
+        if (bclose)
+            sg->CloseFigure();
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Kernels
+    //
+    //-------------------------------------------------------------------
+
+    // Fills a polygon. Times edge setup and NormalizeEdges (with a
+    // NullRenderer), ClipEdges (if a clipping region is set), the
+    // shape feeder (with a SpanDrain renderer), or the full antialiased
+    // fill (with an EnhancedRenderer).
+    class FillKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        const SGPoint *_xy;
+        int _n;
+
+    public:
+        FillKernel(ShapeGen *sg, const SGPoint xy[], int n) :
+            _sg(sg), _xy(xy), _n(n)
+        {
+        }
+        void Run()
+        {
+            AddPolygon(_sg, _xy, _n, true);
+            _sg->FillPath();
+        }
+    };
+
+    // Strokes a polyline with the current line attributes
+    class StrokeKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        const SGPoint *_xy;
+        int _n;
+
+    public:
+        StrokeKernel(ShapeGen *sg, const SGPoint xy[], int n) :
+            _sg(sg), _xy(xy), _n(n)
+        {
+        }
+        void Run()
+        {
+            AddPolygon(_sg, _xy, _n, false);
+            _sg->StrokePath();
+        }
+    };
+
+    // Adds a series of cubic Bezier curves to a path (no fill)
+    class Bezier3Kernel : public Kernel
+    {
+        ShapeGen *_sg;
+        const SGPoint *_xy;
+        int _n;  // number of points (3 per curve)
+
+    public:
+        Bezier3Kernel(ShapeGen *sg, const SGPoint xy[], int n) :
+            _sg(sg), _xy(xy), _n(n)
+        {
+        }
+        void Run()
+        {
+            _sg->BeginPath();
+            _sg->Move(_xy[0].x, _xy[0].y);
+            _sg->PolyBezier3(&_xy[1], _n);
+        }
+    };
+
+    // Adds a series of ellipses to a path (no fill)
+    class EllipseKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        int _radius, _count;
+
+    public:
+        EllipseKernel(ShapeGen *sg, int radius, int count) :
+            _sg(sg), _radius(radius), _count(count)
+        {
+        }
+        void Run()
+        {
+            SGPoint v0 = { BUFFER_WIDTH << 15, BUFFER_HEIGHT << 15 };
+            SGPoint v1 = { v0.x + (_radius << 16), v0.y };
+            SGPoint v2 = { v0.x, v0.y + (_radius << 16) };
+
+            _sg->BeginPath();
+            for (int i = 0; i < _count; ++i)
+                _sg->Ellipse(v0, v1, v2);
+        }
+    };
+
+    // Fills a rectangle using the renderer's current paint and blend
+    // operation. Times FillSubpixelSpan, RenderAbuffer, and blending.
+    class RectKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        SGRect _rect;
+
+    public:
+        RectKernel(ShapeGen *sg, int w, int h) : _sg(sg)
+        {
+            _rect.x = (1 << 15), _rect.y = (1 << 15);  // not pixel-aligned
+            _rect.w = w << 16, _rect.h = h << 16;
+        }
+        void Run()
+        {
+            _sg->BeginPath();
+            _sg->Rectangle(_rect);
+            _sg->FillPath();
+        }
+    };
+
+    // Calls a paint generator's FillSpan function for 'rows' spans of
+    // length 'len', with and without per-pixel alpha input
+    class PaintKernel : public Kernel
+    {
+        PaintGen *_paintgen;
+        COLOR *_outbuf, *_alpha;
+        int _len, _rows;
+
+    public:
+        PaintKernel(PaintGen *paintgen, int len, int rows, bool balpha) :
+            _paintgen(paintgen), _len(len), _rows(rows), _alpha(0)
+        {
+            _outbuf = new COLOR[len];
+            if (balpha)
+            {
+                _alpha = new COLOR[len];
+                for (int i = 0; i < len; ++i)
+                    _alpha[i] = i & 255;  // opacity 0 to 255
+            }
+        }
+        ~PaintKernel()
+        {
+            delete[] _outbuf;
+            delete[] _alpha;
+        }
+        void Run()
+        {
+            for (int y = 0; y < _rows; ++y)
+                _paintgen->FillSpan(0, y, _len, _outbuf, _alpha);
+        }
+    };
+
+    // Blurs the alpha channel of an image, or of only the part of the
+    // image inside a region of interest
+    class BlurKernel : public Kernel
+    {
+        PIXEL_BUFFER *_image;
+        int _kwidth;
+        const SGRect *_roi;
+        float _stddev, _qthresh;
+
+    public:
+        BlurKernel(PIXEL_BUFFER *image, int kwidth, const SGRect *roi = 0,
+                   float stddev = 0, float qthresh = 4.0f) :
+            _image(image), _kwidth(kwidth), _roi(roi),
+            _stddev(stddev), _qthresh(qthresh)
+        {
+        }
+        void Run()
+        {
+            COLOR color = RGBA(0,0,0,127);
+
+            if (_roi != 0)
+                AlphaBlur blur(_image, *_roi, _kwidth, _stddev, color, 0, _qthresh);
+            else
+                AlphaBlur blur(_image, _kwidth, _stddev, color, 0, _qthresh);
+        }
+    };
+
+    // Draws a blurred drop shadow for an ellipse, either directly with
+    // FillShadow, or as in the DropShadow example in demo.cpp: renders
+    // the ellipse into a layer, blurs the layer with AlphaBlur, and
+    // paints the blurred image as a pattern. The ellipse is inscribed
+    // in 'rect', which is in integer pixel coordinates.
+    class ShadowKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        EnhancedRenderer *_aarend;
+        SGRect _rect;
+        float _stddev;
+        bool _blayer;
+        Allocator *_alloc;
+
+    public:
+        ShadowKernel(ShapeGen *sg, EnhancedRenderer *aarend, const SGRect& rect,
+                     float stddev, bool blayer, Allocator *alloc) :
+            _sg(sg), _aarend(aarend), _rect(rect), _stddev(stddev),
+            _blayer(blayer), _alloc(alloc)
+        {
+        }
+        void Run()
+        {
+            const int dx = 6, dy = 8;
+            COLOR color = RGBA(0,0,0,127);
+            SGRect rect = _rect;
+
+            if (_blayer == false)
+            {
+                _sg->SetFixedBits(0);
+                AddEllipse(_sg, rect);
+                FillShadow(_sg, _aarend, color, _stddev, dx, dy);
+                return;
+            }
+
+            PIXEL_BUFFER layer;
+            SGRect clip = { 0, 0, rect.w, rect.h };
+            layer.pixels = 0;  // renderer allocates pixel memory
+            layer.width = rect.w;
+            layer.height = rect.h;
+            layer.depth = 32;
+            SmartPtr<EnhancedRenderer> rend2(CreateEnhancedRenderer(&layer, _alloc));
+            SmartPtr<ShapeGen> sg2(CreateShapeGen(&(*rend2), clip, _alloc));
+            AddEllipse(&(*sg2), clip);
+            sg2->FillPath();
+            rend2->GetPixelBuffer(&layer);
+
+            AlphaBlur blur(&layer, 3*_stddev, _stddev, color, _alloc);
+            SGRect blurbbox;
+            blur.GetBlurredBoundingBox(&blurbbox, &rect);
+            blurbbox.x += dx, blurbbox.y += dy;
+            _aarend->SetPattern(&blur, blurbbox.x, blurbbox.y,
+                                blurbbox.w, blurbbox.h,
+                                FLAG_IMAGE_BGRA32 | FLAG_PREMULTALPHA);
+            _sg->SetFixedBits(0);
+            _sg->BeginPath();
+            _sg->Rectangle(blurbbox);
+            _sg->FillPath();
+            _aarend->SetColor();
+        }
+        static void AddEllipse(ShapeGen *sg, const SGRect& rect)
+        {
+            SGPoint v0, v1, v2;
+
+            v0.x = rect.x + rect.w/2;
+            v0.y = rect.y + rect.h/2;
+            v1 = v2 = v0;
+            v1.x += rect.w/2;
+            v2.y += rect.h/2;
+            sg->BeginPath();
+            sg->Ellipse(v0, v1, v2);
+        }
+    };
+
+    // Draws a table of short text strings, either one string at a
+    // time or as a single batch
+    class TextKernel : public Kernel
+    {
+        ShapeGen *_sg;
+        TextApp *_txt;
+        const TEXTITEM *_item;
+        int _count;
+        float _scale;
+        bool _bbatch;
+
+    public:
+        TextKernel(ShapeGen *sg, TextApp *txt, const TEXTITEM item[],
+                   int count, float scale, bool bbatch) :
+            _sg(sg), _txt(txt), _item(item), _count(count),
+            _scale(scale), _bbatch(bbatch)
+        {
+        }
+        void Run()
+        {
+            if (_bbatch)
+            {
+                _txt->DisplayText(_sg, _scale, _item, _count);
+                return;
+            }
+            for (int i = 0; i < _count; ++i)
+                _txt->DisplayText(_sg, _item[i].xystart, _scale, _item[i].str);
+        }
+    };
+
+    // Converts an array of pixels to a different pixel format
+    class ConvertKernel : public Kernel
+    {
+        COLOR *_dst;
+        const COLOR *_src;
+        int _len, _flags;
+
+    public:
+        ConvertKernel(COLOR *dst, const COLOR *src, int len, int flags) :
+            _dst(dst), _src(src), _len(len), _flags(flags)
+        {
+        }
+        void Run()
+        {
+            ConvertPixels(_dst, _src, _len, _flags);
+        }
+    };
+
+    // Draws a synthetic stress scene
+    class StressKernel : public Kernel
+    {
+        StressScene *_scene;
+        ShapeGen *_sg;
+        EnhancedRenderer *_aarend;
+        STRESSTYPE _type;
+        int _n;
+
+    public:
+        StressKernel(StressScene *scene, ShapeGen *sg, EnhancedRenderer *aarend,
+                     STRESSTYPE type, int n) :
+            _scene(scene), _sg(sg), _aarend(aarend), _type(type), _n(n)
+        {
+        }
+        void Run()
+        {
+            _scene->Draw(_sg, _aarend, _type, _n);
+        }
+    };
+
+    //-------------------------------------------------------------------
+    //
+    // Benchmark groups
+    //
+    //-------------------------------------------------------------------
+
+    const int polysize[] = { 16, 256, 4096 };
+
+    // Star and random polygons have O(n^2) edge crossings, so their
+    // vertex counts are capped at this limit
+    const int MAX_CROSSING_VERTS = 256;
+
+    void BenchNormalizeEdges(ShapeGen *sg)
+    {
+        char name[64];
+
+        printf("\n--- NormalizeEdges (path to normalized edge list) ---\n");
+        for (int type = POLY_CONVEX; type <= POLY_COMB; ++type)
+            for (int i = 0; i < ARRAY_LEN(polysize); ++i)
+            {
+                int n = polysize[i];
+
+                if (type == POLY_STAR || type == POLY_RANDOM)
+                {
+                    if (n > MAX_CROSSING_VERTS)
+                        continue;
+                }
+
+                SGPoint *xy = new SGPoint[n];
+                MakePolygon(xy, n, POLYTYPE(type));
+                FillKernel kernel(sg, xy, n);
+                sprintf(name, "fill %s", polyname[type]);
+                Measure(name, &kernel, n, "vertices");
+                delete[] xy;
+            }
+    }
+
+    void BenchClipEdges(ShapeGen *sg)
+    {
+        SGPoint v0 = { BUFFER_WIDTH << 15, BUFFER_HEIGHT << 15 };
+        SGPoint v1 = { v0.x + (BUFFER_WIDTH << 14), v0.y };
+        SGPoint v2 = { v0.x, v0.y + (BUFFER_HEIGHT << 14) };
+        char name[64];
+
+        printf("\n--- ClipEdges (fill inside an elliptical clipping region) ---\n");
+        sg->BeginPath();
+        sg->Ellipse(v0, v1, v2);
+        sg->SetClipRegion();
+        for (int type = POLY_CONVEX; type <= POLY_STAR; ++type)
+            for (int i = 0; i < ARRAY_LEN(polysize); ++i)
+            {
+                int n = polysize[i];
+
+                if (type != POLY_CONVEX && n > MAX_CROSSING_VERTS)
+                    continue;
+
+                SGPoint *xy = new SGPoint[n];
+                MakePolygon(xy, n, POLYTYPE(type));
+                FillKernel kernel(sg, xy, n);
+                sprintf(name, "clipped fill %s", polyname[type]);
+                Measure(name, &kernel, n, "vertices");
+                delete[] xy;
+            }
+        sg->ResetClipRegion();
+    }
+
+    void BenchFeeder(ShapeGen *sg, SpanDrain *drain)
+    {
+        char name[64];
+
+        printf("\n--- Feeder::GetNextSGSpan (drain spans, no drawing) ---\n");
+        for (int type = POLY_CONVEX; type <= POLY_STAR; ++type)
+            for (int i = 0; i < ARRAY_LEN(polysize); ++i)
+            {
+                int n = polysize[i];
+
+                if (type != POLY_CONVEX && n > MAX_CROSSING_VERTS)
+                    continue;
+
+                SGPoint *xy = new SGPoint[n];
+                MakePolygon(xy, n, POLYTYPE(type));
+                drain->_count = 0;
+                AddPolygon(sg, xy, n, true);
+                sg->FillPath();
+
+                FillKernel kernel(sg, xy, n);
+                sprintf(name, "spans %s/%d", polyname[type], n);
+                Measure(name, &kernel, drain->_count, "spans");
+                delete[] xy;
+            }
+    }
+
+    void BenchRenderer(ShapeGen *sg, EnhancedRenderer *aarend)
+    {
+        const int size[] = { 16, 128, 1000 };
+        const char *blendname[] = { "src-over-dst", "add-with-sat", "alpha-clear" };
+        char name[64];
+
+        printf("\n--- FillSubpixelSpan/RenderAbuffer (opaque solid fill) ---\n");
+        aarend->SetColor(RGBX(40,80,160));
+        for (int i = 0; i < ARRAY_LEN(size); ++i)
+        {
+            RectKernel kernel(sg, size[i], size[i]);
+            sprintf(name, "rectangle %dx%d", size[i], size[i]);
+            Measure(name, &kernel, size[i]*size[i], "pixels");
+        }
+
+        printf("\n--- Blend functions (translucent solid fill) ---\n");
+        aarend->SetColor(RGBA(40,80,160,128));
+        for (int op = BLENDOP_SRC_OVER_DST; op <= BLENDOP_ALPHA_CLEAR; ++op)
+        {
+            aarend->SetBlendOperation(BLENDOP(op));
+            for (int i = 1; i < ARRAY_LEN(size); ++i)
+            {
+                RectKernel kernel(sg, size[i], size[i]);
+                sprintf(name, "%s %dx%d", blendname[op], size[i], size[i]);
+                Measure(name, &kernel, size[i]*size[i], "pixels");
+            }
+        }
+        aarend->SetBlendOperation();
+    }
+
+    void BenchBasicRenderer(ShapeGen *sg, SimpleRenderer *rend)
+    {
+        const int size[] = { 16, 128, 1000 };
+        const int nverts[] = { 16, 256 };
+        const double r = 0.45*min(BUFFER_WIDTH, BUFFER_HEIGHT);
+        char name[64];
+
+        printf("\n--- BasicRenderer (aliased opaque solid fill) ---\n");
+        sg->SetRenderer(rend);
+        rend->SetColor(RGBX(40,80,160));
+        for (int i = 0; i < ARRAY_LEN(size); ++i)
+        {
+            RectKernel kernel(sg, size[i], size[i]);
+            sprintf(name, "rectangle %dx%d", size[i], size[i]);
+            Measure(name, &kernel, size[i]*size[i], "pixels");
+        }
+        for (int i = 0; i < ARRAY_LEN(nverts); ++i)
+        {
+            int n = nverts[i];
+            SGPoint *xy = new SGPoint[n];
+
+            MakePolygon(xy, n, POLY_CONVEX);
+            FillKernel kernel(sg, xy, n);
+            sprintf(name, "convex polygon/%d", n);
+            Measure(name, &kernel, int(PI*r*r), "pixels");
+            delete[] xy;
+        }
+    }
+
+    void BenchDraftRenderer(ShapeGen *sg, EnhancedRenderer *draftrend,
+                            EnhancedRenderer *aarend)
+    {
+        const int size[] = { 128, 1000 };
+        EnhancedRenderer *rend[] = { aarend, draftrend };
+        const char *rendname[] = { "antialiased", "draft" };
+        char name[64];
+
+        printf("\n--- DraftRenderer vs. AA4x8Renderer (solid and gradient fills) ---\n");
+        for (int k = 0; k < ARRAY_LEN(rend); ++k)
+        {
+            sg->SetRenderer(rend[k]);
+            rend[k]->SetColor(RGBX(40,80,160));
+            for (int i = 0; i < ARRAY_LEN(size); ++i)
+            {
+                RectKernel kernel(sg, size[i], size[i]);
+                sprintf(name, "%s solid %dx%d", rendname[k], size[i], size[i]);
+                Measure(name, &kernel, size[i]*size[i], "pixels");
+            }
+            rend[k]->ResetColorStops();
+            rend[k]->AddColorStop(0, RGBX(255,0,0));
+            rend[k]->AddColorStop(1.0, RGBX(0,0,255));
+            rend[k]->SetLinearGradient(0,0, 700,300, SPREAD_REFLECT,
+                                       FLAG_EXTEND_START | FLAG_EXTEND_END);
+            for (int i = 0; i < ARRAY_LEN(size); ++i)
+            {
+                RectKernel kernel(sg, size[i], size[i]);
+                sprintf(name, "%s gradient %dx%d", rendname[k], size[i], size[i]);
+                Measure(name, &kernel, size[i]*size[i], "pixels");
+            }
+            rend[k]->SetColor(RGBX(0,0,0));
+        }
+    }
+
+    void BenchPaint()
+    {
+        const int len[] = { 16, 256, 1024 };
+        const int rows = 64;
+        const float xform[6] = { 0.8f, 0.3f, -0.3f, 0.8f, 50, 20 };
+        const int bigsize = 1024;
+        PaintGen *paintgen[8];
+        const char *paintname[] = { "linear gradient", "radial gradient",
+                                    "conic gradient", "tiled pattern",
+                                    "vertical gradient", "horizontal gradient",
+                                    "large pattern", "large pattern cached" };
+        COLOR pattern[64*64];
+        COLOR *bigpattern = new COLOR[bigsize*bigsize];
+        char name[64];
+
+        LinearGradient *lin = CreateLinearGradient(0,0, 700,300, SPREAD_REFLECT,
+                                                   FLAG_EXTEND_START | FLAG_EXTEND_END);
+        RadialGradient *rad = CreateRadialGradient(300,300,10, 400,350,500, SPREAD_REPEAT,
+                                                   FLAG_EXTEND_START | FLAG_EXTEND_END);
+        ConicGradient *con = CreateConicGradient(512,512, 0,2*PI, SPREAD_PAD,
+                                                 FLAG_EXTEND_END);
+        LinearGradient *vert = CreateLinearGradient(0,0, 0,700, SPREAD_REFLECT,
+                                                    FLAG_EXTEND_START | FLAG_EXTEND_END);
+        LinearGradient *horz = CreateLinearGradient(0,0, 700,0, SPREAD_REFLECT,
+                                                    FLAG_EXTEND_START | FLAG_EXTEND_END);
+        for (int i = 0; i < 4; ++i)
+        {
+            COLOR color = RGBA(60*i, 255 - 60*i, 128, 255 - 30*i);
+
+            lin->AddColorStop(i/3.0f, color);
+            rad->AddColorStop(i/3.0f, color);
+            con->AddColorStop(i/3.0f, color);
+            vert->AddColorStop(i/3.0f, color);
+            horz->AddColorStop(i/3.0f, color);
+        }
+        for (int i = 0; i < ARRAY_LEN(pattern); ++i)
+            pattern[i] = RGBA(i, i >> 6, i ^ 0x5a, 255);
+        for (int i = 0; i < bigsize*bigsize; ++i)
+            bigpattern[i] = RGBA(i, i >> 10, i ^ 0x5a, 255);
+
+        // The cached version reads 64x64 tiles, and keeps up to 1 MB
+        // of them in memory
+        TileSource *tilesrc = CreateRawTileSource(bigpattern, bigsize, bigsize, bigsize);
+
+        paintgen[0] = lin;
+        paintgen[1] = rad;
+        paintgen[2] = con;
+        paintgen[3] = CreateTiledPattern(pattern, 0, 0, 64, 64, 64, 0, xform);
+        paintgen[4] = vert;
+        paintgen[5] = horz;
+        paintgen[6] = CreateTiledPattern(bigpattern, 0, 0, bigsize, bigsize,
+                                         bigsize, 0, xform);
+        paintgen[7] = CreateTiledPattern(tilesrc, 0, 0, bigsize, bigsize,
+                                         0, 1 << 20, xform);
+
+        printf("\n--- PaintGen::FillSpan (gradients and patterns) ---\n");
+        for (int k = 0; k < ARRAY_LEN(paintgen); ++k)
+        {
+            for (int i = 0; i < ARRAY_LEN(len); ++i)
+                for (int balpha = 0; balpha < 2; ++balpha)
+                {
+                    PaintKernel kernel(paintgen[k], len[i], rows, balpha != 0);
+                    sprintf(name, "%s %s/%d", paintname[k],
+                            (balpha) ? "alpha" : "opaque", len[i]);
+                    Measure(name, &kernel, len[i]*rows, "pixels");
+                }
+            delete paintgen[k];
+        }
+        delete tilesrc;
+        delete[] bigpattern;
+    }
+
+    void BenchCurves(ShapeGen *sg)
+    {
+        const int ncurves[] = { 1, 16, 256 };
+        const int radius[] = { 4, 64, 1024 };
+        char name[64];
+
+        printf("\n--- Bezier3 flattening (path construction only) ---\n");
+        for (int i = 0; i < ARRAY_LEN(ncurves); ++i)
+        {
+            int n = 3*ncurves[i];
+            SGPoint *xy = new SGPoint[n + 1];
+
+            MakePolygon(xy, n + 1, POLY_RANDOM);
+            Bezier3Kernel kernel(sg, xy, n);
+            sprintf(name, "cubic Bezier x%d", ncurves[i]);
+            Measure(name, &kernel, ncurves[i], "curves");
+            delete[] xy;
+        }
+
+        printf("\n--- EllipseCore (path construction only) ---\n");
+        for (int i = 0; i < ARRAY_LEN(radius); ++i)
+        {
+            EllipseKernel kernel(sg, radius[i], 16);
+            sprintf(name, "ellipse radius %d", radius[i]);
+            Measure(name, &kernel, 16, "ellipses");
+        }
+    }
+
+    void BenchStroke(ShapeGen *sg)
+    {
+        const char *joinname[] = { "bevel", "round", "miter" };
+        const char *endname[] = { "flat", "round", "square" };
+        const int n = 256;
+        SGPoint xy[n];
+        char name[64];
+
+        printf("\n--- StrokedShape (zigzag polyline, width 12) ---\n");
+        MakeZigzag(xy, n);
+        sg->SetLineWidth(12.0f);
+        for (int join = LINEJOIN_BEVEL; join <= LINEJOIN_MITER; ++join)
+        {
+            sg->SetLineJoin(LINEJOIN(join));
+            StrokeKernel kernel(sg, xy, n);
+            sprintf(name, "%s join", joinname[join]);
+            Measure(name, &kernel, n - 1, "segments");
+        }
+        sg->SetLineJoin();
+        for (int cap = LINEEND_FLAT; cap <= LINEEND_SQUARE; ++cap)
+        {
+            sg->SetLineEnd(LINEEND(cap));
+            StrokeKernel kernel(sg, xy, 2);
+            sprintf(name, "%s cap", endname[cap]);
+            Measure(name, &kernel, 1, "segments");
+        }
+        sg->SetLineEnd();
+        sg->SetLineWidth();
+    }
+
+    void BenchBlur()
+    {
+        const int size[] = { 32, 256 };
+        const int kwidth[] = { 9, 27 };
+        char name[64];
+
+        printf("\n--- AlphaBlur::BlurImage ---\n");
+        for (int i = 0; i < ARRAY_LEN(size); ++i)
+        {
+            PIXEL_BUFFER image;
+
+            image.width = image.height = size[i];
+            image.depth = 32;
+            image.pitch = size[i]*sizeof(COLOR);
+            image.pixels = AllocateRawPixels(size[i], size[i], RGBA(0,0,0,255));
+            for (int j = 0; j < ARRAY_LEN(kwidth); ++j)
+            {
+                BlurKernel kernel(&image, kwidth[j]);
+                sprintf(name, "blur %dx%d kernel %d", size[i], size[i], kwidth[j]);
+                Measure(name, &kernel, size[i]*size[i], "pixels");
+
+                // Only the bottom-right quarter of the image is visible
+                SGRect roi = { size[i]/2, size[i]/2, size[i], size[i] };
+                BlurKernel roikernel(&image, kwidth[j], &roi);
+                sprintf(name, "blur %dx%d kernel %d roi", size[i], size[i], kwidth[j]);
+                Measure(name, &roikernel, size[i]*size[i], "pixels");
+            }
+            DeleteRawPixels(image.pixels);
+        }
+
+        // Compare blurs with large standard deviations at full and
+        // at reduced resolution, and measure the error in the reduced-
+        // resolution blurs. The source image is a disk.
+        const float stddev[] = { 8, 16, 32 };
+        const int disksize = 256;
+        PIXEL_BUFFER disk;
+
+        disk.width = disk.height = disksize;
+        disk.depth = 32;
+        disk.pitch = disksize*sizeof(COLOR);
+        disk.pixels = AllocateRawPixels(disksize, disksize, 0);
+        for (int y = 0; y < disksize; ++y)
+            for (int x = 0; x < disksize; ++x)
+            {
+                int dx = 2*x + 1 - disksize, dy = 2*y + 1 - disksize;
+                if (dx*dx + dy*dy < disksize*disksize*3/4)
+                    disk.pixels[y*disksize + x] = RGBA(0,0,0,255);
+            }
+
+        printf("\n--- AlphaBlur at reduced resolution (qthresh = 4) ---\n");
+        for (int i = 0; i < ARRAY_LEN(stddev); ++i)
+        {
+            BlurKernel exact(&disk, 0, 0, stddev[i], 0);
+            sprintf(name, "blur %dx%d stddev %g exact", disksize, disksize, stddev[i]);
+            Measure(name, &exact, disksize*disksize, "pixels");
+            BlurKernel reduced(&disk, 0, 0, stddev[i], 4.0f);
+            sprintf(name, "blur %dx%d stddev %g reduced", disksize, disksize, stddev[i]);
+            Measure(name, &reduced, disksize*disksize, "pixels");
+
+            AlphaBlur blur1(&disk, 0, stddev[i], RGBA(0,0,0,255), 0, 0);
+            AlphaBlur blur2(&disk, 0, stddev[i], RGBA(0,0,0,255), 0, 4.0f);
+            PIXEL_BUFFER buf1, buf2;
+            blur1.GetBlurredImage(&buf1);
+            blur2.GetBlurredImage(&buf2);
+            assert(buf1.width == buf2.width && buf1.height == buf2.height);
+            int maxerr = 0, count = buf1.width*buf1.height;
+            double sumerr = 0;
+            for (int k = 0; k < count; ++k)
+            {
+                int err = (buf1.pixels[k] >> 24) - (buf2.pixels[k] >> 24);
+                err = (err < 0) ? -err : err;
+                maxerr = max(maxerr, err);
+                sumerr += err;
+            }
+            printf("    alpha error vs exact: max %d, mean %.3f (of 255)\n",
+                   maxerr, sumerr/count);
+        }
+        DeleteRawPixels(disk.pixels);
+    }
+
+    // Compares drop shadows drawn with FillShadow, which captures the
+    // shape's coverage in an 8-bit mask, with those drawn by way of an
+    // RGBA layer, an AlphaBlur image, and a pattern. Each method draws
+    // into its own buffer, with its own allocator to measure the peak
+    // scratch memory. The standard deviations are small enough that
+    // AlphaBlur blurs at full resolution, like FillShadow.
+    void BenchShadow()
+    {
+        const float stddev[] = { 3, 6 };
+        const int bufsize = 512;
+        SGRect rect = { 64, 64, 320, 256 };
+        SGRect clip = { 0, 0, bufsize, bufsize };
+        char name[64];
+
+        printf("\n--- Drop shadow (%dx%d ellipse) ---\n", rect.w, rect.h);
+        for (int i = 0; i < ARRAY_LEN(stddev); ++i)
+        {
+            PIXEL_BUFFER buf[2];
+            size_t peak[2];
+
+            for (int k = 0; k < 2; ++k)
+            {
+                bool blayer = (k == 1);
+                CountingAllocator alloc;
+
+                buf[k].width = buf[k].height = bufsize;
+                buf[k].depth = 32;
+                buf[k].pitch = bufsize*sizeof(COLOR);
+                buf[k].pixels = AllocateRawPixels(bufsize, bufsize, RGBX(255,255,255));
+                {
+                    SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&buf[k], &alloc));
+                    SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), clip, &alloc));
+                    ShadowKernel kernel(&(*sg), &(*aarend), rect, stddev[i], blayer, &alloc);
+
+                    // The first run paints the shadow that is compared
+                    // below, and measures the scratch memory
+                    alloc.ResetPeak();
+                    kernel.Run();
+                    peak[k] = alloc._peak - alloc._current;
+                    sprintf(name, "shadow stddev %g %s", stddev[i],
+                            blayer ? "layer+blur" : "FillShadow");
+                    Measure(name, &kernel, rect.w*rect.h, "pixels");
+                }
+            }
+
+            // The Measure calls paint the shadow many more times, so
+            // repaint each buffer once before comparing them
+            for (int k = 0; k < 2; ++k)
+            {
+                CountingAllocator alloc;
+                for (int j = 0; j < bufsize*bufsize; ++j)
+                    buf[k].pixels[j] = RGBX(255,255,255);
+
+                SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&buf[k], &alloc));
+                SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), clip, &alloc));
+                ShadowKernel kernel(&(*sg), &(*aarend), rect, stddev[i], k == 1, &alloc);
+                kernel.Run();
+            }
+            int maxerr = 0, count = bufsize*bufsize;
+            double sumerr = 0;
+            for (int j = 0; j < count; ++j)
+            {
+                int err = (buf[0].pixels[j] & 255) - (buf[1].pixels[j] & 255);
+                err = (err < 0) ? -err : err;
+                maxerr = max(maxerr, err);
+                sumerr += err;
+            }
+            printf("    scratch memory: FillShadow %d bytes, layer+blur %d bytes\n",
+                   (int)peak[0], (int)peak[1]);
+            printf("    pixel difference: max %d, mean %.3f (of 255)\n",
+                   maxerr, sumerr/count);
+            DeleteRawPixels(buf[0].pixels);
+            DeleteRawPixels(buf[1].pixels);
+        }
+    }
+
+    void BenchText(ShapeGen *sg, EnhancedRenderer *aarend)
+    {
+        const int COLS = 16, ROWS = 64;
+        const char *batchname[] = { "one string per call", "batched strings" };
+        static char cell[ROWS*COLS][8];
+        TEXTITEM item[ROWS*COLS];
+        float cellw = (float)BUFFER_WIDTH/COLS, cellh = (float)BUFFER_HEIGHT/ROWS;
+        TextApp txt;
+        char name[64];
+
+        for (int i = 0; i < ROWS*COLS; ++i)
+        {
+            sprintf(cell[i], "%d.%02d", (37*i) % 1000, (13*i) % 100);
+            item[i].str = cell[i];
+            item[i].xystart.x = (SGCoord)((i % COLS)*cellw + 4);
+            item[i].xystart.y = (SGCoord)((i/COLS + 0.8f)*cellh);
+        }
+        printf("\n--- TextApp::DisplayText (table of %d cells) ---\n", ROWS*COLS);
+        aarend->SetColor(RGBX(0,0,0));
+        sg->SetLineWidth(1.0f);
+        for (int k = 0; k < ARRAY_LEN(batchname); ++k)
+        {
+            TextKernel kernel(sg, &txt, item, ROWS*COLS, 0.12f, k != 0);
+            sprintf(name, "%s", batchname[k]);
+            Measure(name, &kernel, ROWS*COLS, "strings");
+        }
+    }
+
+    void BenchConvert()
+    {
+        const int len = 256*256;
+        const int flags[] = { FLAG_SWAP_REDBLUE | FLAG_PREMULTALPHA, 0, FLAG_SWAP_REDBLUE };
+        const char *convname[] = { "swap red/blue", "premultiply alpha",
+                                   "swap + premultiply" };
+        COLOR *src = new COLOR[len];
+        COLOR *dst = new COLOR[len];
+        char name[64];
+
+        srand(len);
+        for (int i = 0; i < len; ++i)
+            src[i] = (rand() << 16) ^ rand();
+
+        printf("\n--- ConvertPixels (256x256 image) ---\n");
+        for (int i = 0; i < ARRAY_LEN(flags); ++i)
+        {
+            ConvertKernel kernel(dst, src, len, flags[i]);
+            sprintf(name, "%s", convname[i]);
+            Measure(name, &kernel, len, "pixels");
+        }
+        delete[] src;
+        delete[] dst;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Scaling studies: Draws each type of stress scene at a series of
+// increasing sizes, and reports the time per scene and the peak memory
+// that ShapeGen and the renderer used to draw the scene. A separate
+// ShapeGen object and renderer are used for each scene size, so that
+// pool memory grown by a larger scene isn't charged to a smaller one.
+//
+//---------------------------------------------------------------------
+
+namespace {
+    // Scene sizes for each STRESSTYPE value. Sizes for workloads whose
+    // cost grows as n squared are kept small to limit the run time.
+    const int stresssize[STRESS_TYPE_COUNT][4] = {
+        { 16, 64, 256, 1024 },          // polygon vertices
+        { 64, 1024, 16384, 262144 },    // self-intersections
+        { 256, 1024, 4096, 16384 },     // data points
+        { 256, 4096, 65536, 262144 },   // dashes
+        { 64, 1024, 4096, 16384 },      // characters
+        { 1, 4, 16, 64 },               // nested clipping regions
+    };
+
+    void BenchScaling(PIXEL_BUFFER *bkbuf, unsigned seed)
+    {
+        SGRect cliprect = { 0, 0, bkbuf->width, bkbuf->height };
+        StressScene scene(bkbuf->width, bkbuf->height, seed);
+        char name[64];
+
+        printf("Scaling studies (seed %u, %.2f s per measurement)\n", seed, _measuretime);
+        printf("%-20s %10s %14s %14s %12s\n", "scene", "size", "time", "time/item", "peak memory");
+        for (int type = 0; type < STRESS_TYPE_COUNT; ++type)
+        {
+            for (int i = 0; i < ARRAY_LEN(stresssize[type]); ++i)
+            {
+                CountingAllocator alloc;
+                SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(bkbuf, &alloc));
+                SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), cliprect, &alloc));
+                int n = stresssize[type][i];
+                int size = scene.Draw(&(*sg), &(*aarend), STRESSTYPE(type), n);
+                StressKernel kernel(&scene, &(*sg), &(*aarend), STRESSTYPE(type), n);
+
+                alloc.ResetPeak();
+                double usec = TimeKernel(&kernel);
+
+                printf("%-20s %10d %11.1f us %11.1f ns %9lu KB\n",
+                       StressScene::GetName(STRESSTYPE(type)), size, usec,
+                       1000*usec/size, (unsigned long)(alloc._peak + 1023)/1024);
+            }
+            printf("\n");
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Main program: Runs all the benchmarks
+//
+//---------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    bool bscale = (argc > 1 && strcmp(argv[1], "-scale") == 0);
+    unsigned seed = 1;
+
+    if (bscale && argc > 2)
+        seed = strtoul(argv[2], 0, 0);
+    else if (bscale == false && argc > 1)
+        _measuretime = max(atof(argv[1]), 0.01);
+
+    PIXEL_BUFFER bkbuf;
+    SGRect cliprect = { 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT };
+
+    bkbuf.width = BUFFER_WIDTH;
+    bkbuf.height = BUFFER_HEIGHT;
+    bkbuf.depth = 32;
+    bkbuf.pitch = BUFFER_WIDTH*sizeof(COLOR);
+    bkbuf.pixels = AllocateRawPixels(BUFFER_WIDTH, BUFFER_HEIGHT, RGBX(255,255,255));
+    if (bkbuf.pixels == 0)
+        return -1;  // out of memory
+
+    if (bscale)
+    {
+        BenchScaling(&bkbuf, seed);
+        DeleteRawPixels(bkbuf.pixels);
+        return 0;
+    }
+
+    NullRenderer nullrend;
+    SpanDrain drain;
+    SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&bkbuf));
+    SmartPtr<EnhancedRenderer> draftrend(CreateDraftRenderer(&bkbuf));
+    SmartPtr<SimpleRenderer> rend(CreateSimpleRenderer(&bkbuf));
+    SmartPtr<ShapeGen> sg(CreateShapeGen(&nullrend, cliprect));
+
+    printf("ShapeGen kernel benchmarks (%.2f s per measurement)\n", _measuretime);
+    sg->SetFixedBits(16);
+    BenchNormalizeEdges(&(*sg));
+    BenchClipEdges(&(*sg));
+    BenchCurves(&(*sg));
+    BenchStroke(&(*sg));
+    sg->SetRenderer(&drain);
+    BenchFeeder(&(*sg), &drain);
+    sg->SetRenderer(&(*aarend));
+    BenchRenderer(&(*sg), &(*aarend));
+    BenchBasicRenderer(&(*sg), &(*rend));
+    BenchDraftRenderer(&(*sg), &(*draftrend), &(*aarend));
+    BenchPaint();
+    BenchBlur();
+    BenchShadow();
+    sg->SetRenderer(&(*aarend));
+    BenchText(&(*sg), &(*aarend));
+    BenchConvert();
+    DeleteRawPixels(bkbuf.pixels);
+    return 0;
+}
@@ -25,12 +25,14 @@
 //   This file implements a rudimentary BMP file reader; that is, it
 //   reads image files with a .bmp filename extension. This reader can
 //   handle the simple BMP files used by the ShapeGen demo program.
-//   The BmpReader class inherits from the base class ImageReader,
-//   which is defined in render.h, and is provided to supply image
-//   data to TiledPattern objects for use in pattern-fill operations.
+//   The BmpReader class inherits from the base classes ImageReader
+//   and TileSource, which are defined in render.h, and is provided to
+//   supply image data to TiledPattern objects for use in pattern-fill
+//   operations.
 //
 //---------------------------------------------------------------------
 
+#define _FILE_OFFSET_BITS 64  // 64-bit off_t for fseeko on 32-bit targets
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -52,6 +54,18 @@ namespace {
     const int BI_RLE4 = 2;
     const int BI_BITFIELDS = 3;
 
+    // Seeks to the specified offset from the start of the file. The
+    // pixel data in a large .bmp file can extend past the 2-GB limit
+    // of fseek, which takes a 32-bit long on Windows and 32-bit Linux.
+    int SeekFile(FILE *pFile, long long offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(pFile, offset, SEEK_SET);
+#else
+        return fseeko(pFile, static_cast<off_t>(offset), SEEK_SET);
+#endif
+    }
+
     // Make sure that packing alignment setting for structs
     // enables bfSize field to immediately follow bfType
     #pragma pack(push,2)
@@ -271,12 +285,12 @@ BmpReader::BmpReader(const char *pszFile) :
             _flags |= FLAG_IMAGE_BOTTOMUP;
 
         // Sanity checks
-        if (hdr.bfSize < _width*_height*(_bpp >> 3))
+        if (hdr.bfSize < (long long)_width*_height*(_bpp >> 3))
         {
             pszError = "has bad value in info header";
             break;
         }
-        if (_width > 5000 || _height > 5000)
+        if (_width > 32768 || _height > 32768)
         {
             pszError = "has excessively large image dimensions";
             break;
@@ -429,3 +443,54 @@ bool BmpReader::RewindData()
     return true;
 }
 
+// Public function: Reads the tile at column tx and row ty of the
+// bitmap from the .bmp file, and writes it to a caller-supplied buffer
+// whose pitch is the tile width. Tile rows are numbered in file order,
+// which is bottom-up unless the bitmap height in the info header is
+// negative. Each row of the tile is located in the file by seeking, so
+// the tiles can be read in any order. A partial tile at the right or
+// bottom edge of the bitmap is padded with transparent pixels. As in
+// ReadPixels, each pixel is converted to a 32-bit BGRA format. Calls
+// to this function move the file position, so call RewindData before
+// calling ReadPixels again.
+bool BmpReader::ReadTile(int tx, int ty, COLOR *buffer)
+{
+    const int tsize = BMP_TILESIZE;
+    int x0 = tx*tsize, y0 = ty*tsize;
+
+    if (_pFile == 0 || tx < 0 || ty < 0 || x0 >= _width || y0 >= _height)
+        return false;
+
+    int w = min(tsize, _width - x0);
+    int h = min(tsize, _height - y0);
+    int bypp = _bpp >> 3;  // bytes per pixel
+    long long stride = bypp*_width + _pad;
+
+    memset(buffer, 0, tsize*tsize*sizeof(COLOR));
+    for (int j = 0; j < h; ++j)
+    {
+        COLOR *pOut = &buffer[j*tsize];
+        char *pIn = reinterpret_cast<char*>(pOut) + (sizeof(COLOR) - bypp)*w;
+
+        // Read the pixels into the end of the row of w 32-bit pixels
+        // so that 24-bit pixels can be expanded in place, from left to
+        // right, without overwriting pixels that are still to be read
+        if (SeekFile(_pFile, _offset + (y0 + j)*stride + x0*bypp) != 0 ||
+            fread(pIn, bypp, w, _pFile) != w)
+        {
+            ErrorMessage("Error reading tile from .bmp file");
+            return false;
+        }
+        for (int i = 0; i < w; ++i)
+        {
+            COLOR pixel = 0;
+
+            memcpy(&pixel, &pIn[bypp*i], bypp);
+            if (_bpp == 24 || !_bAlpha)
+                pixel |= 0xff000000;  // set alpha field to 255
+
+            pOut[i] = pixel;
+        }
+    }
+    return true;
+}
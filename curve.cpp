@@ -83,12 +83,9 @@ bool PathMgr::IsFlatQuadratic(const VERT16 v[3])
 
 bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
 {
-    VERT16 vstack[2*MAXLEVELS];  // stack for polygon vertices
-    VERT16 *pvstk = &vstack[0];  // vertex stack pointer
-    int lstack[MAXLEVELS];       // stack for level numbers
-    int *plstk = &lstack[0];     // level stack pointer
-    int level = 0;               // current subdivision level
-    VERT16 v[2+1][2+1];          // control polygon vertices
+    double scale = 1 << _fixshift;
+    VERTD u[2+1];           // unclipped control polygon vertices
+    VERT16 v[2+1][2+1];     // control polygon vertices
 
     if (_cpoint == 0)
     {
@@ -97,11 +94,46 @@ bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
     }
 
     // Get the three vertices for Bezier control polygon ABC
+    u[0] = _upoint;      // A
+    u[1].x = scale*v1.x; // B
+    u[1].y = scale*v1.y;
+    u[2].x = scale*v2.x; // C
+    u[2].y = scale*v2.y;
+    if (!IsInsideRange(u[0]) || !IsInsideRange(u[1]) ||
+        !IsInsideRange(u[2]))
+    {
+        ClipBezier(u, 2, 0);
+        return true;
+    }
     v[0][0] = *_cpoint;             // A
     v[0][1].x = v1.x << _fixshift;  // B
     v[0][1].y = v1.y << _fixshift;
     v[0][2].x = v2.x << _fixshift;  // C
     v[0][2].y = v2.y << _fixshift;
+    FlattenQuadratic(v);
+    _upoint = u[2];
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a quadratic Bezier curve, and appends the
+// resulting chords to the current figure. Array element v[0][0] is the
+// current point, and v[0][1] and v[0][2] are the remaining points in
+// the curve's control polygon. The rest of the v array is used as
+// scratch memory. This function uses the classic de Casteljau
+// algorithm to subdivide the Bezier curve into segments that meet the
+// tolerance specified by the _flatness member.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::FlattenQuadratic(VERT16 v[2+1][2+1])
+{
+    VERT16 vstack[2*MAXLEVELS];  // stack for polygon vertices
+    VERT16 *pvstk = &vstack[0];  // vertex stack pointer
+    int lstack[MAXLEVELS];       // stack for level numbers
+    int *plstk = &lstack[0];     // level stack pointer
+    int level = 0;               // current subdivision level
 
     // Continue to subdivide Bezier control polygon ABC until the
     // flatness of each curve segment is within the specified tolerance
@@ -141,7 +173,6 @@ bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
         v[0][1] = *--pvstk;  // B
         v[0][2] = *--pvstk;  // C
     }
-    return true;
 }
 
 //---------------------------------------------------------------------
@@ -216,12 +247,9 @@ bool PathMgr::IsFlatCubic(const VERT16 v[4])
 
 bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
 {
-    VERT16 vstack[3*MAXLEVELS];  // stack for polygon vertices
-    VERT16 *pvstk = &vstack[0];  // vertex stack pointer
-    int lstack[MAXLEVELS];       // stack for level numbers
-    int *plstk = &lstack[0];     // level stack pointer
-    int level = 0;               // current subdivision level
-    VERT16 v[3+1][3+1];          // control polygon vertices
+    double scale = 1 << _fixshift;
+    VERTD u[3+1];           // unclipped control polygon vertices
+    VERT16 v[3+1][3+1];     // control polygon vertices
 
     if (_cpoint == 0)
     {
@@ -230,6 +258,19 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
     }
 
     // Get the four vertices for Bezier control polygon ABCD
+    u[0] = _upoint;      // A
+    u[1].x = scale*v1.x; // B
+    u[1].y = scale*v1.y;
+    u[2].x = scale*v2.x; // C
+    u[2].y = scale*v2.y;
+    u[3].x = scale*v3.x; // D
+    u[3].y = scale*v3.y;
+    if (!IsInsideRange(u[0]) || !IsInsideRange(u[1]) ||
+        !IsInsideRange(u[2]) || !IsInsideRange(u[3]))
+    {
+        ClipBezier(u, 3, 0);
+        return true;
+    }
     v[0][0] = *_cpoint;             // A
     v[0][1].x = v1.x << _fixshift;  // B
     v[0][1].y = v1.y << _fixshift;
@@ -237,6 +278,30 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
     v[0][2].y = v2.y << _fixshift;
     v[0][3].x = v3.x << _fixshift;  // D
     v[0][3].y = v3.y << _fixshift;
+    FlattenCubic(v);
+    _upoint = u[3];
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a cubic Bezier curve, and appends the
+// resulting chords to the current figure. Array element v[0][0] is
+// the current point, and v[0][1], v[0][2], and v[0][3] are the
+// remaining points in the curve's control polygon. The rest of the v
+// array is used as scratch memory. This function uses the classic de
+// Casteljau algorithm to subdivide the Bezier curve into segments
+// that meet the tolerance specified by the _flatness member.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::FlattenCubic(VERT16 v[3+1][3+1])
+{
+    VERT16 vstack[3*MAXLEVELS];  // stack for polygon vertices
+    VERT16 *pvstk = &vstack[0];  // vertex stack pointer
+    int lstack[MAXLEVELS];       // stack for level numbers
+    int *plstk = &lstack[0];     // level stack pointer
+    int level = 0;               // current subdivision level
 
     // Continue to subdivide control polygon ABCD until the flatness
     // of each curve segment falls within the specified tolerance
@@ -279,7 +344,86 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
         v[0][2] = *--pvstk;  // C
         v[0][3] = *--pvstk;  // D
     }
-    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Appends a Bezier curve that extends outside the
+// 16.16 coordinate range to the current figure. Array v contains the
+// unclipped vertices of the curve's control polygon, and v[0] is the
+// current point. Parameter degree is 2 for a quadratic curve or 3 for
+// a cubic curve. The function subdivides the curve until each curve
+// segment lies either entirely inside the range, in which case it's
+// flattened in the usual way, or entirely outside the range, in which
+// case it's replaced by its chord, which is then clipped to the range.
+// This way, no time is wasted flattening the parts of a curve that
+// cannot be represented in the path. Parameter level is the current
+// subdivision level.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::ClipBezier(const VERTD v[4], int degree, int level)
+{
+    VERTD vmin = v[0], vmax = v[0];
+    VERTD u[3+1][3+1];
+    int i, j;
+
+    // Get bounding box for curve's control polygon
+    for (i = 1; i <= degree; ++i)
+    {
+        vmin.x = min(v[i].x, vmin.x);
+        vmin.y = min(v[i].y, vmin.y);
+        vmax.x = max(v[i].x, vmax.x);
+        vmax.y = max(v[i].y, vmax.y);
+    }
+    if (IsInsideRange(vmin) && IsInsideRange(vmax))
+    {
+        // Curve lies entirely inside 16.16 range
+        VERT16 w2[2+1][2+1], w3[3+1][3+1];
+        VERT16 *w = (degree == 2) ? w2[0] : w3[0];
+
+        w[0] = *_cpoint;
+        for (i = 1; i <= degree; ++i)
+        {
+            w[i].x = floor(v[i].x + 0.5);
+            w[i].y = floor(v[i].y + 0.5);
+        }
+        if (degree == 2)
+            FlattenQuadratic(w2);
+        else
+            FlattenCubic(w3);
+
+        _upoint = v[degree];
+        return;
+    }
+    if (vmax.x <= -MAXVAL16 || MAXVAL16 <= vmin.x ||
+        vmax.y <= -MAXVAL16 || MAXVAL16 <= vmin.y || level == MAXCLIPLEVELS)
+    {
+        // Curve lies entirely outside 16.16 range
+        ClipLine(v[degree]);
+        return;
+    }
+
+    // Use de Casteljau's algorithm to split the curve in two
+    for (i = 0; i <= degree; ++i)
+        u[0][i] = v[i];
+
+    for (j = 1; j <= degree; ++j)
+        for (i = 0; i <= degree - j; ++i)
+        {
+            u[j][i].x = (u[j-1][i].x + u[j-1][i+1].x)/2;
+            u[j][i].y = (u[j-1][i].y + u[j-1][i+1].y)/2;
+        }
+
+    VERTD half[3+1];
+    for (i = 0; i <= degree; ++i)
+        half[i] = u[i][0];
+
+    ClipBezier(half, degree, level + 1);
+    for (i = 0; i <= degree; ++i)
+        half[i] = u[degree-i][i];
+
+    ClipBezier(half, degree, level + 1);
 }
 
 //---------------------------------------------------------------------
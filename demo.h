@@ -31,6 +31,7 @@
   #define DEMO_H
 
 #include <stdio.h>
+#include <time.h>
 #include "renderer.h"
 
 // Dimensions of window for demo functions
@@ -90,11 +91,13 @@ public:
 // Class BmpReader:
 //   Reads pixel data serially from a BMP file (with a '.bmp' filename
 //   extention). Supplies image data to TiledPattern objects. Inherits
-//   from ImageReader class defined in render.h.
+//   from ImageReader class defined in render.h. Also inherits from the
+//   TileSource class, so that a pattern can read the tiles of a large
+//   image in random order, as they're needed.
 //
 //---------------------------------------------------------------------
 
-class BmpReader : public ImageReader
+class BmpReader : public ImageReader, public TileSource
 {
     FILE *_pFile;  // .bmp file pointer
     UserMessage _umsg;  // shows error message to user
@@ -110,12 +113,16 @@ class BmpReader : public ImageReader
 
     void ErrorMessage(char *pszError);
 
+    static const int BMP_TILESIZE = 64;  // tile width and height
+
 public:
     BmpReader(const char *pszFile);
     ~BmpReader();
     bool GetImageInfo(int *width, int *height, int *flags);
     int ReadPixels(COLOR *buffer, int count);
     bool RewindData();
+    int GetTileSize() { return BMP_TILESIZE; }
+    bool ReadTile(int tx, int ty, COLOR *buffer);
 };
 
 //---------------------------------------------------------------------
@@ -132,6 +139,13 @@ struct XY
 
 struct GLYPH;
 
+// A text string and the x-y coordinates at which to draw it
+struct TEXTITEM
+{
+    const char *str;
+    SGPoint xystart;
+};
+
 class TextApp
 {
     GLYPH *_glyphtbl[128];  // glyph look-up table
@@ -140,6 +154,7 @@ class TextApp
     float _xspace;          // text spacing multiplier
 
     void DrawGlyph(ShapeGen *sg, char *displist, SGPoint xy[]);
+    void AddTextToPath(ShapeGen *sg, const float xform[], const char *str);
 
 public:
     TextApp();
@@ -147,43 +162,265 @@ public:
     void SetTextSpacing(float xspace);
     void DisplayText(ShapeGen *sg, const float xform[], const char *str);
     void DisplayText(ShapeGen *sg, SGPoint xystart, float scale, const char *str);
+    void DisplayText(ShapeGen *sg, const float xform[], const TEXTITEM item[], int count);
+    void DisplayText(ShapeGen *sg, float scale, const TEXTITEM item[], int count);
     void GetTextEndpoint(const float xform[], const char *str, XY *xyout);
     float GetTextWidth(float scale, const char *str);
 };
 
 //---------------------------------------------------------------------
 //
-// An AlphaBlur object uses a Gaussian filter to blur images, and is
-// typically used to draw drop shadows. The AlphaBlur class is
-// implemented in alfablur.cpp.
+// Display lists: A DisplayList object records a scene as a list of
+// filled and stroked shapes, and can later replay the scene to a
+// ShapeGen object and an enhanced renderer. The recording functions
+// mimic the corresponding ShapeGen and EnhancedRenderer functions.
+// The DisplayList class is implemented in displist.cpp.
 //
 //---------------------------------------------------------------------
 
-class AlphaBlur : public ImageReader
+// Path commands recorded in a display list
+enum DLCMD {
+    DLCMD_MOVE,         // 1 point
+    DLCMD_LINE,         // 1 point
+    DLCMD_BEZIER2,      // 2 points
+    DLCMD_BEZIER3,      // 3 points
+    DLCMD_RECTANGLE,    // 2 points (opposite corners)
+    DLCMD_ELLIPSE,      // 3 points (center, conjugate diameter ends)
+    DLCMD_CLOSEFIGURE,  // 0 points
+    DLCMD_ENDFIGURE     // 0 points
+};
+
+// Max number of dirty rectangles reported by FindDirtyRects
+const int MAX_DIRTY_RECTS = 8;
+
+// Types of paint recorded in a display list
+enum DLPAINTTYPE {
+    DLPAINT_COLOR,
+    DLPAINT_LINEAR_GRADIENT,
+    DLPAINT_RADIAL_GRADIENT
+};
+
+// Paint used to fill or stroke a recorded shape
+struct DLPAINT {
+    DLPAINTTYPE type;   // solid color or gradient
+    COLOR color;        // solid color (type = DLPAINT_COLOR)
+    COLOR alpha;        // constant alpha (0 to 255)
+    float xform[6];     // gradient transform
+    float parm[6];      // linear: x0,y0,x1,y1; radial: x0,y0,r0,x1,y1,r1
+    SPREAD_METHOD spread;
+    int flags;          // gradient flags
+    int nstops;         // number of color stops
+    COLOR_STOP stop[STOPARRAY_MAXLEN];
+};
+
+// Attributes of a recorded stroked shape
+struct DLSTROKE {
+    float linewidth;
+    float miterlimit;
+    LINEJOIN linejoin;
+    LINEEND lineend;
+    char dash[DASHARRAY_MAXLEN+1];  // dash pattern (0 = solid line)
+    int dashoffset;
+    float dashmult;
+};
+
+// A filled or stroked shape recorded in a display list
+struct DLSHAPE {
+    bool bstroke;       // true if stroked, false if filled
+    FILLRULE fillrule;  // fill rule (filled shapes only)
+    int cmd;            // index of first command in shape's path
+    int ncmds;          // number of commands in path
+    int pt;             // index of first point in path
+    int npts;           // number of points in path
+    SGRect bbox;        // bounding box in pixels (conservative)
+    unsigned hash;      // hash of path, attributes, and paint
+    DLSTROKE stroke;    // stroke attributes (stroked shapes only)
+    DLPAINT paint;      // fill or stroke paint
+};
+
+class DisplayList
 {
-    int _kwidth;            // width of Gaussian kernel (always odd)
-    float _stddev;          // standard deviation
-    COLOR *_kcoeff;         // kernel coefficients
-    COLOR _rgba, _rgb, _alpha;  // fill color components
-    PIXEL_BUFFER _blurbuf;  // buffer containing blurred image
-    int _numpixels;         // number of pixels in blurred image
-    int _index;             // current index into blurred image
-
-    void ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len);
-    bool CreateFilterKernel(int kwidth, float stddev);
-    bool BlurImage(const PIXEL_BUFFER *srcimage);
+    int _fixbits;       // fixed-point format of recorded coordinates
+    char *_cmd;         // path commands
+    int _cmdlen, _ncmds;
+    SGPoint *_pt;       // path points
+    int _ptlen, _npts;
+    DLSHAPE *_shape;    // recorded shapes
+    int _shapelen, _nshapes;
+    int _pathcmd, _pathpt;  // start of current path
+    FILLRULE _fillrule; // current fill rule
+    DLSTROKE _stroke;   // current stroke attributes
+    DLPAINT _paint;     // current paint
+
+    bool AddCommand(DLCMD cmd, const SGPoint *xy, int npts);
+    bool AddShape(bool bstroke);
+    bool GetOpaqueRect(const DLSHAPE *shape, SGRect *rect);
+    unsigned HashShape(const DLSHAPE *shape);
+    bool IsSameShape(int index, DisplayList *other, int otherindex);
 
 public:
-    AlphaBlur(const PIXEL_BUFFER *srcimage, int kwidth = 0,
-              float stddev = 0, COLOR color = RGBA(0,0,0,127));
-    ~AlphaBlur();
-    bool GetBlurParams(int *kwidth, float *stddev, COLOR *color);
-    bool GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox);
-    bool GetBlurredImage(PIXEL_BUFFER *blurbuf);
-
-    // Implement ImageReader interface
-    int ReadPixels(COLOR *buffer, int count);
-    bool RewindData();
+    DisplayList(int fixbits = 0);
+    ~DisplayList();
+    void Reset();
+
+    // Path construction
+    void BeginPath();
+    void CloseFigure();
+    void EndFigure();
+    void Move(SGCoord x, SGCoord y);
+    bool Line(SGCoord x, SGCoord y);
+    bool Bezier2(const SGPoint& v1, const SGPoint& v2);
+    bool Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3);
+    void Rectangle(const SGRect& rect);
+    void Ellipse(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2);
+
+    // Attributes of filled and stroked paths
+    void SetFillRule(FILLRULE fillrule = FILLRULE_DEFAULT);
+    void SetLineWidth(float width = LINEWIDTH_DEFAULT);
+    void SetMiterLimit(float mlim = MITERLIMIT_DEFAULT);
+    void SetLineEnd(LINEEND capstyle = LINEEND_DEFAULT);
+    void SetLineJoin(LINEJOIN joinstyle = LINEJOIN_DEFAULT);
+    void SetLineDash(const char dash[] = 0, int offset = 0, float mult = 1.0f);
+
+    // Paint
+    void SetColor(COLOR color = RGBX(0,0,0));
+    void SetLinearGradient(float x0, float y0, float x1, float y1,
+                           SPREAD_METHOD spread = SPREAD_REPEAT,
+                           int flags = FLAG_EXTEND_START | FLAG_EXTEND_END);
+    void SetRadialGradient(float x0, float y0, float r0,
+                           float x1, float y1, float r1,
+                           SPREAD_METHOD spread = SPREAD_REPEAT,
+                           int flags = FLAG_EXTEND_START | FLAG_EXTEND_END);
+    void AddColorStop(float offset, COLOR color);
+    void ResetColorStops();
+    void SetTransform(const float xform[6] = 0);
+    void SetConstantAlpha(COLOR alpha = 255);
+
+    // Recording of filled and stroked shapes
+    bool FillPath();
+    bool StrokePath();
+
+    // Playback
+    int GetCount() { return _nshapes; }
+    const DLSHAPE* GetShape(int index);
+    bool BuildPath(int index, ShapeGen *sg);
+    bool SetPaint(int index, EnhancedRenderer *aarend);
+    bool DrawShape(int index, ShapeGen *sg, EnhancedRenderer *aarend);
+    int Render(ShapeGen *sg, EnhancedRenderer *aarend,
+               int first = 0, CancelCallback *cancel = 0);
+
+    // Scene optimization
+    int CullHiddenShapes();
+
+    // Frame-to-frame updates
+    int FindDirtyRects(DisplayList *prev, SGRect rect[],
+                       int maxrects = MAX_DIRTY_RECTS);
+    bool RenderRegion(const PIXEL_BUFFER& bkbuf, const SGRect& cliprect,
+                      const SGRect& rect, COLOR bkcolor);
+};
+
+//---------------------------------------------------------------------
+//
+// A ProgressiveRenderer object renders the scene in a display list in
+// two passes. The preview pass quickly draws a rough version of the
+// scene directly to the back buffer. The refinement pass then draws
+// the scene at full quality to an offscreen buffer, perhaps in a
+// series of time-limited steps, and copies the finished image to the
+// back buffer. The ProgressiveRenderer class is implemented in
+// displist.cpp.
+//
+//---------------------------------------------------------------------
+
+const float PREVIEW_FLATNESS = 4.0;  // flatness for preview pass
+const int PREVIEW_MINSIZE = 2;       // smallest shape in preview pass
+
+class ProgressiveRenderer
+{
+    DisplayList *_dlist;     // recorded scene
+    PIXEL_BUFFER _bkbuf;     // back buffer displayed to user
+    PIXEL_BUFFER _offbuf;    // offscreen buffer for refinement pass
+    SGRect _cliprect;        // device clipping rectangle
+    EnhancedRenderer *_aarend;  // draws to offscreen buffer
+    ShapeGen *_sg;           // draws shapes in refinement pass
+    int _next;               // next shape to draw in refinement pass
+
+public:
+    ProgressiveRenderer(DisplayList *dlist, const PIXEL_BUFFER& bkbuf,
+                        const SGRect& cliprect);
+    ~ProgressiveRenderer();
+    int DrawPreview(float flatness = PREVIEW_FLATNESS,
+                    int minsize = PREVIEW_MINSIZE);
+    bool Refine(CancelCallback *cancel = 0);
+};
+
+//---------------------------------------------------------------------
+//
+// A CancelToken object cancels a lengthy rendering operation when the
+// application calls the Cancel function, or when a deadline passes.
+// This class is implemented in displist.cpp.
+//
+//---------------------------------------------------------------------
+
+class CancelToken : public CancelCallback
+{
+    volatile bool _bcancel;  // true if Cancel has been called
+    bool _bdeadline;         // true if deadline has been set
+    clock_t _deadline;       // deadline, in clock ticks
+
+public:
+    CancelToken() : _bcancel(false), _bdeadline(false), _deadline(0) {}
+    ~CancelToken() {}
+    void Cancel() { _bcancel = true; }
+    void SetDeadline(int msec);
+    void Reset();
+    bool QueryCancel();
+};
+
+//---------------------------------------------------------------------
+//
+// A StressScene object generates synthetic, parameterized workloads
+// for scaling studies. Each workload type is sized by a parameter n
+// (for example, the number of polygon vertices or the depth of a
+// clip stack). The scenes are generated from a seeded pseudo-random
+// number generator that does not depend on the C library, so that a
+// given seed always produces the same scene on every platform. The
+// StressScene class is implemented in stress.cpp.
+//
+//---------------------------------------------------------------------
+
+enum STRESSTYPE {
+    STRESS_RANDOM_POLYGON,  // filled polygon with n random vertices
+    STRESS_STAR_POLYGON,    // filled star polygon with ~n self-intersections
+    STRESS_HAIRLINE_PLOT,   // hairline (zero-width) plot with n data points
+    STRESS_DASHED_LINE,     // stroked line with n dashes
+    STRESS_TEXT_WALL,       // wall of text with n characters
+    STRESS_CLIP_STACK,      // fill inside n nested clipping regions
+    STRESS_TYPE_COUNT
+};
+
+class StressScene
+{
+    int _width, _height;  // size of scene, in pixels
+    unsigned _seed;       // seed for pseudo-random number generator
+    unsigned _state;      // current generator state
+    TextApp *_txt;        // used to draw text
+
+    unsigned Random();
+    float RandomFloat(float lo, float hi);
+    COLOR RandomColor();
+    int DrawRandomPolygon(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+    int DrawStarPolygon(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+    int DrawHairlinePlot(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+    int DrawDashedLine(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+    int DrawTextWall(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+    int DrawClipStack(ShapeGen *sg, EnhancedRenderer *aarend, int n);
+
+public:
+    StressScene(int width, int height, unsigned seed = 1);
+    ~StressScene();
+    void SetSeed(unsigned seed) { _seed = seed; }
+    int Draw(ShapeGen *sg, EnhancedRenderer *aarend, STRESSTYPE type, int n);
+    static const char* GetName(STRESSTYPE type);
 };
 
 #endif // DEMO_H
@@ -0,0 +1,1208 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+//  displist.cpp:
+//    This file contains the implementation of the DisplayList and
+//    CancelToken classes declared in demo.h. A display list records
+//    a scene so that it can be rendered more than once, or rendered
+//    in several steps with a bounded amount of time spent in each.
+//
+//---------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include "demo.h"
+
+namespace {
+    // Number of points used by each type of path command (see DLCMD)
+    const int cmdpoints[] = { 1, 1, 2, 3, 2, 3, 0, 0 };
+
+    // Initial lengths of display list arrays
+    const int INITIAL_CMD_LENGTH = 256;
+    const int INITIAL_POINT_LENGTH = 512;
+    const int INITIAL_SHAPE_LENGTH = 64;
+
+    // Max number of opaque rectangles tracked by CullHiddenShapes
+    const int MAX_OCCLUDERS = 32;
+
+    //-------------------------------------------------------------------
+    //
+    // Doubles the length of a dynamically allocated array, and copies
+    // the contents of the old array to the new array. Returns true if
+    // successful, or false if out of memory.
+    //
+    //-------------------------------------------------------------------
+
+    template <class T> bool GrowArray(T*& array, int& len)
+    {
+        T *newarray = new T[2*len];
+
+        if (newarray == 0)
+        {
+            assert(newarray != 0);
+            return false;  // out of memory
+        }
+        memcpy(newarray, array, len*sizeof(T));
+        delete[] array;
+        array = newarray;
+        len += len;
+        return true;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Updates a 32-bit FNV-1a hash value with the specified bytes
+    //
+    //-------------------------------------------------------------------
+
+    unsigned HashBytes(unsigned hash, const void *bytes, int len)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(bytes);
+
+        for (int i = 0; i < len; ++i)
+        {
+            hash ^= p[i];
+            hash *= 16777619;
+        }
+        return hash;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Returns true if the two rectangles overlap or share an edge
+    //
+    //-------------------------------------------------------------------
+
+    bool IsTouching(const SGRect& a, const SGRect& b)
+    {
+        return (a.x <= b.x + b.w && b.x <= a.x + a.w &&
+                a.y <= b.y + b.h && b.y <= a.y + a.h);
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Returns the smallest rectangle that encloses both rectangles
+    //
+    //-------------------------------------------------------------------
+
+    SGRect UnionRect(const SGRect& a, const SGRect& b)
+    {
+        SGRect u;
+
+        u.x = min(a.x, b.x);
+        u.y = min(a.y, b.y);
+        u.w = max(a.x + a.w, b.x + b.w) - u.x;
+        u.h = max(a.y + a.h, b.y + b.h) - u.y;
+        return u;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Adds a rectangle to a list of dirty rectangles. Rectangles in the
+    // list never touch each other: a new rectangle that touches one or
+    // more rectangles in the list is merged with them. If the list is
+    // full, the new rectangle is merged with the rectangle in the list
+    // that grows the least in area as a result. Returns the updated
+    // number of rectangles in the list.
+    //
+    //-------------------------------------------------------------------
+
+    int AddDirtyRect(SGRect rect[], int count, int maxrects, SGRect r)
+    {
+        if (r.w <= 0 || r.h <= 0)
+            return count;
+
+        for (;;)
+        {
+            int k = -1;
+
+            for (int i = 0; i < count; ++i)
+                if (IsTouching(rect[i], r))
+                {
+                    k = i;
+                    break;
+                }
+
+            if (k < 0 && count == maxrects)
+            {
+                double mingrowth = 0;
+
+                for (int i = 0; i < count; ++i)
+                {
+                    SGRect u = UnionRect(rect[i], r);
+                    double growth = (double)u.w*u.h - (double)rect[i].w*rect[i].h;
+
+                    if (k < 0 || growth < mingrowth)
+                    {
+                        k = i;
+                        mingrowth = growth;
+                    }
+                }
+            }
+            if (k < 0)
+                break;
+
+            // Remove rectangle k from list and merge it with r
+            r = UnionRect(rect[k], r);
+            rect[k] = rect[--count];
+        }
+        rect[count++] = r;
+        return count;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Copies pixels from the source buffer to the destination buffer.
+    // If the two buffers differ in size, only the pixels in the region
+    // of overlap at the top-left corner of each buffer are copied.
+    //
+    //-------------------------------------------------------------------
+
+    void CopyPixels(const PIXEL_BUFFER& dst, const PIXEL_BUFFER& src)
+    {
+        int w = min(dst.width, src.width);
+        int h = min(dst.height, src.height);
+        char *pdst = reinterpret_cast<char*>(dst.pixels);
+        const char *psrc = reinterpret_cast<const char*>(src.pixels);
+
+        for (int i = 0; i < h; ++i)
+        {
+            memcpy(pdst, psrc, w*sizeof(COLOR));
+            pdst += dst.pitch;
+            psrc += src.pitch;
+        }
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Returns a solid color that approximates the specified paint. For
+    // a gradient, this color is the average of the gradient's color
+    // stops.
+    //
+    //-------------------------------------------------------------------
+
+    COLOR PreviewColor(const DLPAINT *paint)
+    {
+        if (paint->type == DLPAINT_COLOR || paint->nstops == 0)
+            return paint->color;
+
+        int n = paint->nstops;
+        int r = 0, g = 0, b = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            COLOR color = paint->stop[i].color;
+
+            r += color & 0xff;
+            g += (color >> 8) & 0xff;
+            b += (color >> 16) & 0xff;
+        }
+        return RGBX(r/n, g/n, b/n);
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// A DisplayList object records the path, the stroke attributes, and
+// the paint for each filled or stroked shape in a scene. The points in
+// a path are recorded as SGPoint values in the fixed-point format that
+// is specified to the constructor. When the scene is replayed, the
+// DisplayList object passes the same SGPoint values to the ShapeGen
+// object. Filled and stroked shapes that are constructed from the same
+// path share a single copy of the path in the display list.
+//
+//---------------------------------------------------------------------
+
+DisplayList::DisplayList(int fixbits) :
+               _fixbits(fixbits), _cmdlen(INITIAL_CMD_LENGTH),
+               _ptlen(INITIAL_POINT_LENGTH), _shapelen(INITIAL_SHAPE_LENGTH)
+{
+    _cmd = new char[_cmdlen];
+    _pt = new SGPoint[_ptlen];
+    _shape = new DLSHAPE[_shapelen];
+    assert(_cmd != 0 && _pt != 0 && _shape != 0);  // out of memory?
+    Reset();
+}
+
+DisplayList::~DisplayList()
+{
+    delete[] _cmd;
+    delete[] _pt;
+    delete[] _shape;
+}
+
+// Public function: Discards all recorded shapes, and restores all
+// attributes to their default values
+void DisplayList::Reset()
+{
+    _ncmds = _npts = _nshapes = 0;
+    _pathcmd = _pathpt = 0;
+    _fillrule = FILLRULE_DEFAULT;
+    memset(&_stroke, 0, sizeof(_stroke));
+    _stroke.linewidth = LINEWIDTH_DEFAULT;
+    _stroke.miterlimit = MITERLIMIT_DEFAULT;
+    _stroke.linejoin = LINEJOIN_DEFAULT;
+    _stroke.lineend = LINEEND_DEFAULT;
+    memset(&_paint, 0, sizeof(_paint));
+    _paint.type = DLPAINT_COLOR;
+    _paint.color = RGBX(0,0,0);
+    _paint.alpha = 255;
+    SetTransform(0);
+}
+
+// Private function: Appends a path command and its points to the
+// display list. Returns false if out of memory.
+bool DisplayList::AddCommand(DLCMD cmd, const SGPoint *xy, int npts)
+{
+    assert(cmdpoints[cmd] == npts);
+    if (_ncmds == _cmdlen && GrowArray(_cmd, _cmdlen) == false)
+        return false;
+
+    while (_npts + npts > _ptlen)
+        if (GrowArray(_pt, _ptlen) == false)
+            return false;
+
+    _cmd[_ncmds++] = cmd;
+    for (int i = 0; i < npts; ++i)
+        _pt[_npts++] = xy[i];
+
+    return true;
+}
+
+// Private function: Records a filled or stroked shape that uses the
+// current path, stroke attributes, and paint. The shape's bounding
+// box is calculated from the points in the path (including Bezier
+// control points), so it can be larger than the shape, but never
+// smaller. Returns false if the path is empty or out of memory.
+bool DisplayList::AddShape(bool bstroke)
+{
+    if (_pathpt == _npts)
+        return false;  // path is empty
+
+    if (_nshapes == _shapelen && GrowArray(_shape, _shapelen) == false)
+        return false;
+
+    DLSHAPE *shape = &_shape[_nshapes];
+    const SGPoint *p = &_pt[_pathpt];
+    double xmin = p->x, ymin = p->y, xmax = p->x, ymax = p->y;
+
+    for (int i = _pathcmd; i < _ncmds; ++i)
+    {
+        int npts = cmdpoints[_cmd[i]];
+
+        if (_cmd[i] == DLCMD_ELLIPSE)
+        {
+            // Center point +/- extents of conjugate diameters
+            double dx = abs(p[1].x - p[0].x) + abs(p[2].x - p[0].x);
+            double dy = abs(p[1].y - p[0].y) + abs(p[2].y - p[0].y);
+
+            xmin = min(xmin, p[0].x - dx);
+            ymin = min(ymin, p[0].y - dy);
+            xmax = max(xmax, p[0].x + dx);
+            ymax = max(ymax, p[0].y + dy);
+        }
+        else
+        {
+            for (int j = 0; j < npts; ++j)
+            {
+                xmin = min(xmin, p[j].x);
+                ymin = min(ymin, p[j].y);
+                xmax = max(xmax, p[j].x);
+                ymax = max(ymax, p[j].y);
+            }
+        }
+        p += npts;
+    }
+
+    // Convert bounding box to pixel units. Add a one-pixel margin for
+    // the fuzzy edges of antialiased shapes, and for stroked shapes,
+    // add enough padding for the widest possible line joins and caps.
+    double scale = 1.0/(1 << _fixbits);
+    double pad = 1.0;
+
+    if (bstroke)
+    {
+        float width = _stroke.linewidth;
+        if (_stroke.linejoin == LINEJOIN_MITER || _stroke.linejoin == LINEJOIN_SVG_MITER)
+            pad += sqrt(_stroke.miterlimit*_stroke.miterlimit + 1)*width/2;
+        else if (_stroke.lineend == LINEEND_SQUARE)
+            pad += 1.414213562373*width/2;
+        else
+            pad += width/2;
+    }
+    xmin = floor(scale*xmin - pad);
+    ymin = floor(scale*ymin - pad);
+    xmax = ceil(scale*xmax + pad);
+    ymax = ceil(scale*ymax + pad);
+    shape->bbox.x = xmin;
+    shape->bbox.y = ymin;
+    shape->bbox.w = xmax - xmin;
+    shape->bbox.h = ymax - ymin;
+
+    shape->bstroke = bstroke;
+    shape->fillrule = _fillrule;
+    shape->cmd = _pathcmd;
+    shape->ncmds = _ncmds - _pathcmd;
+    shape->pt = _pathpt;
+    shape->npts = _npts - _pathpt;
+    shape->stroke = _stroke;
+    shape->paint = _paint;
+    shape->hash = HashShape(shape);
+    ++_nshapes;
+    return true;
+}
+
+// Private function: Calculates a hash value for a recorded shape.
+// Only the path data, attributes, and paint parameters that actually
+// affect how the shape is drawn contribute to the hash value.
+unsigned DisplayList::HashShape(const DLSHAPE *shape)
+{
+    const DLPAINT *paint = &shape->paint;
+    unsigned hash = 2166136261;
+
+    hash = HashBytes(hash, &shape->bstroke, sizeof(shape->bstroke));
+    hash = HashBytes(hash, &_cmd[shape->cmd], shape->ncmds);
+    hash = HashBytes(hash, &_pt[shape->pt], shape->npts*sizeof(SGPoint));
+    if (shape->bstroke)
+    {
+        const DLSTROKE *stroke = &shape->stroke;
+
+        hash = HashBytes(hash, &stroke->linewidth, sizeof(stroke->linewidth));
+        hash = HashBytes(hash, &stroke->miterlimit, sizeof(stroke->miterlimit));
+        hash = HashBytes(hash, &stroke->linejoin, sizeof(stroke->linejoin));
+        hash = HashBytes(hash, &stroke->lineend, sizeof(stroke->lineend));
+        hash = HashBytes(hash, stroke->dash, strlen(stroke->dash));
+        if (stroke->dash[0] != 0)
+        {
+            hash = HashBytes(hash, &stroke->dashoffset, sizeof(stroke->dashoffset));
+            hash = HashBytes(hash, &stroke->dashmult, sizeof(stroke->dashmult));
+        }
+    }
+    else
+        hash = HashBytes(hash, &shape->fillrule, sizeof(shape->fillrule));
+
+    hash = HashBytes(hash, &paint->type, sizeof(paint->type));
+    hash = HashBytes(hash, &paint->alpha, sizeof(paint->alpha));
+    if (paint->type == DLPAINT_COLOR)
+        hash = HashBytes(hash, &paint->color, sizeof(paint->color));
+    else
+    {
+        hash = HashBytes(hash, paint->xform, sizeof(paint->xform));
+        hash = HashBytes(hash, paint->parm, sizeof(paint->parm));
+        hash = HashBytes(hash, &paint->spread, sizeof(paint->spread));
+        hash = HashBytes(hash, &paint->flags, sizeof(paint->flags));
+        hash = HashBytes(hash, paint->stop, paint->nstops*sizeof(COLOR_STOP));
+    }
+    return hash;
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions for recording paths. These functions mimic the
+// ShapeGen functions of the same names.
+//
+//---------------------------------------------------------------------
+
+void DisplayList::BeginPath()
+{
+    _pathcmd = _ncmds;
+    _pathpt = _npts;
+}
+
+void DisplayList::CloseFigure()
+{
+    AddCommand(DLCMD_CLOSEFIGURE, 0, 0);
+}
+
+void DisplayList::EndFigure()
+{
+    AddCommand(DLCMD_ENDFIGURE, 0, 0);
+}
+
+void DisplayList::Move(SGCoord x, SGCoord y)
+{
+    SGPoint xy = { x, y };
+
+    AddCommand(DLCMD_MOVE, &xy, 1);
+}
+
+bool DisplayList::Line(SGCoord x, SGCoord y)
+{
+    SGPoint xy = { x, y };
+
+    return AddCommand(DLCMD_LINE, &xy, 1);
+}
+
+bool DisplayList::Bezier2(const SGPoint& v1, const SGPoint& v2)
+{
+    SGPoint xy[2] = { v1, v2 };
+
+    return AddCommand(DLCMD_BEZIER2, xy, 2);
+}
+
+bool DisplayList::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
+{
+    SGPoint xy[3] = { v1, v2, v3 };
+
+    return AddCommand(DLCMD_BEZIER3, xy, 3);
+}
+
+void DisplayList::Rectangle(const SGRect& rect)
+{
+    SGPoint xy[2] = { { rect.x, rect.y }, { rect.x + rect.w, rect.y + rect.h } };
+
+    AddCommand(DLCMD_RECTANGLE, xy, 2);
+}
+
+void DisplayList::Ellipse(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2)
+{
+    SGPoint xy[3] = { v0, v1, v2 };
+
+    AddCommand(DLCMD_ELLIPSE, xy, 3);
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions for recording the attributes of filled and stroked
+// paths. These functions mimic the ShapeGen functions of the same
+// names, and affect only the shapes that are subsequently recorded.
+//
+//---------------------------------------------------------------------
+
+void DisplayList::SetFillRule(FILLRULE fillrule)
+{
+    _fillrule = fillrule;
+}
+
+void DisplayList::SetLineWidth(float width)
+{
+    _stroke.linewidth = width;
+}
+
+void DisplayList::SetMiterLimit(float mlim)
+{
+    _stroke.miterlimit = mlim;
+}
+
+void DisplayList::SetLineEnd(LINEEND capstyle)
+{
+    _stroke.lineend = capstyle;
+}
+
+void DisplayList::SetLineJoin(LINEJOIN joinstyle)
+{
+    _stroke.linejoin = joinstyle;
+}
+
+void DisplayList::SetLineDash(const char dash[], int offset, float mult)
+{
+    int len = (dash == 0) ? 0 : strlen(dash);
+
+    len = min(len, DASHARRAY_MAXLEN);
+    memset(_stroke.dash, 0, sizeof(_stroke.dash));
+    if (len != 0)
+        memcpy(_stroke.dash, dash, len);
+
+    _stroke.dashoffset = offset;
+    _stroke.dashmult = mult;
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions for recording paint. These functions mimic the
+// EnhancedRenderer functions of the same names. As in the renderer,
+// the color stops and transform must be specified before the call
+// that sets the gradient.
+//
+//---------------------------------------------------------------------
+
+void DisplayList::SetColor(COLOR color)
+{
+    _paint.type = DLPAINT_COLOR;
+    _paint.color = color;
+}
+
+void DisplayList::SetLinearGradient(float x0, float y0, float x1, float y1,
+                                    SPREAD_METHOD spread, int flags)
+{
+    _paint.type = DLPAINT_LINEAR_GRADIENT;
+    _paint.parm[0] = x0, _paint.parm[1] = y0;
+    _paint.parm[2] = x1, _paint.parm[3] = y1;
+    _paint.parm[4] = _paint.parm[5] = 0;
+    _paint.spread = spread;
+    _paint.flags = flags;
+}
+
+void DisplayList::SetRadialGradient(float x0, float y0, float r0,
+                                    float x1, float y1, float r1,
+                                    SPREAD_METHOD spread, int flags)
+{
+    _paint.type = DLPAINT_RADIAL_GRADIENT;
+    _paint.parm[0] = x0, _paint.parm[1] = y0, _paint.parm[2] = r0;
+    _paint.parm[3] = x1, _paint.parm[4] = y1, _paint.parm[5] = r1;
+    _paint.spread = spread;
+    _paint.flags = flags;
+}
+
+void DisplayList::AddColorStop(float offset, COLOR color)
+{
+    if (_paint.nstops < STOPARRAY_MAXLEN)
+    {
+        _paint.stop[_paint.nstops].offset = offset;
+        _paint.stop[_paint.nstops].color = color;
+        ++_paint.nstops;
+    }
+}
+
+void DisplayList::ResetColorStops()
+{
+    memset(_paint.stop, 0, sizeof(_paint.stop));
+    _paint.nstops = 0;
+}
+
+void DisplayList::SetTransform(const float xform[6])
+{
+    const float identity[6] = { 1, 0, 0, 1, 0, 0 };
+
+    memcpy(_paint.xform, (xform == 0) ? identity : xform, sizeof(_paint.xform));
+}
+
+void DisplayList::SetConstantAlpha(COLOR alpha)
+{
+    _paint.alpha = alpha;
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions for recording filled and stroked shapes. Each call
+// records a shape that is constructed from the current path (that is,
+// the path started by the most recent BeginPath call). Returns false
+// if the path is empty.
+//
+//---------------------------------------------------------------------
+
+bool DisplayList::FillPath()
+{
+    return AddShape(false);
+}
+
+bool DisplayList::StrokePath()
+{
+    return AddShape(true);
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions for replaying the shapes in a display list
+//
+//---------------------------------------------------------------------
+
+// Returns a pointer to the recorded shape specified by the index
+// parameter, or null if the index is out of range
+const DLSHAPE* DisplayList::GetShape(int index)
+{
+    if (index < 0 || _nshapes <= index)
+        return 0;
+
+    return &_shape[index];
+}
+
+// Constructs the path for the specified shape, and sets the fill
+// rule or the stroke attributes that are used to draw the shape
+bool DisplayList::BuildPath(int index, ShapeGen *sg)
+{
+    const DLSHAPE *shape = GetShape(index);
+
+    if (shape == 0 || sg == 0)
+    {
+        assert(shape != 0 && sg != 0);
+        return false;
+    }
+
+    const SGPoint *p = &_pt[shape->pt];
+
+    sg->SetFixedBits(_fixbits);
+    sg->BeginPath();
+    for (int i = shape->cmd; i < shape->cmd + shape->ncmds; ++i)
+    {
+        SGRect rect;
+
+        switch (_cmd[i])
+        {
+        case DLCMD_MOVE:
+            sg->Move(p[0].x, p[0].y);
+            break;
+        case DLCMD_LINE:
+            sg->Line(p[0].x, p[0].y);
+            break;
+        case DLCMD_BEZIER2:
+            sg->Bezier2(p[0], p[1]);
+            break;
+        case DLCMD_BEZIER3:
+            sg->Bezier3(p[0], p[1], p[2]);
+            break;
+        case DLCMD_RECTANGLE:
+            rect.x = p[0].x;
+            rect.y = p[0].y;
+            rect.w = p[1].x - p[0].x;
+            rect.h = p[1].y - p[0].y;
+            sg->Rectangle(rect);
+            break;
+        case DLCMD_ELLIPSE:
+            sg->Ellipse(p[0], p[1], p[2]);
+            break;
+        case DLCMD_CLOSEFIGURE:
+            sg->CloseFigure();
+            break;
+        case DLCMD_ENDFIGURE:
+            sg->EndFigure();
+            break;
+        default:
+            assert(0);
+            break;
+        }
+        p += cmdpoints[_cmd[i]];
+    }
+    if (shape->bstroke)
+    {
+        const DLSTROKE *stroke = &shape->stroke;
+
+        sg->SetLineWidth(stroke->linewidth);
+        sg->SetMiterLimit(stroke->miterlimit);
+        sg->SetLineJoin(stroke->linejoin);
+        sg->SetLineEnd(stroke->lineend);
+        if (stroke->dash[0] != 0)
+            sg->SetLineDash(stroke->dash, stroke->dashoffset, stroke->dashmult);
+        else
+            sg->SetLineDash(0,0,0);
+    }
+    else
+        sg->SetFillRule(shape->fillrule);
+
+    return true;
+}
+
+// Loads the paint for the specified shape into the renderer
+bool DisplayList::SetPaint(int index, EnhancedRenderer *aarend)
+{
+    const DLSHAPE *shape = GetShape(index);
+
+    if (shape == 0 || aarend == 0)
+    {
+        assert(shape != 0 && aarend != 0);
+        return false;
+    }
+
+    const DLPAINT *paint = &shape->paint;
+    const float *parm = paint->parm;
+
+    aarend->SetConstantAlpha(paint->alpha);
+    switch (paint->type)
+    {
+    case DLPAINT_COLOR:
+        aarend->SetColor(paint->color);
+        break;
+    case DLPAINT_LINEAR_GRADIENT:
+    case DLPAINT_RADIAL_GRADIENT:
+        aarend->ResetColorStops();
+        for (int i = 0; i < paint->nstops; ++i)
+            aarend->AddColorStop(paint->stop[i].offset, paint->stop[i].color);
+
+        aarend->SetTransform(paint->xform);
+        if (paint->type == DLPAINT_LINEAR_GRADIENT)
+            aarend->SetLinearGradient(parm[0], parm[1], parm[2], parm[3],
+                                      paint->spread, paint->flags);
+        else
+            aarend->SetRadialGradient(parm[0], parm[1], parm[2],
+                                      parm[3], parm[4], parm[5],
+                                      paint->spread, paint->flags);
+        break;
+    default:
+        assert(0);
+        return false;
+    }
+    return true;
+}
+
+// Draws the specified shape. Returns false if nothing was drawn
+// (for example, if the shape was canceled).
+bool DisplayList::DrawShape(int index, ShapeGen *sg, EnhancedRenderer *aarend)
+{
+    if (BuildPath(index, sg) == false || SetPaint(index, aarend) == false)
+        return false;
+
+    return (_shape[index].bstroke) ? sg->StrokePath() : sg->FillPath();
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Draws the shapes in the display list, starting at
+// the shape specified by the 'first' parameter, and returns the index
+// of the next shape to be drawn. This index equals the GetCount value
+// if all remaining shapes have been drawn. If the optional 'cancel'
+// parameter is not null, the function checks for cancellation before
+// drawing each shape, and also passes the callback to the ShapeGen
+// object so that a very large shape can be canceled partway through.
+// A canceled shape is discarded without being drawn, so that a later
+// Render call can resume the scene at the shape that was canceled.
+// To guarantee forward progress, the first shape drawn by each call
+// is never canceled.
+//
+//---------------------------------------------------------------------
+
+int DisplayList::Render(ShapeGen *sg, EnhancedRenderer *aarend,
+                        int first, CancelCallback *cancel)
+{
+    CancelCallback *oldcancel = sg->SetCancelCallback(0);
+    int index;
+
+    first = max(first, 0);
+    for (index = first; index < _nshapes; ++index)
+    {
+        bool bcancel = (index != first && cancel != 0);
+
+        if (bcancel)
+        {
+            if (cancel->QueryCancel())
+                break;
+
+            sg->SetCancelCallback(cancel);
+        }
+        if (DrawShape(index, sg, aarend) == false &&
+            bcancel && cancel->QueryCancel())
+        {
+            break;  // shape was canceled before it could be drawn
+        }
+    }
+    sg->SetCancelCallback(oldcancel);
+    return index;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Determines whether the specified shape is a filled
+// rectangle that is painted with a fully opaque solid color. If so,
+// the function returns true, and sets the 'rect' parameter to the
+// bounding box of the pixels that the rectangle completely covers.
+// These pixels are overwritten by the rectangle regardless of what
+// was drawn in them earlier.
+//
+//---------------------------------------------------------------------
+
+bool DisplayList::GetOpaqueRect(const DLSHAPE *shape, SGRect *rect)
+{
+    const DLPAINT *paint = &shape->paint;
+
+    if (shape->bstroke || paint->type != DLPAINT_COLOR ||
+        paint->alpha != 255 || (paint->color >> 24) != 255)
+    {
+        return false;
+    }
+
+    // The path must contain a single rectangle. A trailing CloseFigure
+    // or EndFigure command is harmless.
+    const char *cmd = &_cmd[shape->cmd];
+
+    if (cmd[0] != DLCMD_RECTANGLE)
+        return false;
+
+    for (int i = 1; i < shape->ncmds; ++i)
+        if (cmd[i] != DLCMD_CLOSEFIGURE && cmd[i] != DLCMD_ENDFIGURE)
+            return false;
+
+    // Shrink the rectangle to the pixels that it fully covers
+    const SGPoint *p = &_pt[shape->pt];
+    double scale = 1.0/(1 << _fixbits);
+    double xmin = ceil(scale*min(p[0].x, p[1].x));
+    double ymin = ceil(scale*min(p[0].y, p[1].y));
+    double xmax = floor(scale*max(p[0].x, p[1].x));
+    double ymax = floor(scale*max(p[0].y, p[1].y));
+
+    if (xmin >= xmax || ymin >= ymax)
+        return false;  // covers no whole pixels
+
+    rect->x = xmin;
+    rect->y = ymin;
+    rect->w = xmax - xmin;
+    rect->h = ymax - ymin;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Removes shapes that are completely hidden behind
+// opaque shapes that are drawn later in the scene. The function walks
+// the display list from back to front (last shape to first), and
+// collects the opaque, solid-color rectangle fills that it finds (see
+// GetOpaqueRect). A shape is removed if its bounding box lies entirely
+// inside a rectangle that is drawn after it. Only the MAX_OCCLUDERS
+// largest rectangles are tracked, so the culling is conservative: it
+// can miss hidden shapes, but it never removes a visible one. The
+// paths of removed shapes remain in the display list. Returns the
+// number of shapes that were removed.
+//
+//---------------------------------------------------------------------
+
+int DisplayList::CullHiddenShapes()
+{
+    SGRect occluder[MAX_OCCLUDERS];
+    int noccluders = 0;
+    int count = 0;
+
+    for (int index = _nshapes - 1; index >= 0; --index)
+    {
+        const SGRect& bbox = _shape[index].bbox;
+        bool bhidden = false;
+
+        for (int i = 0; i < noccluders; ++i)
+        {
+            const SGRect& r = occluder[i];
+
+            if (r.x <= bbox.x && bbox.x + bbox.w <= r.x + r.w &&
+                r.y <= bbox.y && bbox.y + bbox.h <= r.y + r.h)
+            {
+                bhidden = true;
+                break;
+            }
+        }
+        if (bhidden)
+        {
+            // Mark the hidden shape as removed
+            _shape[index].npts = 0;
+            ++count;
+            continue;
+        }
+
+        SGRect rect;
+
+        if (GetOpaqueRect(&_shape[index], &rect) == false)
+            continue;
+
+        if (noccluders < MAX_OCCLUDERS)
+            occluder[noccluders++] = rect;
+        else
+        {
+            // Replace the smallest occluder if the new one is larger
+            int k = 0;
+            double area = (double)rect.w*rect.h;
+
+            for (int i = 1; i < MAX_OCCLUDERS; ++i)
+                if ((double)occluder[i].w*occluder[i].h <
+                    (double)occluder[k].w*occluder[k].h)
+                {
+                    k = i;
+                }
+
+            if ((double)occluder[k].w*occluder[k].h < area)
+                occluder[k] = rect;
+        }
+    }
+
+    // Squeeze the removed shapes out of the shape array
+    if (count != 0)
+    {
+        int n = 0;
+
+        for (int i = 0; i < _nshapes; ++i)
+            if (_shape[i].npts != 0)
+                _shape[n++] = _shape[i];
+
+        _nshapes = n;
+    }
+    return count;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Returns true if the shape specified by the index
+// parameter is drawn identically to the specified shape in another
+// display list. Two shapes are treated as identical if their hash
+// values and bounding boxes are the same.
+//
+//---------------------------------------------------------------------
+
+bool DisplayList::IsSameShape(int index, DisplayList *other, int otherindex)
+{
+    const DLSHAPE *a = &_shape[index];
+    const DLSHAPE *b = &other->_shape[otherindex];
+
+    return (a->hash == b->hash && _fixbits == other->_fixbits &&
+            a->bbox.x == b->bbox.x && a->bbox.y == b->bbox.y &&
+            a->bbox.w == b->bbox.w && a->bbox.h == b->bbox.h);
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Compares this display list (the current frame) to
+// the display list for the previous frame, and finds the regions of
+// the frame that must be redrawn. The shapes in the two lists are
+// compared in order. Identical shapes at the start and end of the two
+// lists are skipped, and the remaining shapes are compared pairwise.
+// The bounding boxes of shapes that were added, removed, or changed
+// are merged into a list of dirty rectangles, which is written to the
+// 'rect' array. The dirty rectangles never overlap each other, and
+// there are never more than 'maxrects' of them. If the 'prev' parameter
+// is null, every shape in the current frame is treated as new. Returns
+// the number of dirty rectangles (zero if the frames are identical).
+//
+//---------------------------------------------------------------------
+
+int DisplayList::FindDirtyRects(DisplayList *prev, SGRect rect[], int maxrects)
+{
+    if (rect == 0 || maxrects < 1)
+    {
+        assert(rect != 0 && maxrects > 0);
+        return 0;  // invalid parameter value
+    }
+
+    int n0 = (prev == 0) ? 0 : prev->_nshapes;
+    int n1 = _nshapes;
+    int head = 0, tail = 0;
+    int count = 0;
+
+    while (head < n0 && head < n1 && IsSameShape(head, prev, head))
+        ++head;
+
+    while (tail < n0 - head && tail < n1 - head &&
+           IsSameShape(n1 - 1 - tail, prev, n0 - 1 - tail))
+    {
+        ++tail;
+    }
+    for (int i = head; i < n0 - tail || i < n1 - tail; ++i)
+    {
+        bool bold = (i < n0 - tail), bnew = (i < n1 - tail);
+
+        if (bold && bnew && IsSameShape(i, prev, i))
+            continue;
+
+        if (bold)
+            count = AddDirtyRect(rect, count, maxrects, prev->_shape[i].bbox);
+
+        if (bnew)
+            count = AddDirtyRect(rect, count, maxrects, _shape[i].bbox);
+    }
+    return count;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Redraws one rectangular region of a frame that was
+// previously drawn in the back buffer. Parameter cliprect is the
+// clipping rectangle that was used to draw the full frame. Its x-y
+// coordinates are the scroll position. Parameter rect is the region to
+// redraw (for example, a dirty rectangle from FindDirtyRects), and is
+// clipped to cliprect. The region is first filled with the background
+// color, bkcolor, and then every shape that overlaps the region is
+// redrawn. Drawing is done through a sub-buffer that covers only the
+// region, with the scroll position adjusted so that the pixels in the
+// region are identical to the pixels in a full redraw of the frame.
+// Returns false if the region lies outside cliprect or if out of
+// memory.
+//
+//---------------------------------------------------------------------
+
+bool DisplayList::RenderRegion(const PIXEL_BUFFER& bkbuf, const SGRect& cliprect,
+                               const SGRect& rect, COLOR bkcolor)
+{
+    SGRect region;
+
+    region.x = max(rect.x, cliprect.x);
+    region.y = max(rect.y, cliprect.y);
+    region.w = min(rect.x + rect.w, cliprect.x + cliprect.w) - region.x;
+    region.h = min(rect.y + rect.h, cliprect.y + cliprect.h) - region.y;
+    if (region.w <= 0 || region.h <= 0)
+        return false;  // region is outside clipping rectangle
+
+    // Set up a sub-buffer that maps the region into the back buffer
+    PIXEL_BUFFER subbuf = bkbuf;
+    char *p = reinterpret_cast<char*>(bkbuf.pixels);
+
+    p += (region.y - cliprect.y)*bkbuf.pitch;
+    p += (region.x - cliprect.x)*sizeof(COLOR);
+    subbuf.pixels = reinterpret_cast<COLOR*>(p);
+    subbuf.width = region.w;
+    subbuf.height = region.h;
+    for (int i = 0; i < region.h; ++i)
+    {
+        COLOR *row = reinterpret_cast<COLOR*>(p + i*bkbuf.pitch);
+
+        for (int j = 0; j < region.w; ++j)
+            row[j] = bkcolor;
+    }
+
+    // The region's x-y coordinates become the scroll position
+    EnhancedRenderer *aarend = CreateEnhancedRenderer(&subbuf);
+    ShapeGen *sg = (aarend == 0) ? 0 : CreateShapeGen(aarend, region);
+
+    if (sg == 0)
+    {
+        delete aarend;
+        return false;  // out of memory
+    }
+    for (int index = 0; index < _nshapes; ++index)
+        if (IsTouching(_shape[index].bbox, region))
+            DrawShape(index, sg, aarend);
+
+    delete sg;
+    delete aarend;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// A ProgressiveRenderer object renders a display list in two passes.
+// The preview pass uses a coarse flatness setting and a simple renderer
+// that does no antialiasing or alpha blending, paints gradients with
+// solid colors, and skips shapes that are too small to see clearly.
+// The refinement pass draws the scene at full quality in an offscreen
+// buffer, and then copies the result to the back buffer. So that the
+// two passes draw over the same background, the constructor copies
+// the original contents of the back buffer to the offscreen buffer.
+// Call DrawPreview first, and then call Refine until it returns true.
+//
+//---------------------------------------------------------------------
+
+ProgressiveRenderer::ProgressiveRenderer(DisplayList *dlist,
+                                         const PIXEL_BUFFER& bkbuf,
+                                         const SGRect& cliprect) :
+                       _dlist(dlist), _bkbuf(bkbuf), _cliprect(cliprect),
+                       _aarend(0), _sg(0), _next(0)
+{
+    memset(&_offbuf, 0, sizeof(_offbuf));
+    if (dlist == 0 || cliprect.w > bkbuf.width || cliprect.h > bkbuf.height)
+    {
+        assert(dlist != 0);
+        assert(cliprect.w <= bkbuf.width && cliprect.h <= bkbuf.height);
+        return;  // fail - invalid parameter value
+    }
+    _offbuf.pixels = AllocateRawPixels(cliprect.w, cliprect.h);
+    if (_offbuf.pixels == 0)
+        return;  // fail - out of memory
+
+    _offbuf.width = cliprect.w;
+    _offbuf.height = cliprect.h;
+    _offbuf.depth = 32;
+    _offbuf.pitch = cliprect.w*sizeof(COLOR);
+    CopyPixels(_offbuf, _bkbuf);
+    _aarend = CreateEnhancedRenderer(&_offbuf);
+    _sg = CreateShapeGen(_aarend, cliprect);
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    delete _sg;
+    delete _aarend;
+    DeleteRawPixels(_offbuf.pixels);
+}
+
+// Public function: Draws the preview of the scene directly to the back
+// buffer. Parameter flatness is the flatness setting for curves (see
+// ShapeGen::SetFlatness). Shapes that are less than minsize pixels in
+// both width and height are skipped, as are fully transparent shapes.
+// Returns the number of shapes drawn.
+int ProgressiveRenderer::DrawPreview(float flatness, int minsize)
+{
+    if (_dlist == 0)
+        return 0;  // constructor failed
+
+    SmartPtr<SimpleRenderer> rend(CreateSimpleRenderer(&_bkbuf));
+    SmartPtr<ShapeGen> sg(CreateShapeGen(&(*rend), _cliprect));
+    int count = 0;
+
+    sg->SetFlatness(flatness);
+    for (int i = 0; i < _dlist->GetCount(); ++i)
+    {
+        const DLSHAPE *shape = _dlist->GetShape(i);
+
+        // Bounding boxes include a one-pixel margin on each side
+        if (shape->paint.alpha == 0 ||
+            (shape->bbox.w - 2 < minsize && shape->bbox.h - 2 < minsize))
+        {
+            continue;
+        }
+        _dlist->BuildPath(i, &(*sg));
+        rend->SetColor(PreviewColor(&shape->paint));
+        if (shape->bstroke)
+            sg->StrokePath();
+        else
+            sg->FillPath();
+
+        ++count;
+    }
+    return count;
+}
+
+// Public function: Continues the refinement pass, starting where the
+// previous Refine call left off. The optional cancel parameter limits
+// the time spent in this call (see DisplayList::Render). Returns true
+// if the refinement pass is finished and the full-quality image has
+// been copied to the back buffer; otherwise, returns false.
+bool ProgressiveRenderer::Refine(CancelCallback *cancel)
+{
+    if (_sg == 0)
+        return true;  // constructor failed, so nothing left to do
+
+    if (_next < _dlist->GetCount())
+    {
+        _next = _dlist->Render(_sg, _aarend, _next, cancel);
+        if (_next < _dlist->GetCount())
+            return false;  // refinement pass is not yet finished
+
+        CopyPixels(_bkbuf, _offbuf);
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// A CancelToken object can cancel a rendering operation in two ways:
+// the application can call the Cancel function (for example, from
+// another thread), or it can set a deadline. The deadline is measured
+// with the Standard C Library's clock function, which measures the
+// processor time used by the program. This time closely tracks the
+// elapsed time while the program is busy rendering.
+//
+//---------------------------------------------------------------------
+
+// Public function: Sets a deadline that expires msec milliseconds
+// from the current time
+void CancelToken::SetDeadline(int msec)
+{
+    _deadline = clock() + (long)msec*CLOCKS_PER_SEC/1000;
+    _bdeadline = true;
+}
+
+// Public function: Clears the deadline and any pending cancellation
+void CancelToken::Reset()
+{
+    _bcancel = false;
+    _bdeadline = false;
+}
+
+// Public function: Implements the CancelCallback interface
+bool CancelToken::QueryCancel()
+{
+    return (_bcancel || (_bdeadline && clock() >= _deadline));
+}
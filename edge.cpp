@@ -30,8 +30,20 @@
 //
 //---------------------------------------------------------------------
 
-#include "shapepri.h"
+#include "simd.h"
+#include "pipeline.h"
+#include "trace.h"
 #include <stdlib.h>
+#include <float.h>
+
+// AttachEdges calculates edge slopes four at a time with SSE2. Packed
+// division is correctly rounded, as is scalar division, so the results
+// match those of MakeEdge only if scalar float expressions are also
+// evaluated in single precision (and not, say, on the x87 stack)
+#if defined(SG_USE_SSE2) && !defined(SGFIXEDPOINT) && \
+    (defined(_M_X64) || (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0))
+#define SG_SIMD_SLOPES
+#endif
 
 #define sign(x)   ((x)<0?-1:1)       // sign (plus or minus) of value
 
@@ -53,21 +65,19 @@ namespace {
 
     //---------------------------------------------------------------------
     //
-    // A qsort comparison function that helps sort a list of edges in
-    // ascending-x order (based on the xtop values). (We assume that all
-    // the edges in the list share the same ytop value, so we don't bother
-    // to sort on ytop here.) If two edges have equal xtop values, these
-    // edges are sorted in order of ascending dxdy values. And if the two
-    // edges have both xtop and dxdy values that match, they are sorted
-    // in order of their descending dy values.
+    // Compares two edges to determine their order in a list of edges
+    // sorted in ascending-x order (based on the xtop values). (We assume
+    // that all the edges in the list share the same ytop value, so we
+    // don't bother to sort on ytop here.) If two edges have equal xtop
+    // values, these edges are sorted in order of ascending dxdy values.
+    // And if the two edges have both xtop and dxdy values that match,
+    // they are sorted in order of their descending dy values. Returns a
+    // positive value if edge p follows edge q in the sorted list.
     //
     //----------------------------------------------------------------------
 
-    int xcomp(const void *key1, const void *key2)
+    inline int xorder(const EDGE *p, const EDGE *q)
     {
-        EDGE *p = *(EDGE**)key1;
-        EDGE *q = *(EDGE**)key2;
-
         if (p->xtop != q->xtop)
             return (p->xtop - q->xtop);
 
@@ -77,23 +87,32 @@ namespace {
         return (q->dy - p->dy);  // sort coincident edges
     }
 
+    // A qsort comparison function that helps sort a list of edges in
+    // ascending-x order
+    int xcomp(const void *key1, const void *key2)
+    {
+        return xorder(*(EDGE**)key1, *(EDGE**)key2);
+    }
+
     //---------------------------------------------------------------------
     //
     // Uses the qsort function in stdlib.h to sort items in a singly linked
     // EDGE list. Parameter plist points to the head of the list. Parameter
     // length is the number of items in the list. Parameter comp is the
-    // comparison function. The sortlist function returns a pointer to the
-    // head of the new, sorted list.
+    // comparison function. Parameter alloc supplies the temporary pointer
+    // array. The sortlist function returns a pointer to the head of the
+    // new, sorted list.
     //
     //---------------------------------------------------------------------
 
-    EDGE* sortlist(EDGE *plist, int length, int (*comp)(const void *, const void *))
+    EDGE* sortlist(EDGE *plist, int length, int (*comp)(const void *, const void *),
+                   Allocator *alloc)
     {
         if (length < 2)
             return plist;
 
         int i, count = 0;
-        EDGE **ptr = new EDGE*[length];  // pointer array for qsort
+        EDGE **ptr = static_cast<EDGE**>(alloc->Allocate(length*sizeof(EDGE*)));
 
         assert(ptr);  // out of memory?
         for (EDGE *p = plist; p; p = p->next)
@@ -106,7 +125,7 @@ namespace {
 
         ptr[i-1]->next = 0;
         EDGE *tmp = ptr[0];
-        delete[] ptr;
+        alloc->Free(ptr);
         return tmp;
     }
 
@@ -153,6 +172,175 @@ namespace {
         }
         return head;
     }
+
+    //---------------------------------------------------------------------
+    //
+    // Priority queue of the points at which pairs of adjacent edges in
+    // the x-sorted list in the NormalizeEdges function intersect. Each
+    // entry identifies a pair of converging edges, edgeL and edgeR, and
+    // the y coordinate, ycross, of the first scan line at which edgeL is
+    // no longer to the left of edgeR. The entries are kept in a binary
+    // min-heap that is ordered by ycross. An entry is added only when
+    // two edges become adjacent in the x-sorted list. While the edges
+    // stay adjacent, ycross for the pair does not change. When they
+    // stop being adjacent (an edge is inserted between them, one of
+    // them ends, or they trade places), their entry is not removed
+    // right away. Instead, such stale entries are discarded when they
+    // reach the top of the heap, or when the heap array is full.
+    //
+    //---------------------------------------------------------------------
+
+    struct XING
+    {
+        int ycross;   // y coordinate at which edges intersect
+        EDGE *edgeL;  // left edge of the pair of adjacent edges
+        EDGE *edgeR;  // right edge of the pair
+    };
+
+    class XingQueue
+    {
+        Allocator *_alloc;  // supplies memory for heap array
+        XING *_heap;    // heap array
+        int _count;     // number of entries in heap
+        int _maxcount;  // length of heap array
+
+        // An entry is stale if its edges are no longer adjacent in the
+        // x-sorted list, or if either edge has ended (dy is zero)
+        bool IsStale(const XING& x)
+        {
+            return (x.edgeL->next != x.edgeR || x.edgeL->dy == 0 || x.edgeR->dy == 0);
+        }
+        void SiftDown(int i);
+        void Grow();
+
+    public:
+        XingQueue(Allocator *alloc) :
+            _alloc(alloc), _heap(0), _count(0), _maxcount(0)
+        {
+        }
+        ~XingQueue()
+        {
+            if (_heap != 0)
+                _alloc->Free(_heap);
+        }
+        void AddPair(EDGE *p, EDGE *q, int yscan);
+        bool GetNextCrossing(int *ycross);
+    };
+
+    // Adds an entry for newly adjacent edges p and q, which both have
+    // ytop == yscan, to the queue if the two edges intersect. Edge p is
+    // to the left of edge q. A band in NormalizeEdges never extends
+    // below the bottom of either edge, and is never more than BIGVAL16
+    // high, so an intersection that's farther away is ignored. This
+    // test needs no division, and it keeps most pairs of edges out of
+    // the queue.
+    inline void XingQueue::AddPair(EDGE *p, EDGE *q, int yscan)
+    {
+        FIX16 ddx = p->dxdy - q->dxdy;
+
+        if (ddx <= 0)
+            return;  // edges don't converge
+
+        FIX16 xdist = q->xtop - p->xtop;
+        int hmax = min(abs(p->dy), abs(q->dy));
+
+        hmax = min(hmax, BIGVAL16);
+        if (xdist >= (long long)(hmax - 1)*ddx)
+            return;  // too far away to limit band height
+
+        if (_count == _maxcount)
+            Grow();
+
+        // Sift the new entry up from the bottom of the heap
+        XING x = { yscan + 1 + xdist/ddx, p, q };
+        int i = _count++;
+
+        while (i > 0)
+        {
+            int parent = (i - 1)/2;
+
+            if (_heap[parent].ycross <= x.ycross)
+                break;
+
+            _heap[i] = _heap[parent];
+            i = parent;
+        }
+        _heap[i] = x;
+    }
+
+    // Discards any stale entries at the top of the queue. Then, if the
+    // queue isn't empty, writes the y coordinate of the nearest
+    // intersection to *ycross and returns true. Otherwise, returns false.
+    bool XingQueue::GetNextCrossing(int *ycross)
+    {
+        while (_count > 0 && IsStale(_heap[0]))
+        {
+            _heap[0] = _heap[--_count];
+            SiftDown(0);
+        }
+        if (_count == 0)
+            return false;
+
+        *ycross = _heap[0].ycross;
+        return true;
+    }
+
+    // Moves the entry at index i down the heap to its proper place
+    void XingQueue::SiftDown(int i)
+    {
+        XING x = _heap[i];
+
+        for (;;)
+        {
+            int child = 2*i + 1;
+
+            if (child >= _count)
+                break;
+
+            if (child + 1 < _count && _heap[child + 1].ycross < _heap[child].ycross)
+                ++child;
+
+            if (x.ycross <= _heap[child].ycross)
+                break;
+
+            _heap[i] = _heap[child];
+            i = child;
+        }
+        _heap[i] = x;
+    }
+
+    // Makes room in the full heap array. First, discards all stale
+    // entries and rebuilds the heap. If the array is still more than
+    // half full, replaces it with an array twice as long.
+    void XingQueue::Grow()
+    {
+        int count = 0;
+
+        for (int i = 0; i < _count; ++i)
+        {
+            if (!IsStale(_heap[i]))
+                _heap[count++] = _heap[i];
+        }
+        _count = count;
+        for (int i = _count/2 - 1; i >= 0; --i)
+            SiftDown(i);
+
+        if (2*_count < _maxcount)
+            return;
+
+        int maxcount = (_maxcount != 0) ? 2*_maxcount : 64;
+        XING *heap = static_cast<XING*>(_alloc->Allocate(maxcount*sizeof(XING)));
+
+        assert(heap);  // out of memory?
+        for (int i = 0; i < _count; ++i)
+            heap[i] = _heap[i];
+
+        if (_heap != 0)
+            _alloc->Free(_heap);
+
+        _heap = heap;
+        _maxcount = maxcount;
+    }
 }  // end namespace
 
 //---------------------------------------------------------------------
@@ -161,19 +349,23 @@ namespace {
 //
 //---------------------------------------------------------------------
 
-POOL::POOL(int len) : blklen(len), watermark(0), index(0), count(0)
+POOL::POOL(Allocator *allocator, int len) :
+             alloc(allocator), blklen(len), watermark(0), index(0), count(0),
+             usage()
 {
-    block = new EDGE[blklen];
+    block = static_cast<EDGE*>(alloc->Allocate(blklen*sizeof(EDGE)));
     // TODO: Replace assert below with out-of-memory exception
     assert(block);
+    usage.Add(blklen*sizeof(EDGE));
     memset(inventory, 0, ARRAY_LEN(inventory)*sizeof(EDGE*));
 }
 
 POOL::~POOL()
 {
-    delete[] block;
+    if (block != 0)
+        alloc->Free(block);
     for (int i = 0; i < index; ++i)
-        delete[] inventory[i];
+        alloc->Free(inventory[i]);
 }
 
 // Public function: Allocates an EDGE structure
@@ -191,6 +383,28 @@ EDGE* POOL::Allocate(EDGE *p)
     return q;
 }
 
+// Public function: Reserves 'len' contiguous EDGE structures at the
+// top of the pool, but does not yet allocate them. The caller fills
+// in as many of these structures as it needs, and then calls Commit
+// to allocate them. No other pool allocations can intervene. The
+// 'len' parameter must not exceed INITIAL_POOL_LENGTH.
+EDGE* POOL::Reserve(int len)
+{
+    assert(len <= INITIAL_POOL_LENGTH);
+    if (blklen - watermark < len)  // not enough room left in block?
+        AcquireBlock();  // acquire more pool memory
+
+    return &block[watermark];
+}
+
+// Public function: Allocates the first 'len' EDGE structures that
+// were reserved by the most recent Reserve call
+void POOL::Commit(int len)
+{
+    assert(watermark + len <= blklen);
+    watermark += len;
+}
+
 // Private function: Acquires more storage when pool is exhausted
 void POOL::AcquireBlock()
 {
@@ -199,10 +413,11 @@ void POOL::AcquireBlock()
     inventory[index++] = block;
     count += blklen;
     blklen += blklen;  // new block is 2x size of old block
-    block = new EDGE[blklen];
+    block = static_cast<EDGE*>(alloc->Allocate(blklen*sizeof(EDGE)));
 
     // TODO: Replace assert below with out-of-memory exception
     assert(block != 0);  // out of memory?
+    usage.Add(blklen*sizeof(EDGE));
     watermark = 0;
 }
 
@@ -215,52 +430,16 @@ void POOL::Reset()
         EDGE *swap = block;  block = inventory[0];  inventory[0] = swap;
         for (int i = 0; i < index; ++i)
         {
-            delete[] inventory[i];
+            alloc->Free(inventory[i]);
             inventory[i] = 0;
             blklen = blklen/2;
         }
         index = count = 0;
+        usage.current = blklen*sizeof(EDGE);  // only first block remains
     }
     watermark = 0;
 }
 
-//---------------------------------------------------------------------
-//
-// Shape feeder: Breaks a shape (stored as a normalized edge list) into
-// smaller pieces to feed to a renderer
-//
-//---------------------------------------------------------------------
-
-class Feeder : ShapeFeeder
-{
-    friend EdgeMgr;
-
-    EDGE *_list, *_edgeL, *_edgeR;
-    FIX16 _xL, _xR, _dxL, _dxR;
-    int _ytop, _height;
-
-protected:
-    Feeder() : _list(0), _edgeL(0), _edgeR(0), _ytop(0),
-               _height(0), _xL(0), _xR(0), _dxL(0), _dxR(0)
-    {
-    }
-    ~Feeder()
-    {
-    }
-    void SetEdgeList(EDGE *list, int yshift)
-    {
-        if (yshift < 16)
-            _list = list;  // antialiasing
-        else
-            _edgeL = list;  // no antialiasing
-    }
-
-public:
-    bool GetNextGDIRect(SGRect *rect);
-    bool GetNextSDLRect(SGRect *rect);
-    bool GetNextSGSpan(SGSpan *span);
-};
-
 //---------------------------------------------------------------------
 //
 // Public function: Gets the next rectangle for the renderer to fill.
@@ -269,7 +448,10 @@ public:
 // function returns true to indicate that it has successfully
 // retrieved a rectangle, or it returns false to indicate that
 // no more rectangles are available (because the shape is complete).
-// The x-y coordinates in each rectangle are integer values.
+// The x-y coordinates in each rectangle are integer values. Successive
+// rows in a trapezoid that have the same integer x extents are merged
+// into a single rectangle, so that the renderer can fill them as a
+// block.
 //
 //---------------------------------------------------------------------
 
@@ -305,15 +487,21 @@ bool Feeder::GetNextSDLRect(SGRect *rect)
         }
     }
 
-    // Send next span to renderer
-    rect->x  = _xL >> 16;
-    rect->w = (_xR >> 16) - rect->x;
+    // Send next span to renderer, merged with any spans below it
+    int xleft = _xL >> 16, xright = _xR >> 16;
+
+    rect->x  = xleft;
+    rect->w = xright - xleft;
     rect->y = _ytop;
-    rect->h = 1;
-    _xL += _dxL;
-    _xR += _dxR;
-    ++_ytop;
-    if (--_height == 0)
+    do
+    {
+        _xL += _dxL;
+        _xR += _dxR;
+        ++_ytop;
+    } while (--_height != 0 && (_xL >> 16) == xleft && (_xR >> 16) == xright);
+
+    rect->h = _ytop - rect->y;
+    if (_height == 0)
         _edgeL = _edgeR->next;
 
     return true;
@@ -322,7 +510,8 @@ bool Feeder::GetNextSDLRect(SGRect *rect)
 //---------------------------------------------------------------------
 //
 // This version fills in the members of the SGRect structure as though
-// it was a Windows GDI RECT structure
+// it was a Windows GDI RECT structure. As in GetNextSDLRect, rows with
+// the same integer x extents are merged into a single rectangle.
 //
 //---------------------------------------------------------------------
 
@@ -358,73 +547,20 @@ bool Feeder::GetNextGDIRect(SGRect *rect)
         }
     }
 
-    // Send next span to renderer
+    // Send next span to renderer, merged with any spans below it
     rect->x = _xL >> 16;  // RECT.left
     rect->w = _xR >> 16;  // RECT.right
     rect->y = _ytop;      // RECT.top
-    rect->h = _ytop + 1;  // RECT.bottom
-    _xL += _dxL;
-    _xR += _dxR;
-    ++_ytop;
-    if (--_height == 0)
-        _edgeL = _edgeR->next;
-
-    return true;
-}
-
-//---------------------------------------------------------------------
-//
-// This version fills in the members of the SGSpan structure, which
-// describes a subpixel span in an A-buffer. This function is called
-// by a renderer that supports antialiasing.
-//
-//---------------------------------------------------------------------
-
-bool Feeder::GetNextSGSpan(SGSpan *span)
-{
-    if (_list == 0 && _edgeL == 0)
-        return false;
-
-    // Are any more trapezoids left in the current scan line?
-    if (_edgeL == 0)
+    do
     {
-        // No, the next trapezoid starts on a new scan line
-        int yscan = _list->ytop;
-        EDGE *p = _list, *q = 0;
-
-        do
-        {
-            q = p->next;
-            p = q->next;
-        } while (p != 0 && yscan == p->ytop);
-        _edgeL = _list;
-        _list = p;
-        q->next = 0;
-    }
-
-    // Detach topmost span from the next trapezoid in this scan line
-    _edgeR = _edgeL->next;
-    span->xL = _edgeL->xtop;
-    span->xR = _edgeR->xtop;
-    span->y = _edgeL->ytop;
+        _xL += _dxL;
+        _xR += _dxR;
+        ++_ytop;
+    } while (--_height != 0 && (_xL >> 16) == rect->x && (_xR >> 16) == rect->w);
 
-    // Are there more spans left in this trapezoid?
-    if (_edgeL->dy > 1)
-    {
-        // Yes, update and save remainder of this trapezoid
-        _edgeL->ytop = _edgeR->ytop += 1;
-        _edgeL->dy -= 1;
-        _edgeR->dy += 1;
-        _edgeL->xtop += _edgeL->dxdy;
-        _edgeR->xtop += _edgeR->dxdy;
-
-        EDGE *tmp = _edgeL;
+    rect->h = _ytop;      // RECT.bottom
+    if (_height == 0)
         _edgeL = _edgeR->next;
-        _edgeR->next = _list;
-        _list = tmp;
-    }
-    else
-        _edgeL = _edgeR->next;  // discard empty trapezoid
 
     return true;
 }
@@ -435,16 +571,18 @@ bool Feeder::GetNextSGSpan(SGSpan *span)
 //
 //---------------------------------------------------------------------
 
-EdgeMgr::EdgeMgr() : _renderer(0)
+EdgeMgr::EdgeMgr(Allocator *alloc) : _alloc(alloc), _renderer(0), _aarend(0)
 {
     // TODO: Replace assert below with out-of-memory exception
-    _inpool = new POOL;
-    _outpool = new POOL;
-    _clippool = new POOL;
-    _rendpool = new POOL;
-    _savepool = new POOL;
+    _inpool = new POOL(alloc);
+    _outpool = new POOL(alloc);
+    _clippool = new POOL(alloc);
+    _rendpool = new POOL(alloc);
+    _savepool = new POOL(alloc);
     assert(_inpool != 0 && _outpool != 0 && _clippool != 0 &&
            _rendpool != 0 && _savepool != 0);  // out of memory?
+    _gmin.x = _gmin.y = -65536*BIGVAL16;
+    _gmax.x = _gmax.y = 65536*BIGVAL16;
 }
 
 EdgeMgr::~EdgeMgr()
@@ -475,6 +613,7 @@ bool EdgeMgr::SetRenderer(Renderer *renderer)
     _ybias = FIX_BIAS >> yres;
     _yhalf = _ybias + 1;
     _renderer = renderer;
+    _aarend = renderer->QueryAA4x8Renderer();
     return true;
 }
 
@@ -548,6 +687,106 @@ bool EdgeMgr::SwapClipRegion()
     return (_cliplist.head != 0);
 }
 
+//---------------------------------------------------------------------
+//
+// Protected function: Reports the current and peak sizes of the five
+// edge pools in the corresponding members of the 'report' structure
+//
+//---------------------------------------------------------------------
+
+void EdgeMgr::GetPoolUsage(SGMEMREPORT *report)
+{
+    report->inpool = _inpool->GetUsage();
+    report->outpool = _outpool->GetUsage();
+    report->clippool = _clippool->GetUsage();
+    report->rendpool = _rendpool->GetUsage();
+    report->savepool = _savepool->GetUsage();
+}
+
+//---------------------------------------------------------------------
+//
+// Protected function: Releases pool memory after a spike in usage.
+// Each pool that holds more than 'threshold' bytes is shrunk. A pool
+// that holds no live edges is simply reset to its initial block. The
+// pools that hold the current and saved clipping regions are compacted
+// instead. The _rendpool edges are no longer needed once the renderer
+// has drawn the shape, so this pool is always treated as idle. This
+// function must not be called during a fill or stroke operation.
+// Returns the number of bytes released.
+//
+//---------------------------------------------------------------------
+
+size_t EdgeMgr::TrimPools(size_t threshold)
+{
+    POOL *idle[3] = { _inpool, _outpool, _rendpool };
+    bool bempty[3] = { _inlist.head == 0, _outlist.head == 0, true };
+    size_t released = 0;
+
+    _rendlist.head = _rendlist.tail = 0;
+    for (int i = 0; i < ARRAY_LEN(idle); ++i)
+    {
+        size_t size = idle[i]->GetUsage().current;
+
+        if (bempty[i] && size > threshold)
+        {
+            idle[i]->Reset();
+            released += size - idle[i]->GetUsage().current;
+        }
+    }
+    released += CompactPool(&_clippool, &_cliplist, threshold);
+    released += CompactPool(&_savepool, &_savelist, threshold);
+    return released;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Compacts a pool that holds a live edge list. If
+// the pool holds more than 'threshold' bytes, and if a new pool could
+// hold the list in less memory, the function copies the edges in the
+// list to a new pool, and then deletes the old pool. Returns the
+// number of bytes released.
+//
+//---------------------------------------------------------------------
+
+size_t EdgeMgr::CompactPool(POOL **pool, EDGELIST *list, size_t threshold)
+{
+    size_t oldsize = (*pool)->GetUsage().current;
+    int count = 0, blklen = INITIAL_POOL_LENGTH, total = blklen;
+
+    if (oldsize <= threshold)
+        return 0;
+
+    for (EDGE *p = list->head; p != 0; p = p->next)
+        ++count;
+
+    while (total < count)
+    {
+        blklen += blklen;  // same growth rule as POOL::AcquireBlock
+        total += blklen;
+    }
+    if (total*sizeof(EDGE) >= oldsize)
+        return 0;  // compacting won't release any memory
+
+    POOL *newpool = new POOL(_alloc);
+    if (newpool == 0)
+    {
+        assert(newpool != 0);
+        return 0;  // out of memory
+    }
+    if (list->head != 0)
+    {
+        EDGE *p = list->head;
+
+        list->head = list->tail = newpool->Allocate(p);
+        for (p = p->next; p != 0; p = p->next)
+            list->tail = list->tail->next = newpool->Allocate(p);
+    }
+    newpool->CopyPeak(*pool);
+    delete *pool;
+    *pool = newpool;
+    return oldsize - newpool->GetUsage().current;
+}
+
 //---------------------------------------------------------------------
 //
 // Protected function: Reverses the direction of each edge in the
@@ -580,6 +819,22 @@ void EdgeMgr::TranslateEdges(int x, int y)
     }
 }
 
+//---------------------------------------------------------------------
+//
+// Protected function: Sets the limits of the guard band that surrounds
+// the device clipping rectangle. Parameters gmin and gmax are the top-
+// left and bottom-right corners of the guard band, in the same 16.16
+// fixed-point coordinates as the path. The AttachEdge and AttachEdges
+// functions clip new edges to the guard band.
+//
+//---------------------------------------------------------------------
+
+void EdgeMgr::SetGuardBand(const VERT16& gmin, const VERT16& gmax)
+{
+    _gmin = gmin;
+    _gmax = gmax;
+}
+
 //---------------------------------------------------------------------
 //
 // Protected function: Clips the newly created normalized edge list in
@@ -590,6 +845,8 @@ void EdgeMgr::TranslateEdges(int x, int y)
 
 void EdgeMgr::ClipEdges(FILLRULE fillrule)
 {
+    TRACE_SCOPE("ClipEdges");
+
     assert(_inlist.head == 0 && (_inpool->GetCount() == 0));
     assert(fillrule == FILLRULE_INTERSECT || fillrule == FILLRULE_EXCLUDE);
 
@@ -745,7 +1002,11 @@ bool EdgeMgr::FillEdgeList()
     _outlist.head = 0;
     _outpool->Reset();
     iter.SetEdgeList(_rendlist.head, _yshift);
-    _renderer->RenderShape(&iter);
+    if (_aarend != 0)
+        RenderShapeStatic(_aarend, &iter);  // statically bound
+    else
+        _renderer->RenderShape(&iter);
+
     return true;
 }
 
@@ -820,24 +1081,28 @@ void EdgeMgr::SetDeviceClipRectangle(int width, int height, bool bsave)
 // rule. The polygon may contain holes, disjoint regions, and boundary
 // self-intersections. The path manager is responsible for ensuring
 // that all figures are closed, which means that the number of edges
-// intersected by any scan line is always even, and never odd.
+// intersected by any scan line is always even, and never odd. If the
+// optional cancel parameter is not null, the function polls it before
+// processing each band, and returns false if the operation has been
+// canceled; otherwise, the function returns true.
 //
 //----------------------------------------------------------------------
 
-void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
+bool EdgeMgr::NormalizeEdges(FILLRULE fillrule, CancelCallback *cancel)
 {
-    int y, h, length, yscan, wind;
-    FIX16 xdist, ddx;
-    EDGE *p, *q, *ylist, *xlist, head;
+    int i, j, y, h, hmin, length, count, maxcount, yscan, wind;
+    EDGE *p, *q, *ylist, *xlist, *newlist, **active, head;
+    bool bnew, bprevnew, bsorted, bgap;
+    TRACE_SCOPE("NormalizeEdges");
 
     if (_inlist.head == 0)
-        return;  // nothing to do here
+        return true;  // nothing to do here
 
     if (_cliplist.head == 0)
     {
         _inlist.head = 0;
         _inpool->Reset();
-        return;  // nothing to do here
+        return true;  // nothing to do here
     }
 
     // When a path is initially converted to a list of edges for a
@@ -846,61 +1111,109 @@ void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
     {
         assert(_outlist.head == 0 && _outpool->GetCount() == 0);
         length = _inpool->GetCount();
-        _inlist.head = sortlist(_inlist.head, length, ycomp);
+        _inlist.head = sortlist(_inlist.head, length, ycomp, _alloc);
     }
 
     // Partition the polygon into a list of non-overlapping trapezoids.
     // The trapezoids will be produced in major order from top (minimum
     // y) to bottom, and in minor order from left (minimum x) to right.
     // Each iteration of the while-loop below produces a band of one or
-    // more trapezoids that all have the same ytop value.
+    // more trapezoids that all have the same ytop value. The x-sorted
+    // list of active edges (the edges that cross the current band) is
+    // kept from one band to the next, and the intersections of adjacent
+    // edges in this list are tracked in a priority queue. The list has
+    // to be updated only where edges start, end, or intersect.
 
+    XingQueue xing(_alloc);
     ylist = _inlist.head;
     xlist = 0;
-    while (ylist != 0)
+    active = 0;  // array used to re-sort the x-sorted list
+    maxcount = count = 0;
+    hmin = BIGVAL16;
+    while (xlist != 0 || ylist != 0)
     {
-        yscan = ylist->ytop;  // y coordinate at current scan line
+        // Before each band, give the caller a chance to cancel. If
+        // the operation is canceled, discard all edges and trapezoids.
+        if (cancel != 0 && cancel->QueryCancel())
+        {
+            if (active != 0)
+                _alloc->Free(active);
+
+            _inlist.head = 0;
+            _inpool->Reset();
+            _outlist.head = 0;
+            _outpool->Reset();
+            return false;
+        }
+
+        yscan = (xlist != 0) ? xlist->ytop : ylist->ytop;
 
         // Starting at the head of the y-sorted list, remove each edge
-        // for which ytop == yscan. Set height h to the minimum height
-        // of these edges. Form a new, x-sorted list from these edges.
+        // for which ytop == yscan. Reduce height hmin, if necessary, to
+        // the minimum height of these edges. Sort these new edges in
+        // ascending-x order, and merge them into the x-sorted list.
+        // Each pair of edges that the merge makes adjacent is added to
+        // the queue of intersections.
 
-        h = BIGVAL16;
-        p = ylist;
-        length = 0;
-        do
+        if (ylist != 0 && ylist->ytop == yscan)
         {
-            h = min(h, abs(p->dy));
-            q = p->next;    // number of edges is always even
-            h = min(h, abs(q->dy));
-            length += 2;
-        } while ((p = q->next) != 0 && p->ytop == yscan);
-        q->next = 0;
-        xlist = sortlist(ylist, length, xcomp);
-        ylist = p;
+            p = ylist;
+            length = 0;
+            do
+            {
+                hmin = min(hmin, abs(p->dy));
+                q = p;
+                ++length;
+            } while ((p = p->next) != 0 && p->ytop == yscan);
+            q->next = 0;
+            newlist = sortlist(ylist, length, xcomp, _alloc);
+            ylist = p;
+            count += length;
+
+            p = xlist;
+            q = &head;
+            bprevnew = false;
+            while (p != 0 || newlist != 0)
+            {
+                EDGE *r;
+
+                bnew = (p == 0 || (newlist != 0 && xorder(newlist, p) < 0));
+                if (bnew)
+                {
+                    r = newlist;
+                    newlist = newlist->next;
+                }
+                else
+                {
+                    r = p;
+                    p = p->next;
+                }
+                if (q != &head && (bnew || bprevnew))
+                    xing.AddPair(q, r, yscan);
+
+                q->next = r;
+                q = r;
+                bprevnew = bnew;
+            }
+            q->next = 0;
+            xlist = head.next;
+        }
 
         // The x-sorted list contains a band of trapezoids of height h.
         // The number of edges in a band is always even. If the top of
         // the first edge in the y-sorted list intrudes into the band,
         // reduce the band's height h just enough to exclude this edge.
+        // If any pair of adjacent edges in the x-sorted list intersect,
+        // decrease height h to exclude the point of intersection.
 
+        h = hmin;
         if (ylist != 0)
             h = min(h, ylist->ytop - yscan);
 
-        // If any pair of adjacent edges in the x-sorted list intersect,
-        // decrease height h to exclude the point of intersection. Don't
-        // bother checking further if h reaches its minimum value of 1.
-
-        p = xlist;
-        while ((q = p->next) != 0 && h > 1)
-        {
-            ddx = p->dxdy - q->dxdy;
-            xdist = q->xtop - p->xtop;
-            if (ddx > 0 && xdist < (h - 1)*ddx)
-                h = 1 + xdist/ddx;
+        if (xing.GetNextCrossing(&y))
+            h = min(h, y - yscan);
 
-            p = q;
-        }
+        assert(h > 0);
 
         // Use the specified fill rule to identify the non-overlapping
         // trapezoids within the current band. These trapezoids will be
@@ -960,35 +1273,175 @@ void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
         // The trapezoids in the current band were just saved to the
         // output list. Now, for each edge in the x-sorted list, cut
         // off and discard the portion of the edge that lies within
-        // the current band. Save any of the remaining edges in the
-        // x-sorted list that are of nonzero height.
+        // the current band. Keep any of the remaining edges in the
+        // x-sorted list that are of nonzero height, and set hmin to
+        // the minimum height of these edges. Where edges are removed
+        // from the list, the edges on either side become adjacent,
+        // and are added to the queue of intersections.
 
         p = xlist;
         q = &head;
         yscan += h;
+        hmin = BIGVAL16;
+        bsorted = true;
+        bgap = false;
+        count = 0;
         do
         {
             p->dy -= (p->dy < 0) ? -h : h;
-            if (p->dy != 0)
+            if (p->dy == 0)
             {
-                p->xtop += h*(p->dxdy);
-                p->ytop = yscan;
-                q->next = p;
-                q = p;
+                bgap = true;
+                continue;
             }
+            p->xtop += h*(p->dxdy);
+            p->ytop = yscan;
+            hmin = min(hmin, abs(p->dy));
+            if (q != &head)
+            {
+                if (xorder(q, p) > 0)
+                    bsorted = false;
+                else if (bgap)
+                    xing.AddPair(q, p, yscan);
+            }
+            q->next = p;
+            q = p;
+            bgap = false;
+            ++count;
         } while ((p = p->next) != 0);
+        q->next = 0;
+        xlist = head.next;
 
-        // All edges remaining in the x-sorted list have the same ytop
-        // value. Insert this list at the head of the y-sorted list.
+        // Any edges that intersect at the bottom of the band are now
+        // out of order, but only by a few places, so an insertion sort
+        // restores the ascending-x order. Then rebuild the x-sorted
+        // list. Each pair of edges that was not adjacent before is
+        // added to the queue of intersections.
 
-        if (q != &head)
+        if (!bsorted)
         {
-            q->next = ylist;
-            ylist = head.next;
+            if (maxcount < count)
+            {
+                if (active != 0)
+                    _alloc->Free(active);
+
+                maxcount = max(count, 2*maxcount);
+                active = static_cast<EDGE**>(_alloc->Allocate(maxcount*sizeof(EDGE*)));
+                assert(active);  // out of memory?
+            }
+            for (i = 0, p = xlist; p != 0; p = p->next)
+                active[i++] = p;
+
+            for (i = 1; i < count; ++i)
+            {
+                p = active[i];
+                for (j = i; j > 0 && xorder(active[j-1], p) > 0; --j)
+                    active[j] = active[j-1];
+
+                active[j] = p;
+            }
+            for (i = 1; i < count; ++i)
+            {
+                p = active[i-1];
+                q = active[i];
+                if (p->next != q)
+                {
+                    p->next = q;
+                    xing.AddPair(p, q, yscan);
+                }
+            }
+            active[count-1]->next = 0;
+            xlist = active[0];
         }
     }
+    if (active != 0)
+        _alloc->Free(active);
+
     _inlist.head = 0;
     _inpool->Reset();
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Does the integer part of converting a directed
+// line segment (taken from a path) to a polygonal edge. Input
+// parameters v1 and v2 specify the 16.16 fixed-point x-y coordinates
+// of the line's start and end points, respectively. The function sets
+// the ytop and dy members of the EDGE structure pointed to by p, sets
+// the xtop member to the x coordinate of the edge's top vertex, and
+// passes back pointers to the top and bottom vertices. The caller
+// must finish the edge by setting its dxdy member and adding the x
+// offset to xtop. Returns false (and leaves the structure unchanged)
+// if the edge is horizontal and can be discarded.
+//
+//----------------------------------------------------------------------
+
+inline bool EdgeMgr::SetupEdge(EDGE *p, const VERT16 *v1, const VERT16 *v2,
+                               const VERT16 **vtop, const VERT16 **vbot)
+{
+    int j = (v1->y + _ybias) >> _yshift;
+    int k = (v2->y + _ybias) >> _yshift;
+    int dy = k - j;
+
+    // If edge is horizontal (j == k), discard it and return
+    if (dy == 0)
+        return false;
+
+    // Identify top and bottom vertices on current edge
+    if (dy > 0)
+    {
+        *vtop = v1;
+        *vbot = v2;
+        p->ytop = j;
+    }
+    else
+    {
+        *vtop = v2;
+        *vbot = v1;
+        p->ytop = k;
+    }
+    p->dy = dy;  // sign of dy indicates edge up/down direction
+    p->xtop = (*vtop)->x;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Converts a directed line segment (taken from a
+// path) to a polygonal edge. Input parameters v1 and v2 specify the
+// 16.16 fixed-point x-y coordinates of the line's start and end
+// points, respectively. The function writes the edge to the EDGE
+// structure pointed to by p, but does not set its 'next' member.
+// Returns false (and leaves the structure unchanged) if the edge is
+// horizontal and can be discarded.
+//
+//----------------------------------------------------------------------
+
+inline bool EdgeMgr::MakeEdge(EDGE *p, const VERT16 *v1, const VERT16 *v2)
+{
+    const VERT16 *vtop, *vbot;
+
+    if (!SetupEdge(p, v1, v2, &vtop, &vbot))
+        return false;
+
+    // Prepare to snip off any small tip of the edge that lies
+    // above the topmost scanline that intersects the edge
+#ifdef SGFIXEDPOINT
+    long long dx = (long long)vbot->x - vtop->x;
+    long long ylen = (long long)vbot->y - vtop->y;
+    FIX16 xgap = dx*((p->ytop << _yshift) + _yhalf - vtop->y)/ylen;
+
+    p->dxdy = dx*(1 << _yshift)/ylen;
+#else
+    float dx = vbot->x - vtop->x;
+    float dxdy = dx/(vbot->y - vtop->y);
+    FIX16 xgap = dxdy*((p->ytop << _yshift) + _yhalf - vtop->y);
+
+    p->dxdy = dxdy*(1 << _yshift);
+#endif
+    p->xtop = p->xtop + xgap + FIX_BIAS;
+    return true;
 }
 
 //---------------------------------------------------------------------
@@ -1002,43 +1455,185 @@ void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
 
 void EdgeMgr::AttachEdge(const VERT16 *v1, const VERT16 *v2)
 {
-    int j = (v1->y + _ybias) >> _yshift;
-    int k = (v2->y + _ybias) >> _yshift;
-    int dy = k - j;
+    EDGE edge;
 
-    // If edge is horizontal (j == k), discard it and return
-    if (dy)
+    if (!IsInsideGuardBand(v1) || !IsInsideGuardBand(v2))
+    {
+        ClipEdge(v1, v2);
+        return;
+    }
+    if (MakeEdge(&edge, v1, v2))
+    {
+        // Create new EDGE structure and insert at head of _inlist.head
+        EDGE *p = _inpool->Allocate(&edge);
+        p->next = _inlist.head;
+        _inlist.head = p;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Adds the edge from point v1 to point v2 to the
+// input edge list after clipping the edge to the guard band. Any parts
+// of the edge that lie outside the guard band are projected onto the
+// boundary of the guard band. Because each end point is always
+// projected to the same place, the clipped edges of a closed figure
+// still connect, and the figure's coverage (and winding numbers)
+// inside the guard band are unchanged.
+//
+//---------------------------------------------------------------------
+
+void EdgeMgr::ClipEdge(const VERT16 *v1, const VERT16 *v2)
+{
+    double dx = (double)v2->x - v1->x;
+    double dy = (double)v2->y - v1->y;
+    double t[5], tx[4];
+    int n = 0;
+    VERT16 p, q;
+
+    // Find the parametric values (0 < t < 1) at which the edge
+    // crosses the four boundaries of the guard band
+    tx[0] = (dx == 0) ? 0 : ((double)_gmin.x - v1->x)/dx;
+    tx[1] = (dx == 0) ? 0 : ((double)_gmax.x - v1->x)/dx;
+    tx[2] = (dy == 0) ? 0 : ((double)_gmin.y - v1->y)/dy;
+    tx[3] = (dy == 0) ? 0 : ((double)_gmax.y - v1->y)/dy;
+    for (int i = 0; i < 4; ++i)
     {
-        VERT16 vtop, vbot;
-        int ymin;
+        if (tx[i] <= 0 || 1 <= tx[i])
+            continue;
 
-        // Identify top and bottom vertices on current edge
-        if (dy > 0)
+        // Insertion sort of parametric values in ascending order
+        int j = n++;
+        for ( ; j > 0 && t[j-1] > tx[i]; --j)
+            t[j] = t[j-1];
+
+        t[j] = tx[i];
+    }
+    t[n++] = 1;
+
+    // Each piece of the edge between two crossings lies entirely
+    // inside or outside each guard band boundary, so the piece is
+    // clipped simply by clipping its end points
+    p.x = min(max(v1->x, _gmin.x), _gmax.x);
+    p.y = min(max(v1->y, _gmin.y), _gmax.y);
+    for (int i = 0; i < n; ++i)
+    {
+        FIX16 x = (t[i] == 1) ? v2->x : floor(v1->x + t[i]*dx + 0.5);
+        FIX16 y = (t[i] == 1) ? v2->y : floor(v1->y + t[i]*dy + 0.5);
+        EDGE edge;
+
+        q.x = min(max(x, _gmin.x), _gmax.x);
+        q.y = min(max(y, _gmin.y), _gmax.y);
+        if (MakeEdge(&edge, &p, &q))
         {
-            vtop = *v1;
-            vbot = *v2;
-            ymin = j;
+            EDGE *e = _inpool->Allocate(&edge);
+            e->next = _inlist.head;
+            _inlist.head = e;
         }
-        else
+        p = q;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Protected function: Converts the line segments that connect a
+// series of 'n' points (taken from a path) to polygonal edges, and
+// adds them to the input edge list. If 'closed' is true, the first
+// edge connects the last point to the first point, and the remaining
+// n-1 edges connect the points in order. Otherwise, only the n-1
+// edges between successive points are added. The edges are produced
+// in the same order, and with the same values, as a series of
+// AttachEdge calls, but the pool storage for up to EDGE_BATCH_LEN
+// edges is reserved at a time, instead of one edge at a time, and
+// where SSE2 is available, the slopes of four edges are calculated
+// at a time.
+//
+//----------------------------------------------------------------------
+
+void EdgeMgr::AttachEdges(const VERT16 *verts, int n, bool closed)
+{
+    if (n < 2)
+        return;
+
+    const VERT16 *v1 = (closed) ? &verts[n-1] : &verts[0];
+    const VERT16 *v2 = (closed) ? &verts[0] : &verts[1];
+    int nedges = (closed) ? n : n - 1;
+
+    // If any of the points lie outside the guard band, let the
+    // AttachEdge function clip the edges one at a time
+    for (int i = 0; i < n; ++i)
+    {
+        if (!IsInsideGuardBand(&verts[i]))
         {
-            vtop = *v2;
-            vbot = *v1;
-            ymin = k;
+            for (; nedges > 0; --nedges)
+            {
+                AttachEdge(v1, v2);
+                v1 = v2++;
+            }
+            return;
         }
+    }
 
-        // Prepare to snip off any small tip of the edge that lies
-        // above the topmost scanline that intersects the edge
-        float dx = vbot.x - vtop.x;
-        float dxdy = dx/(vbot.y - vtop.y);
-        FIX16 xgap = dxdy*((ymin << _yshift) + _yhalf - vtop.y);
+    while (nedges > 0)
+    {
+        int len = min(nedges, EDGE_BATCH_LEN);
+        EDGE *p = _inpool->Reserve(len);
+        int count = 0, i = 0;
+
+#ifdef SG_SIMD_SLOPES
+        // Set up the next four edges, pack the ones that aren't
+        // horizontal into the lanes of the SSE registers, and then
+        // finish these edges as MakeEdge does
+        __m128 yscale = _mm_set1_ps(static_cast<float>(1 << _yshift));
+        for (; i + 4 <= len; i += 4)
+        {
+            EDGE *q = &p[count];
+            int dx[4] = { 0, 0, 0, 0 }, ylen[4] = { 1, 1, 1, 1 };
+            int ygap[4] = { 0, 0, 0, 0 }, xgap[4], dxdy[4];
+            int nkeep = 0;
 
-        // Create new EDGE structure and insert at head of _inlist.head
-        EDGE *p = _inpool->Allocate();
-        p->ytop = ymin;
-        p->dy = dy;  // sign of dy indicates edge up/down direction
-        p->xtop = vtop.x + xgap + FIX_BIAS;
-        p->dxdy = dxdy*(1 << _yshift);
-        p->next = _inlist.head;
-        _inlist.head = p;
+            for (int k = 0; k < 4; ++k)
+            {
+                const VERT16 *vtop, *vbot;
+
+                if (SetupEdge(&q[nkeep], v1, v2, &vtop, &vbot))
+                {
+                    dx[nkeep] = vbot->x - vtop->x;
+                    ylen[nkeep] = vbot->y - vtop->y;
+                    ygap[nkeep] = (q[nkeep].ytop << _yshift) + _yhalf - vtop->y;
+                    ++nkeep;
+                }
+                v1 = v2++;
+            }
+            __m128 fdx = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<__m128i*>(dx)));
+            __m128 flen = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<__m128i*>(ylen)));
+            __m128 fgap = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<__m128i*>(ygap)));
+            __m128 slope = _mm_div_ps(fdx, flen);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(xgap),
+                             _mm_cvttps_epi32(_mm_mul_ps(slope, fgap)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dxdy),
+                             _mm_cvttps_epi32(_mm_mul_ps(slope, yscale)));
+            for (int k = 0; k < nkeep; ++k)
+            {
+                q[k].dxdy = dxdy[k];
+                q[k].xtop = q[k].xtop + xgap[k] + FIX_BIAS;
+                q[k].next = _inlist.head;
+                _inlist.head = &q[k];
+            }
+            count += nkeep;
+        }
+#endif
+        for (; i < len; ++i)
+        {
+            if (MakeEdge(&p[count], v1, v2))
+            {
+                p[count].next = _inlist.head;
+                _inlist.head = &p[count++];
+            }
+            v1 = v2++;
+        }
+        _inpool->Commit(count);
+        nedges -= len;
     }
 }
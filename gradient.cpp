@@ -29,7 +29,8 @@
 #include <math.h>
 #include <string.h>
 #include <assert.h>
-#include "renderer.h"
+#include "pipeline.h"
+#include "trace.h"
 
 // Color-stop array element (with rgba split into ga and rb)
 struct STOP_COLOR
@@ -50,6 +51,9 @@ class ColorStops
     STOP_COLOR _stop[STOPARRAY_MAXLEN+1];
     int _stopCount, _stopIndex;
     STOP_COLOR _tminStop, _tmaxStop;
+#ifdef SGFIXEDPOINT
+    long long _tscale;  // 0x0000ffff/(tmax - tmin) in 16.16 format
+#endif
 
     int SetColorStop(int index, FIX16 offset, COLOR color);
 
@@ -222,6 +226,9 @@ COLOR ColorStops::GetColorValue(FIX16 t, COLOR opacity)
         }
         _tminStop = _stop[k-1];
         _tmaxStop = _stop[k];
+#ifdef SGFIXEDPOINT
+        _tscale = (0x0000ffffLL << 16)/max(_tmaxStop.offset - _tminStop.offset, 1);
+#endif
     }
 
     // Linearly interpolate between the two cached color stops on
@@ -232,8 +239,12 @@ COLOR ColorStops::GetColorValue(FIX16 t, COLOR opacity)
     if ((ga1 | ga2) == 0)
         return 0;  // pixel is transparent
 
+#ifdef SGFIXEDPOINT
+    FIX16 s = ((t - _tminStop.offset)*_tscale) >> 16;
+#else
     float width = _tmaxStop.offset - _tminStop.offset;
     FIX16 s = 0x0000ffff*((t - _tminStop.offset)/width);
+#endif
     s >>= 8;
     COLOR rb1 = _tminStop.rb;
     COLOR rb2 = _tmaxStop.rb;
@@ -278,13 +289,29 @@ class LinearGrad : public LinearGradient
     COLOR _endColor;        // ending color if SPREAD_PAD
     int _xscroll, _yscroll; // scroll position coordinates
     bool _bSpecial;         // special case x0==x1 and y0==y1
+    bool _bVertical;        // dt/dx = 0, so color is constant along a row
+    bool _bHorizontal;      // dt/dy = 0, so all rows have the same colors
+    COLOR *_rowbuf;         // cached row of colors for horizontal gradient
+    int _rowlen;            // length of _rowbuf array
+    int _rowxs, _rowcount;  // x and length of cached colors in _rowbuf
 
     // These values are constant over the lifetime of the object
     float _dtdx;  // partial derivative dt/dx
     float _dtdy;  // partial derivative dt/dy
+#ifdef SGFIXEDPOINT
+    long long _t00;     // t at pixel (0,0) in 32.32 fixed-point format
+    long long _dtdx32;  // dt/dx in 32.32 fixed-point format
+    long long _dtdy32;  // dt/dy in 32.32 fixed-point format
+
+    COLOR GetColor(long long t, COLOR opacity);
+#else
+    COLOR GetColor(float t, COLOR opacity);
+#endif
+    COLOR ScaleColor(COLOR color, COLOR opacity);
+    bool FillRowBuffer(int xs, int len);
 
 public:
-    LinearGrad() : _cstops(0)
+    LinearGrad() : _cstops(0), _rowbuf(0)
     {
         assert(_cstops != 0);
     }
@@ -293,6 +320,7 @@ public:
     ~LinearGrad()
     {
         delete _cstops;
+        delete[] _rowbuf;
     }
     bool GetStatus()
     {
@@ -301,11 +329,13 @@ public:
     void FillSpan(int xs, int ys, int length, COLOR outBuf[], const COLOR inAlpha[]);
     bool AddColorStop(float offset, COLOR color)
     {
+        _rowcount = 0;  // invalidate cached row colors
         return _cstops->AddColorStop(offset, color);
     }
     bool SetScrollPosition(int x, int y)
     {
         _xscroll = x, _yscroll = y;
+        _rowcount = 0;  // invalidate cached row colors
         return true;
     }
 };
@@ -313,7 +343,9 @@ public:
 // Constructor: Defines a new linear-gradient fill pattern
 LinearGrad::LinearGrad(float x0, float y0, float x1, float y1,
                        SPREAD_METHOD spread, int flags, const float xform[6]) :
-              _x0(x0), _y0(y0), _x1(x1), _y1(y1), _xscroll(0), _yscroll(0)
+              _x0(x0), _y0(y0), _x1(x1), _y1(y1), _xscroll(0), _yscroll(0),
+              _bVertical(false), _bHorizontal(false),
+              _rowbuf(0), _rowlen(0), _rowxs(0), _rowcount(0)
 {
     _cstops = new ColorStops();
     assert(_cstops);  // out of memory?
@@ -357,6 +389,137 @@ LinearGrad::LinearGrad(float x0, float y0, float x1, float y1,
 
     _dtdx = _x1/dist2;
     _dtdy = _y1/dist2;
+#ifdef SGFIXEDPOINT
+    const double one32 = 4294967296.0;  // 1.0 in 32.32 format
+
+    _dtdx32 = one32*_dtdx;
+    _dtdy32 = one32*_dtdy;
+    _t00 = -one32*(_x0*_dtdx + _y0*_dtdy);
+
+    // Detect axis-aligned gradients, for which FillSpan can skip
+    // most of the per-pixel color look-ups
+    _bVertical = (_dtdx32 == 0);
+    _bHorizontal = (_dtdy32 == 0);
+#else
+    _bVertical = (_dtdx == 0);
+    _bHorizontal = (_dtdy == 0);
+#endif
+}
+
+// Private function: Returns the color of a pixel, given the color
+// look-up parameter 't' at the pixel's center. The function applies
+// the spread method and the start/end extensions, and multiplies all
+// four components of the color by 'opacity', which is in the range 1
+// to 255. If 't' falls outside the gradient, the pixel is transparent.
+#ifdef SGFIXEDPOINT
+inline COLOR LinearGrad::GetColor(long long t, COLOR opacity)
+{
+    bool bValid = ((_bExtStart || t >= 0) && (_bExtEnd || t < (1LL << 32)));
+
+    if (!bValid)
+        return 0;
+
+    int n = t >> 32;
+
+    if (_spread == SPREAD_PAD && n != 0)
+        return _cstops->GetPadColor(n, opacity);
+
+    FIX16 tfix = ((t & 0xffffffffLL)*0x0000ffff) >> 32;
+
+    if (_spread == SPREAD_REFLECT && (n & 1))
+        tfix ^= 0x0000ffff;
+
+    return _cstops->GetColorValue(tfix, opacity);
+}
+#else
+inline COLOR LinearGrad::GetColor(float t, COLOR opacity)
+{
+    bool bValid = ((_bExtStart || t >= 0) && (_bExtEnd || t < 1.0));
+
+    if (!bValid)
+        return 0;
+
+    int n = t;
+
+    if (t < 0) --n;
+    if (_spread == SPREAD_PAD && n != 0)
+        return _cstops->GetPadColor(n, opacity);
+
+    // Convert t from float to 16.16 fixed-point format. We
+    // represent 1.0 as 0x0000ffff instead of as 0x00010000
+    // to help distinguish 1.0 from 0 at boundaries between
+    // color patterns when spread == SPREAD_REFLECT.
+    FIX16 tfix = 0x0000ffff*(t - n);
+
+    if (_spread == SPREAD_REFLECT && (n & 1))
+        tfix ^= 0x0000ffff;
+
+    return _cstops->GetColorValue(tfix, opacity);
+}
+#endif
+
+// Private function: Multiplies all four components of a premultiplied-
+// alpha color by 'opacity'. The rounding is identical to that in the
+// ColorStops::GetColorValue function, so GetColor(t, 255) followed by
+// a call to ScaleColor gives the same result as GetColor(t, opacity).
+inline COLOR LinearGrad::ScaleColor(COLOR color, COLOR opacity)
+{
+    if (opacity == 255)
+        return color;
+
+    COLOR rb = color & 0x00ff00ff;
+    COLOR ga = (color >> 8) & 0x00ff00ff;
+
+    rb *= opacity;
+    rb += 0x00800080;
+    rb += (rb >> 8) & 0x00ff00ff;
+    rb = (rb >> 8) & 0x00ff00ff;
+    ga *= opacity;
+    ga += 0x00800080;
+    ga += (ga >> 8) & 0x00ff00ff;
+    ga &= 0xff00ff00;
+    return ga | rb;
+}
+
+// Private function: Used for horizontal gradients (dt/dy = 0), which
+// have the same colors in every row. Loads the _rowbuf array with the
+// fully opaque colors of the 'len' pixels that start at x coordinate
+// 'xs'. If the array already contains the colors for a span that
+// starts at the same x coordinate and is at least as long, they're
+// reused as is. The t values are calculated exactly as they are in
+// FillSpan, so the cached colors match the colors that FillSpan would
+// otherwise calculate pixel by pixel. Returns false if the array
+// can't be allocated.
+bool LinearGrad::FillRowBuffer(int xs, int len)
+{
+    if (_rowcount != 0 && xs == _rowxs && len <= _rowcount)
+        return true;  // cache hit
+
+    if (_rowlen < len)
+    {
+        delete[] _rowbuf;
+        _rowlen = 0;
+        _rowbuf = new COLOR[len];
+        if (_rowbuf == 0)
+            return false;
+
+        _rowlen = len;
+    }
+#ifdef SGFIXEDPOINT
+    long long t = _t00 + (xs + _xscroll)*_dtdx32;
+
+    for (int i = 0; i < len; ++i)
+    {
+        _rowbuf[i] = GetColor(t, 255);
+        t += _dtdx32;
+    }
+#else
+    for (int i = 0; i < len; ++i)
+        _rowbuf[i] = GetColor(((xs + _xscroll + i) - _x0)*_dtdx, 255);
+#endif
+    _rowxs = xs;
+    _rowcount = len;
+    return true;
 }
 
 // Public function: Fills the pixels in a single horizontal span with
@@ -384,44 +547,64 @@ void LinearGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR i
         return;
     }
 
-    float xp = xs - _x0 + _xscroll;
-    float yp = ys - _y0 + _yscroll;
-    float t = xp*_dtdx + yp*_dtdy;
+    // Fast path for a horizontal gradient: Every row has the same
+    // colors, so copy them from the cached row, scaled by inAlpha
+    if (_bHorizontal && FillRowBuffer(xs, len))
+    {
+        for (int i = 0; i < len; ++i)
+        {
+            COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
 
-    // Normal case: Each iteration of this for-loop paints one pixel
-    for (int i = 0; i < len; ++i)
+            if (opacity != 0)
+                outBuf[i] = ScaleColor(_rowbuf[i], opacity);
+        }
+        return;
+    }
+
+#ifdef SGFIXEDPOINT
+    // Fixed-point version of the code below: t is a 32.32 value
+    long long t = _t00 + (xs + _xscroll)*_dtdx32 + (ys + _yscroll)*_dtdy32;
+#else
+    // The t value of each pixel is calculated from the pixel's device
+    // coordinates rather than accumulated along the span, so a pixel's
+    // color doesn't depend on where its span starts
+    float yt = ((ys + _yscroll) - _y0)*_dtdy;
+    float t = ((xs + _xscroll) - _x0)*_dtdx + yt;
+#endif
+
+    // Fast path for a vertical gradient: All pixels in the span have
+    // the same t, so look up the color once and scale it by inAlpha
+    if (_bVertical)
     {
-        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
+        COLOR color = GetColor(t, 255);
 
-        if (opacity != 0)
+        for (int i = 0; i < len; ++i)
         {
-            COLOR color = 0;
-            bool bValid = ((_bExtStart || t >= 0) && (_bExtEnd || t < 1.0));
+            COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
 
-            if (bValid)
-            {
-                int n = t;
+            if (opacity != 0)
+                outBuf[i] = ScaleColor(color, opacity);
+        }
+        return;
+    }
 
-                if (t < 0) --n;
-                if (_spread == SPREAD_PAD && n != 0)
-                    color = _cstops->GetPadColor(n, opacity);
-                else
-                {
-                    // Convert t from float to 16.16 fixed-point format. We
-                    // represent 1.0 as 0x0000ffff instead of as 0x00010000
-                    // to help distinguish 1.0 from 0 at boundaries between
-                    // color patterns when spread == SPREAD_REFLECT.
-                    FIX16 tfix = 0x0000ffff*(t - n);
+    // Normal case: Each iteration of this for-loop paints one pixel
+    for (int i = 0; i < len; ++i)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
 
-                    if (_spread == SPREAD_REFLECT && (n & 1))
-                        tfix ^= 0x0000ffff;
+#ifdef SGFIXEDPOINT
+        if (opacity != 0)
+            outBuf[i] = GetColor(t, opacity);
 
-                    color = _cstops->GetColorValue(tfix, opacity);
-                }
-            }
-            outBuf[i] = color;
+        t += _dtdx32;
+#else
+        if (opacity != 0)
+        {
+            t = ((xs + _xscroll + i) - _x0)*_dtdx + yt;
+            outBuf[i] = GetColor(t, opacity);
         }
-        t += _dtdx;
+#endif
     }
 }
 
@@ -430,6 +613,8 @@ LinearGradient* CreateLinearGradient(float x0, float y0, float x1, float y1,
                                      SPREAD_METHOD spread, int flags,
                                      const float xform[6])
 {
+    TRACE_SCOPE("CreateLinearGradient");
+
     LinearGrad *grad = new LinearGrad(x0, y0, x1, y1, spread, flags, xform);
     if (grad == 0 || grad->GetStatus() == false)
     {
@@ -440,12 +625,53 @@ LinearGradient* CreateLinearGradient(float x0, float y0, float x1, float y1,
     return grad;  // success
 }
 
+// Statically bound entry point to the FillSpan function (see pipeline.h)
+void FillLinearSpan(PaintGen *paint, int xs, int ys, int len,
+                    COLOR outBuf[], const COLOR inAlpha[])
+{
+    static_cast<LinearGrad*>(paint)->LinearGrad::FillSpan(xs, ys, len, outBuf, inAlpha);
+}
+
 //---------------------------------------------------------------------
 //
 // RadialGrad class -- Paint generator for radial gradient fills
 //
 //---------------------------------------------------------------------
 
+#ifdef SGFIXEDPOINT
+namespace {
+    // Returns x*y/2^32, rounded down. The full product is formed from
+    // the 32-bit halves of x and y, so only the result has to fit in
+    // 64 bits.
+    inline long long MulShift32(long long x, long long y)
+    {
+        long long xh = x >> 32, yh = y >> 32;
+        long long xl = x & 0xffffffffLL, yl = y & 0xffffffffLL;
+        unsigned long long ll = (unsigned long long)xl*yl;
+
+        return xh*yh*0x100000000LL + xh*yl + xl*yh + (long long)(ll >> 32);
+    }
+
+    // Returns the integer square root (rounded down) of x, given an
+    // estimate of the root, such as the root calculated for the previous
+    // pixel. From a close estimate, Newton's method takes a step or two.
+    // Without a usable estimate, the function calls FixedSqrt instead.
+    inline long long RefineSqrt(long long x, long long root)
+    {
+        long long sq = root*root;
+
+        if (root == 0 || sq > 4*x || 4*sq < x)
+            return FixedSqrt(x);
+
+        root = (root + x/root) >> 1;  // now root >= sqrt(x)
+        while (root*root > x)
+            root = (root + x/root) >> 1;
+
+        return root;
+    }
+} // end namespace
+#endif
+
 class RadialGrad : public RadialGradient
 {
     ColorStops *_cstops;    // color-stop manager object
@@ -465,6 +691,23 @@ class RadialGrad : public RadialGradient
     float _a;      // a = x1^2 + y1^2 - dr^2
     float _inva;   // inva = 1/a
     float _A2;     // A2 = dr^2 - y1^2
+#ifdef SGFIXEDPOINT
+    // Fixed-point versions of the values above. To make the best use
+    // of the 64-bit integer range, all lengths are scaled so that the
+    // largest of x1, y1, r0, and r1 is between 16 and 32, and are then
+    // stored with 16 fractional bits. The mapping from pixel to scaled
+    // gradient coordinates has 32 fractional bits.
+    long long _fsx, _fcx;   // xp = x*_fsx + y*_fsvx + _fcx
+    long long _fsvx;
+    long long _fsvy, _fcy;  // yp = y*_fsvy + _fcy
+    long long _fx1, _fy1;   // x1 and y1, 16 fractional bits
+    long long _fr0, _fdr;   // r0 and dr, 16 fractional bits
+    long long _fa;          // a, 16 fractional bits, or 0 if too small
+    long long _finva;       // 2^(24+_fshift)/_fa, between 2^21 and 2^22
+    int _fshift;
+
+    void InitFixedPoint();
+#endif
 
     void TransformRadialGradient(const float xform[6]);
 
@@ -542,7 +785,51 @@ RadialGrad::RadialGrad(float x0, float y0, float r0, float x1, float y1, float r
     _a = _x1*_x1 + _y1*_y1 - _dr*_dr;
     _inva = (_a == 0) ? 0 : 1.0/_a;
     _A2 = _dr*_dr - _y1*_y1;
+#ifdef SGFIXEDPOINT
+    InitFixedPoint();
+#endif
+}
+
+#ifdef SGFIXEDPOINT
+// Private function: Called by the constructor to convert the gradient
+// parameters to the scaled fixed-point values used by FillSpan
+void RadialGrad::InitFixedPoint()
+{
+    const double one32 = 4294967296.0;  // 1.0 in 32.32 format
+    float len = max(max(fabs(_x1), fabs(_y1)), max(_r0, _r1));
+    int exp;
+
+    frexp(len, &exp);  // len = m*2^exp, where 0.5 <= m < 1
+    double scale = ldexp(1.0, 5 - max(exp, -3));  // scaled length 16..32
+
+    _fsx = one32*scale;
+    _fsvx = one32*scale*_vx;
+    _fcx = -one32*scale*(_x0 + _vx*_y0);
+    _fsvy = one32*scale*_vy;
+    _fcy = -one32*scale*_vy*_y0;
+    _fx1 = ldexp(scale*_x1, 16);
+    _fy1 = ldexp(scale*_y1, 16);
+    _fr0 = ldexp(scale*_r0, 16);
+    _fdr = ldexp(scale*_dr, 16);
+
+    // Calculate a from the same rounded lengths that FillSpan uses
+    // for b and c, so that the discriminant b^2 - a*c is consistent
+    _fa = (_fx1*_fx1 + _fy1*_fy1 - _fdr*_fdr + 0x8000) >> 16;
+    if (_a == 0 || llabs(_fa) < 256)
+        _fa = 0;  // treat rounding error as zero
+
+    // Normalize the reciprocal of a to keep 22 significant bits
+    _fshift = -2;
+    _finva = 0;
+    if (_fa != 0)
+    {
+        for (long long m = llabs(_fa); m > 1; m >>= 1)
+            ++_fshift;
+
+        _finva = (1LL << (24 + _fshift))/_fa;
+    }
 }
+#endif
 
 // Private function: Transforms the radial gradient fill pattern.
 // If the user provides an affine transformation matrix, this
@@ -661,7 +948,9 @@ void RadialGrad::TransformRadialGradient(const float xform[6])
 // set the values of constants _dr, _a, _inva, and _A2.
 void RadialGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAlpha[])
 {
+#ifndef SGFIXEDPOINT
     float xp, yp, b0, b, phi, A0, A1;
+#endif
 
     // Special case: x0 == x1, y0 == y1, and r0 == r1
     if (_bSpecial)
@@ -679,6 +968,119 @@ void RadialGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR i
         return;
     }
 
+#ifdef SGFIXEDPOINT
+    // Fixed-point version of the loop below. Lengths (xp, yp) have 16
+    // fractional bits, b has 24, c has 32, and the discriminant has 16.
+    // Each pixel's square root is refined from the previous pixel's
+    // root, which is usually only slightly different, and is extended
+    // from 8 to 16 fractional bits with the Newton remainder, which
+    // matters if a is small. The t values have 24 fractional bits, to
+    // place the pixels at the t = 0 and t = 1 boundaries on the same
+    // side as the floating-point version does. Pixels more than 2^14
+    // scaled units (512 times the size of the gradient) from the origin
+    // are clamped to this distance.
+    const long long limit = 1LL << 30;
+    long long xp32 = (xs + _xscroll)*_fsx + (ys + _yscroll)*_fsvx + _fcx;
+    long long yp32 = (ys + _yscroll)*_fsvy + _fcy;
+    long long yp = min(max(yp32 >> 16, -limit), limit);
+    long long b0 = (yp*_fy1 + _fr0*_fdr) >> 8;
+    long long phi = yp*yp - _fr0*_fr0;
+    long long root = 0;
+    long long round = (1LL << _fshift) >> 1;
+    const long long tmax = (1LL << 38) - 1;
+
+    for (int i = 0; i < len; ++i)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
+
+        if (opacity != 0)
+        {
+            COLOR color = 0;
+            long long xp = min(max(xp32 >> 16, -limit), limit);
+            long long b = ((xp*_fx1) >> 8) + b0;
+            long long c = xp*xp + phi;
+            long long discr = MulShift32(b, b) - MulShift32(_fa, c);
+
+            if (discr < 0 && _fa < 0)
+                discr = 0;
+
+            if (discr >= 0)
+            {
+                long long t0 = 0, t1 = 0;  // 40.24 values
+                bool bValid0 = false, bValid1 = false;
+
+                if (_fa == 0)
+                {
+                    long long b16 = b >> 8;
+
+                    if (b16 != 0)
+                    {
+                        t1 = 256*(((c >> 16)*32768)/b16);
+                        t1 = min(max(t1, -tmax), tmax);
+                        bValid1 = ((_bExtStart || t1 >= 0) &&
+                                   (_bExtEnd || t1 < (1LL << 24)) &&
+                                   (_fr0 << 24) + t1*_fdr > 0);
+                    }
+                }
+                else
+                {
+                    root = RefineSqrt(discr, root);
+
+                    long long root16 = root << 8;
+
+                    if (root != 0)
+                        root16 += ((discr - root*root) << 7)/root;
+
+                    if (_fa > 0 || _fdr < 0)
+                    {
+                        long long numer = (b >> 8) + root16;
+
+                        t0 = (numer*_finva + round) >> _fshift;
+                        t0 = min(max(t0, -tmax), tmax);
+                        bValid0 = ((_bExtStart || t0 >= 0) &&
+                                   (_bExtEnd || t0 < (1LL << 24)) &&
+                                   (_fa < 0 || (_fr0 << 24) + t0*_fdr >= 0));
+                    }
+                    if (_fa > 0 || _fdr > 0)
+                    {
+                        long long numer = (b >> 8) - root16;
+
+                        t1 = (numer*_finva + round) >> _fshift;
+                        t1 = min(max(t1, -tmax), tmax);
+                        bValid1 = ((_bExtStart || t1 >= 0) &&
+                                   (_bExtEnd || t1 < (1LL << 24)) &&
+                                   (_fa < 0 || (_fr0 << 24) + t1*_fdr >= 0));
+                    }
+                }
+                if (bValid0 || bValid1)
+                {
+                    long long t;
+                    int n;
+
+                    if (bValid0 && bValid1)
+                        t = (t0 > t1) ? t0 : t1;
+                    else
+                        t = bValid0 ? t0 : t1;
+
+                    n = t >> 24;
+                    if (_spread == SPREAD_PAD && n != 0)
+                        color = _cstops->GetPadColor(n, opacity);
+                    else
+                    {
+                        FIX16 tfix = ((t & 0x00ffffff)*0x0000ffff) >> 24;
+
+                        if (_spread == SPREAD_REFLECT && (n & 1))
+                            tfix ^= 0x0000ffff;
+
+                        color = _cstops->GetColorValue(tfix, opacity);
+                    }
+                }
+            }
+            outBuf[i] = color;
+        }
+        xp32 += _fsx;
+    }
+#else
     xp = xs - _x0 + _xscroll;
     yp = ys - _y0 + _yscroll;
     xp += _vx*yp, yp *= _vy;  // apply scaling + shearing transform
@@ -771,6 +1173,7 @@ void RadialGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR i
         xp += 1.0f;
         b += _x1;
     }
+#endif
 }
 
 // Called by a renderer to create a new radial-gradient object
@@ -779,6 +1182,8 @@ RadialGradient* CreateRadialGradient(float x0, float y0, float r0,
                                      SPREAD_METHOD spread, int flags,
                                      const float xform[6])
 {
+    TRACE_SCOPE("CreateRadialGradient");
+
     RadialGrad *grad = new RadialGrad(x0, y0, r0, x1, y1, r1, spread, flags, xform);
     if (grad == 0 || grad->GetStatus() == false)
     {
@@ -789,6 +1194,13 @@ RadialGradient* CreateRadialGradient(float x0, float y0, float r0,
     return grad;  // success
 }
 
+// Statically bound entry point to the FillSpan function (see pipeline.h)
+void FillRadialSpan(PaintGen *paint, int xs, int ys, int len,
+                    COLOR outBuf[], const COLOR inAlpha[])
+{
+    static_cast<RadialGrad*>(paint)->RadialGrad::FillSpan(xs, ys, len, outBuf, inAlpha);
+}
+
 //---------------------------------------------------------------------
 //
 // ConicGrad class -- Paint generator for conic gradient fills
@@ -821,6 +1233,30 @@ namespace {
             r = PI - r;
         return (y < 0) ? -r : r;
     }
+#ifdef SGFIXEDPOINT
+    // Fixed-point version of my_atan2. The coordinates x and y are
+    // 16.16 fixed-point values. The returned angle is a normalized
+    // 16.16 fixed-point value, where 1.0 represents 2*PI radians.
+    FIX16 FixedAtan2(FIX16 y, FIX16 x)
+    {
+        if (y == 0)
+            return (x < 0) ? 0x00008000 : 0;
+
+        const int c1 = 8192, c2 = 2552, c3 = 692;  // coefficients/(2*PI)
+        long long xabs = (x < 0) ? -(long long)x : x;
+        long long yabs = (y < 0) ? -(long long)y : y;
+        long long z = (xabs < yabs) ? (xabs << 16)/yabs : (yabs << 16)/xabs;
+        long long r = c2 + ((c3*z) >> 16);
+
+        r = c1 + ((((1 << 16) - z)*r) >> 16);
+        r = (z*r) >> 16;
+        if (xabs < yabs)
+            r = 0x00004000 - r;
+        if (x < 0)
+            r = 0x00008000 - r;
+        return (y < 0) ? -(FIX16)r : (FIX16)r;
+    }
+#endif
 } // end namespace
 
 class ConicGrad : public ConicGradient
@@ -839,6 +1275,13 @@ class ConicGrad : public ConicGradient
     COLOR _endColor;        // ending color if SPREAD_PAD
     int _xscroll, _yscroll; // scroll position coordinates
     bool _bSpecial;         // special case
+#ifdef SGFIXEDPOINT
+    // Fixed-point versions of the values above, in 16.16 format
+    FIX16 _fx0, _fy0;       // center coordinates
+    FIX16 _fvx, _fvy;       // y-scaling and x-shear
+    FIX16 _ftstart;         // normalized starting angle
+    long long _ftmult;      // 1.0/tsweep
+#endif
 
     void TransformConicGradient(const float xform[6]);
 
@@ -932,6 +1375,14 @@ ConicGrad::ConicGrad(float x0, float y0, float astart, float asweep,
         _tsweep = -1.0f;
 
     _tmult = 1.0f/_tsweep;
+#ifdef SGFIXEDPOINT
+    _fx0 = 65536*_x0;
+    _fy0 = 65536*_y0;
+    _fvx = 65536*_vx;
+    _fvy = 65536*_vy;
+    _ftstart = 65536*_tstart;
+    _ftmult = 65536*_tmult;
+#endif
 }
 
 // Private function: Determines how to transform the conic gradient
@@ -1064,7 +1515,9 @@ void ConicGrad::TransformConicGradient(const float xform[6])
 // to the per-pixel alphas in the gradient).
 void ConicGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAlpha[])
 {
+#ifndef SGFIXEDPOINT
     float xp, yp;
+#endif
 
     // Special case: asweep == 0 or transformed pattern is degenerate
     if (_bSpecial)
@@ -1082,6 +1535,61 @@ void ConicGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR in
         return;
     }
 
+#ifdef SGFIXEDPOINT
+    // Fixed-point version of the loop below: the pixel coordinates and
+    // the normalized angle t are 16.16 fixed-point values
+    FIX16 xfix = 65536*(xs + _xscroll) - _fx0;
+    FIX16 yfix = 65536*(ys + _yscroll) - _fy0;
+
+    xfix += ((long long)_fvx*yfix) >> 16;  // apply scaling + shearing
+    yfix = ((long long)_fvy*yfix) >> 16;
+
+    for (int i = 0; i < len; ++i)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
+
+        if (opacity != 0)
+        {
+            FIX16 t = FixedAtan2(yfix, xfix);
+
+            if (t < 0)
+                t += 0x00010000;
+
+            t -= _ftstart;
+            if (t < 0)
+                t += 0x00010000;
+            else if (t >= 0x00010000)
+                t -= 0x00010000;
+
+            if (_ftmult < 0 && t > 0)
+                t -= 0x00010000;
+
+            long long tmp = ((t*0x0000ffffLL) >> 16)*_ftmult >> 16;
+            FIX16 tfix = min(max(tmp, -0x7fffffffLL), 0x7fffffffLL);
+            int n = tfix >> 16;
+
+            COLOR color = 0;
+            if (n == 0 || _extend != 0)
+            {
+                if (_spread == SPREAD_PAD && n != 0)
+                    color = _cstops->GetPadColor(_extend, opacity);
+                else
+                {
+                    tfix &= 0x0000ffff;  // isolate fraction
+                    if (_extend < 0)
+                        tfix ^= 0x0000ffff;
+
+                    if (_spread == SPREAD_REFLECT && (n & 1))
+                        tfix ^= 0x0000ffff;
+
+                    color = _cstops->GetColorValue(tfix, opacity);
+                }
+            }
+            outBuf[i] = color;
+        }
+        xfix += 0x00010000;
+    }
+#else
     xp = xs - _x0 + _xscroll;
     yp = ys - _y0 + _yscroll;
     xp += _vx*yp, yp *= _vy;  // apply scaling + shearing transform
@@ -1153,6 +1661,7 @@ void ConicGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR in
         }
         xp += 1.0f;
     }
+#endif
 }
 
 // Called by a renderer to create a new conic-gradient object
@@ -1160,6 +1669,8 @@ ConicGradient* CreateConicGradient(float x0, float y0, float astart, float aswee
                                    SPREAD_METHOD spread, int flags,
                                    const float xform[6])
 {
+    TRACE_SCOPE("CreateConicGradient");
+
     ConicGrad *grad = new ConicGrad(x0, y0, astart, asweep, spread, flags, xform);
     if (grad == 0 || grad->GetStatus() == false)
     {
@@ -1169,3 +1680,10 @@ ConicGradient* CreateConicGradient(float x0, float y0, float astart, float aswee
     }
     return grad;  // success
 }
+
+// Statically bound entry point to the FillSpan function (see pipeline.h)
+void FillConicSpan(PaintGen *paint, int xs, int ys, int len,
+                   COLOR outBuf[], const COLOR inAlpha[])
+{
+    static_cast<ConicGrad*>(paint)->ConicGrad::FillSpan(xs, ys, len, outBuf, inAlpha);
+}
@@ -30,6 +30,7 @@
 
 #include <math.h>
 #include "shapepri.h"
+#include "trace.h"
 
 //---------------------------------------------------------------------
 //
@@ -37,9 +38,10 @@
 //
 //---------------------------------------------------------------------
 
-ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect)
+ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect,
+                         Allocator *alloc)
 {
-    PathMgr *sg = new PathMgr(renderer, cliprect);
+    PathMgr *sg = new PathMgr(renderer, cliprect, alloc);
     if (sg == 0 || sg->GetStatus() == false)
     {
         assert(sg != 0 && sg->GetStatus() == true);
@@ -55,8 +57,10 @@ ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect)
 //
 //---------------------------------------------------------------------
 
-PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
-            _path(0), _edge(0), _pathlength(INITIAL_PATH_LENGTH),
+PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect, Allocator *alloc) :
+            _path(0), _edge(0), _cancel(0), _pathlength(INITIAL_PATH_LENGTH),
+            _pathusage(),
+            _alloc((alloc != 0) ? alloc : GetHeapAllocator()),
             _angle(0), _fpoint(0), _cpoint(0), _figure(0), _figtmp(0),
             _dashoffset(0), _pdash(0), _dashlen(0), _dashon(true),
             _devicecliprect(cliprect), _fixshift(16),
@@ -75,13 +79,13 @@ PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
         assert(cliprect.w > 0 && cliprect.h > 0);
         return;  // fail - invalid parameter value
     }
-    _edge = new EdgeMgr();
+    _edge = new EdgeMgr(_alloc);
     if (_edge == 0)
     {
         assert(_edge != 0);
         return;  // fail - out of memory
     }
-    _path = new VERT16[_pathlength];
+    _path = static_cast<VERT16*>(_alloc->Allocate(_pathlength*sizeof(VERT16)));
     if (_path == 0)
     {
         assert(_path != 0);
@@ -89,6 +93,7 @@ PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
         _edge = 0;
         return;  // fail - out of memory
     }
+    _pathusage.Add(_pathlength*sizeof(VERT16));
     SetRenderer(renderer);
     InitClipRegion(cliprect.w, cliprect.h);
     SetFixedBits(0);
@@ -105,7 +110,8 @@ PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
 PathMgr::~PathMgr()
 {
     delete _edge;
-    delete[] _path;
+    if (_path != 0)
+        _alloc->Free(_path);
 }
 
 bool PathMgr::GetStatus()
@@ -132,6 +138,25 @@ bool PathMgr::SetRenderer(Renderer *renderer)
     return true;
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Sets the cancellation callback that the FillPath
+// and StrokePath functions poll while they partition a large shape
+// into trapezoids. If a call to the callback's QueryCancel function
+// returns true, the shape is discarded before any part of it is
+// drawn. A null parameter value disables cancellation. The return
+// value is the previous callback pointer (null if none).
+//
+//---------------------------------------------------------------------
+
+CancelCallback* PathMgr::SetCancelCallback(CancelCallback *cancel)
+{
+    CancelCallback *oldcancel = _cancel;
+
+    _cancel = cancel;
+    return oldcancel;
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Sets the scroll position for the display window.
@@ -147,20 +172,165 @@ void PathMgr::SetScrollPosition(int x, int y)
     _devicecliprect.x = x;
     _devicecliprect.y = y;
     _renderer->SetScrollPosition(x, y);  // to scroll fill patterns
+    SetGuardBand();
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Sets the limits of the guard band that surrounds
+// the device clipping rectangle. The guard band extends GUARDBAND
+// pixels beyond each side of the clipping rectangle, but never past
+// the range of 16.16 fixed-point coordinates. The edge manager
+// projects any parts of the edges of filled and stroked shapes that
+// lie outside the guard band onto the boundary of the guard band, so
+// that its 16.16 arithmetic never overflows. Stroked shapes are
+// constructed from the path before this clipping, so the guard band
+// has no effect on line joins, caps, or dashed-line patterns.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::SetGuardBand()
+{
+    int xmin = max(_devicecliprect.x - GUARDBAND, -BIGVAL16);
+    int ymin = max(_devicecliprect.y - GUARDBAND, -BIGVAL16);
+    int xmax = min(_devicecliprect.x + _devicecliprect.w + GUARDBAND, BIGVAL16);
+    int ymax = min(_devicecliprect.y + _devicecliprect.h + GUARDBAND, BIGVAL16);
+    VERT16 gmin, gmax;
+
+    gmin.x = 65536*xmin;
+    gmin.y = 65536*ymin;
+    gmax.x = 65536*xmax;
+    gmax.y = 65536*ymax;
+    _edge->SetGuardBand(gmin, gmax);
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Writes the point specified by parameter v to the
+// path location pointed to by parameter p. A point that lies outside
+// the range of 16.16 fixed-point coordinates is first moved to the
+// nearest point in the clipping box (see the ClipLine function), and
+// the unclipped point is added to the extents that GetBoundingBox
+// reports for the path.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::ClipPoint(VERT16 *p, const VERTD& v)
+{
+    VERTD w = v;
+
+    if (!IsInsideRange(v))
+    {
+        w.x = min(max(v.x, -CLIPVAL16), CLIPVAL16);
+        w.y = min(max(v.y, -CLIPVAL16), CLIPVAL16);
+        _umin.x = min(v.x, _umin.x);
+        _umin.y = min(v.y, _umin.y);
+        _umax.x = max(v.x, _umax.x);
+        _umax.y = max(v.y, _umax.y);
+    }
+    p->x = floor(w.x + 0.5);
+    p->y = floor(w.y + 0.5);
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Appends a line segment from the current point to
+// the point specified by parameter v. Coordinates that lie outside
+// the range of 16.16 fixed-point coordinates cannot be stored in the
+// path. A segment that leaves this range is clipped to a clipping box
+// that lies GUARDBAND pixels inside the range, and any parts of the
+// segment that lie outside the clipping box are projected onto the
+// boundary of the box. The margin leaves room for the sides of stroked
+// lines. If the end point of the segment lies inside the range, the
+// segment then returns to the unclipped end point. Each projected
+// piece, together with the original piece, encloses no part of the
+// clipping box, so the coverage (and winding numbers) of filled shapes
+// inside the box are unchanged. Segments that lie inside the range are
+// not clipped at all. The unclipped end point becomes the new current
+// point.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::ClipLine(const VERTD& v)
+{
+    VERTD u = _upoint;
+    double t[6];
+    int n = 0;
+
+    _upoint = v;
+    if (IsInsideRange(u) && IsInsideRange(v))
+    {
+        // Line segment lies entirely inside 16.16 range
+        PathCheck(++_cpoint);
+        _cpoint->x = v.x;
+        _cpoint->y = v.y;
+        return;
+    }
+
+    // Find the parametric values (0 < t < 1) at which the line
+    // segment crosses the four boundaries of the clipping box
+    double dx = v.x - u.x;
+    double dy = v.y - u.y;
+    double tx[4];
+    tx[0] = (dx == 0) ? 0 : (-CLIPVAL16 - u.x)/dx;
+    tx[1] = (dx == 0) ? 0 : (CLIPVAL16 - u.x)/dx;
+    tx[2] = (dy == 0) ? 0 : (-CLIPVAL16 - u.y)/dy;
+    tx[3] = (dy == 0) ? 0 : (CLIPVAL16 - u.y)/dy;
+    t[n++] = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (tx[i] <= 0 || 1 <= tx[i])
+            continue;
+
+        // Insertion sort of parametric values in ascending order
+        int j = n++;
+        for ( ; j > 0 && t[j-1] > tx[i]; --j)
+            t[j] = t[j-1];
+
+        t[j] = tx[i];
+    }
+    t[n++] = 1;
+
+    // Each piece of the line segment between two crossings lies
+    // entirely inside or outside each boundary of the clipping box,
+    // so the piece is clipped simply by clipping its end points. The
+    // final point is the end point itself, if it lies inside the range.
+    for (int i = 0; i <= n; ++i)
+    {
+        VERTD w;
+        VERT16 p;
+
+        if (i == n)
+            ClipPoint(&p, v);
+        else
+        {
+            w.x = (t[i] == 1) ? v.x : u.x + t[i]*dx;
+            w.y = (t[i] == 1) ? v.y : u.y + t[i]*dy;
+            p.x = floor(min(max(w.x, -CLIPVAL16), CLIPVAL16) + 0.5);
+            p.y = floor(min(max(w.y, -CLIPVAL16), CLIPVAL16) + 0.5);
+        }
+        if (p.x != _cpoint->x || p.y != _cpoint->y)
+        {
+            PathCheck(++_cpoint);
+            *_cpoint = p;
+        }
+    }
 }
 
 //---------------------------------------------------------------------
 //
-// Private function: Grows the size of the path memory in the event
-// of a path stack overflow. Allocates a larger stack and copies the
-// contents of the old stack to the new stack. The path management
-// functions are designed so that the only pointers that need to be
-// updated are _cpoint, _fpoint, _figure, and _figtmp. The path data
-// itself contains no pointers, only path-relative offsets.
+// Private function: Resizes the path memory. GrowPath calls this
+// function to double the size of the path stack in the event of a
+// stack overflow, and TrimMemory calls it to shrink the stack after
+// a spike in usage. Allocates a new stack of the specified length and
+// copies the contents of the old stack to the new stack. The path
+// management functions are designed so that the only pointers that
+// need to be updated are _cpoint, _fpoint, _figure, and _figtmp. The
+// path data itself contains no pointers, only path-relative offsets.
 //
 //---------------------------------------------------------------------
 
-void PathMgr::GrowPath()
+void PathMgr::ResizePath(int length)
 {
     if (_path == 0)
     {
@@ -170,12 +340,13 @@ void PathMgr::GrowPath()
     int offset, oldlen = _pathlength;
     VERT16 *oldpath = _path;
 
-    _pathlength += _pathlength;
-    _path = new VERT16[_pathlength];
+    _pathlength = length;
+    _path = static_cast<VERT16*>(_alloc->Allocate(_pathlength*sizeof(VERT16)));
 
     // TODO: Replace assert below with out-of-memory exception
     assert(_path != 0);
-    memcpy(_path, oldpath, oldlen*sizeof(_path[0]));
+    _pathusage.Add(_pathlength*sizeof(VERT16));
+    memcpy(_path, oldpath, min(oldlen, _pathlength)*sizeof(_path[0]));
     if (_cpoint != 0)
     {
         offset = _cpoint - oldpath;
@@ -196,7 +367,71 @@ void PathMgr::GrowPath()
         offset = _figtmp - reinterpret_cast<FIGURE*>(oldpath);
         _figtmp = reinterpret_cast<FIGURE*>(&_path[offset]);
     }
-    delete[] oldpath;
+    _alloc->Free(oldpath);
+    _pathusage.Remove(oldlen*sizeof(VERT16));
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Reports the current and peak sizes, in bytes, of
+// the path stack and the edge pools. The total.peak value is the sum
+// of the individual peaks, which is an upper bound on the true peak.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::GetMemoryReport(SGMEMREPORT *report)
+{
+    _edge->GetPoolUsage(report);
+    report->path = _pathusage;
+
+    const MEMUSAGE *usage[] = {
+        &report->inpool, &report->outpool, &report->clippool,
+        &report->rendpool, &report->savepool, &report->path
+    };
+
+    report->total.current = report->total.peak = 0;
+    for (int i = 0; i < ARRAY_LEN(usage); ++i)
+    {
+        report->total.current += usage[i]->current;
+        report->total.peak += usage[i]->peak;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Releases memory that the path stack and edge pools
+// acquired during a spike in usage. Each buffer that holds more than
+// 'threshold' bytes is shrunk to the smallest size that still holds
+// its contents. The current path and clipping region are preserved.
+// Call this function between fills and strokes -- for example, after
+// an unusually complex frame is drawn. Returns the number of bytes
+// released.
+//
+//---------------------------------------------------------------------
+
+size_t PathMgr::TrimMemory(size_t threshold)
+{
+    size_t released = _edge->TrimPools(threshold);
+    size_t size = _pathlength*sizeof(VERT16);
+
+    if (size > threshold)
+    {
+        // Find the end of the path data, and the shortest path stack
+        // length (the initial length times a power of 2) to hold it
+        VERT16 *pend = max(max(_cpoint, _fpoint), reinterpret_cast<VERT16*>(_figure));
+        int used = pend - _path + 1;
+        int length = INITIAL_PATH_LENGTH;
+
+        while (length < used)
+            length += length;
+
+        if (length < _pathlength)
+        {
+            ResizePath(length);
+            released += size - _pathlength*sizeof(VERT16);
+        }
+    }
+    return released;
 }
 
 //---------------------------------------------------------------------
@@ -259,6 +494,8 @@ void PathMgr::BeginPath()
     _figure->isclosed = false;  // by default, path is open
     _fpoint = &_path[1];
     _cpoint = 0;  // indicate figure is empty
+    _umin.x = _umin.y = MAXVAL16;  // no points clipped yet
+    _umax.x = _umax.y = -MAXVAL16;
 }
 
 //---------------------------------------------------------------------
@@ -358,10 +595,14 @@ void PathMgr::EndFigure()
 
 void PathMgr::Move(SGCoord x, SGCoord y)
 {
+    double scale = 1 << _fixshift;
+
     EndFigure();
+    _upoint.x = scale*x;
+    _upoint.y = scale*y;
+    _ufirst = _upoint;
     _cpoint = _fpoint;
-    _cpoint->x = x << _fixshift;
-    _cpoint->y = y << _fixshift;
+    ClipPoint(_cpoint, _upoint);
 }
 
 //---------------------------------------------------------------------
@@ -379,9 +620,12 @@ bool PathMgr::Line(SGCoord x, SGCoord y)
         assert(_cpoint != 0);
         return false;
     }
-    PathCheck(++_cpoint);
-    _cpoint->x = x << _fixshift;
-    _cpoint->y = y << _fixshift;
+    double scale = 1 << _fixshift;
+    VERTD v;
+
+    v.x = scale*x;
+    v.y = scale*y;
+    ClipLine(v);
     return true;
 }
 
@@ -403,11 +647,15 @@ bool PathMgr::PolyLine(const SGPoint xy[], int npts)
         assert(_cpoint != 0 && npts >= 0 && xy != 0);
         return false;
     }
+    double scale = 1 << _fixshift;
+
     for (int i = 0; i < npts; ++i)
     {
-        PathCheck(++_cpoint);
-        _cpoint->x = xy[i].x << _fixshift;
-        _cpoint->y = xy[i].y << _fixshift;
+        VERTD v;
+
+        v.x = scale*xy[i].x;
+        v.y = scale*xy[i].y;
+        ClipLine(v);
     }
     return true;
 }
@@ -475,13 +723,7 @@ bool PathMgr::FilledShape()
             --nverts;
         }
         if (vs != ve)
-        {
-            for (int i = 0; i < nverts; i++)
-            {
-                _edge->AttachEdge(vs, ve);
-                vs = ve++;
-            }
-        }
+            _edge->AttachEdges(ve, nverts, true);
     }
     return true;
 }
@@ -516,13 +758,17 @@ FILLRULE PathMgr::SetFillRule(FILLRULE fillrule)
 
 bool PathMgr::FillPath()
 {
+    TRACE_SCOPE("FillPath");
+
     if (FilledShape() == false)
         return false;  // path is empty
 
     if ((_devicecliprect.x | _devicecliprect.y) != 0)
         _edge->TranslateEdges(_devicecliprect.x, _devicecliprect.y);
 
-    _edge->NormalizeEdges(_fillrule);
+    if (_edge->NormalizeEdges(_fillrule, _cancel) == false)
+        return false;  // operation was canceled
+
     _edge->ClipEdges(FILLRULE_INTERSECT);
     return _edge->FillEdgeList();
 }
@@ -535,6 +781,8 @@ bool PathMgr::FillPath()
 
 bool PathMgr::StrokePath()
 {
+    TRACE_SCOPE("StrokePath");
+
     if (StrokedShape() == false)
         return false;  // path is empty
 
@@ -542,7 +790,9 @@ bool PathMgr::StrokePath()
     if ((_devicecliprect.x | _devicecliprect.y) != 0)
         _edge->TranslateEdges(_devicecliprect.x, _devicecliprect.y);
 
-    _edge->NormalizeEdges(FILLRULE_WINDING);
+    if (_edge->NormalizeEdges(FILLRULE_WINDING, _cancel) == false)
+        return false;  // operation was canceled
+
     _edge->ClipEdges(FILLRULE_INTERSECT);
     return _edge->FillEdgeList();
 }
@@ -653,6 +903,7 @@ bool PathMgr::InitClipRegion(int width, int height)
     _devicecliprect.h = height;
     _edge->SetDeviceClipRectangle(width, height, false);
     _renderer->SetMaxWidth(width);
+    SetGuardBand();
     return true;
 }
 
@@ -675,10 +926,11 @@ bool PathMgr::GetCurrentPoint(SGPoint *cpoint)
 
     if (cpoint != 0)
     {
-        FIX16 roundoff = (_fixshift == 0) ? 0 : (1 << (_fixshift - 1));
+        double scale = 1 << _fixshift;
 
-        cpoint->x = (_cpoint->x + roundoff) >> _fixshift;
-        cpoint->y = (_cpoint->y + roundoff) >> _fixshift;
+        // Report the point as specified, not as clipped to 16.16 range
+        cpoint->x = floor(_upoint.x/scale + 0.5);
+        cpoint->y = floor(_upoint.y/scale + 0.5);
     }
     return true;
 }
@@ -703,10 +955,11 @@ bool PathMgr::GetFirstPoint(SGPoint *fpoint)
 
     if (fpoint != 0)
     {
-        FIX16 roundoff = (_fixshift == 0) ? 0 : (1 << (_fixshift - 1));
+        double scale = 1 << _fixshift;
 
-        fpoint->x = (_fpoint->x + roundoff) >> _fixshift;
-        fpoint->y = (_fpoint->y + roundoff) >> _fixshift;
+        // Report the point as specified, not as clipped to 16.16 range
+        fpoint->x = floor(_ufirst.x/scale + 0.5);
+        fpoint->y = floor(_ufirst.y/scale + 0.5);
     }
     return true;
 }
@@ -727,21 +980,22 @@ bool PathMgr::GetFirstPoint(SGPoint *fpoint)
 // the SetFixedBits function to switch to using fixed-point coordi-
 // nates, in which case the values written to 'bbox' are fixed-point.
 // The code below uses ShapeGen-internal coordinates, which are in
-// 16.16 fixed-point format. Also, the function calculates the
-// bounding box based on the x-y coordinates in the path, and does not
-// actually construct any shapes.
+// 16.16 fixed-point format, widened to 64 bits to include any points
+// that were clipped to the 16.16 range. Also, the function calculates
+// the bounding box based on the x-y coordinates in the path, and does
+// not actually construct any shapes.
 //
 //---------------------------------------------------------------------
 
 int PathMgr::GetBoundingBox(SGRect *bbox, int flags)
 {
-    FIX16 xmin, ymin, xmax, ymax;
+    long long xmin, ymin, xmax, ymax;
     FIGURE *fig;
     VERT16 *point;
     int offset, count = 0;
 
-    xmin = ymin = 0x7fffffff;
-    xmax = ymax = 0x80000000;
+    xmin = ymin = 0x7fffffffLL;
+    xmax = ymax = -0x80000000LL;
     if (_cpoint == 0)
     {
         // Current figure is empty
@@ -784,6 +1038,15 @@ int PathMgr::GetBoundingBox(SGRect *bbox, int flags)
     if (!bbox)
         return count;
 
+    // Include the unclipped positions of points that were clipped
+    if (_umin.x <= _umax.x)
+    {
+        xmin = min((long long)floor(_umin.x + 0.5), xmin);
+        ymin = min((long long)floor(_umin.y + 0.5), ymin);
+        xmax = max((long long)floor(_umax.x + 0.5), xmax);
+        ymax = max((long long)floor(_umax.y + 0.5), ymax);
+    }
+
     // Compensate for fuzzy edges of antialiased shapes
     xmin -= 0x00008000;
     ymin -= 0x00008000;
@@ -791,7 +1054,7 @@ int PathMgr::GetBoundingBox(SGRect *bbox, int flags)
     ymax += 0x00008000;
     if (flags)
     {
-        FIX16 xmin0, ymin0, xmax0, ymax0;
+        long long xmin0, ymin0, xmax0, ymax0;
         if (flags & FLAG_BBOX_STROKE)
         {
             FIX16 pad = 0;
@@ -831,10 +1094,10 @@ int PathMgr::GetBoundingBox(SGRect *bbox, int flags)
         }
         if ((flags & FLAG_BBOX_ACCUM) && (bbox->w > 0) && (bbox->h > 0))
         {
-            xmin0 = bbox->x << _fixshift;
-            ymin0 = bbox->y << _fixshift;
-            xmax0 = xmin0 + (bbox->w << _fixshift);
-            ymax0 = ymin0 + (bbox->h << _fixshift);
+            xmin0 = (long long)bbox->x << _fixshift;
+            ymin0 = (long long)bbox->y << _fixshift;
+            xmax0 = xmin0 + ((long long)bbox->w << _fixshift);
+            ymax0 = ymin0 + ((long long)bbox->h << _fixshift);
 
             xmin = min(xmin0, xmin);
             ymin = min(ymin0, ymin);
@@ -846,10 +1109,10 @@ int PathMgr::GetBoundingBox(SGRect *bbox, int flags)
     // Extend sides of bbox outward to next pixel boundary
     xmax += 0x0000ffff;
     ymax += 0x0000ffff;
-    xmin &= 0xffff0000;
-    ymin &= 0xffff0000;
-    xmax &= 0xffff0000;
-    ymax &= 0xffff0000;
+    xmin &= ~0xffffLL;
+    ymin &= ~0xffffLL;
+    xmax &= ~0xffffLL;
+    ymax &= ~0xffffLL;
 
     // Convert coordinates to user's current integer/fixed-point format
     bbox->x = xmin >> _fixshift;
@@ -28,7 +28,8 @@
 
 #include <string.h>
 #include <assert.h>
-#include "renderer.h"
+#include "pipeline.h"
+#include "trace.h"
 
 //---------------------------------------------------------------------
 //
@@ -40,6 +41,21 @@ namespace {
     struct XYPAIR { FIX16 x; FIX16 y; };   // x-y coordinate pair
     struct UVPAIR { FIX16 u; FIX16 v; };   // texture coord pair
 
+    // A slot in the tile cache. The slots are linked together in a
+    // doubly linked list in order of use, starting with the most
+    // recently used slot.
+    struct TILESLOT
+    {
+        int tile;       // index of cached tile, or -1 if slot is empty
+        int prev;       // previous (more recently used) slot
+        int next;       // next (less recently used) slot
+        COLOR *pixels;  // tile pixels; pitch = tile width
+    };
+
+    // Minimum number of tiles in a tile cache. A pixel's multisampling
+    // points can straddle the corners of up to four tiles.
+    const int TILECACHE_MINLEN = 4;
+
     // Multiplies a 32-bit pixel's RGB and alpha components by the
     // 'opacity' parameter, which is an alpha value in the range 0
     // to 255. Both the input pixel value and the return value are
@@ -67,36 +83,6 @@ namespace {
         return ga | rb;
     }
 
-    // Premultiplies an array of 32-bit pixels by their alphas
-    void PremultAlphaArray(COLOR *pixel, int len)
-    {
-        for (int i = 0; i < len; ++i, ++pixel)
-        {
-            COLOR rb, ga, color = *pixel, alfa = color >> 24;
-
-            if (alfa == 255)
-                continue;
-
-            if (alfa == 0)
-            {
-                *pixel = 0;
-                continue;
-            }
-            color |= 0xff000000;
-            rb = color & 0x00ff00ff;
-            rb *= alfa;
-            rb += 0x00800080;
-            rb += (rb >> 8) & 0x00ff00ff;
-            rb &= 0xff00ff00;
-            ga = (color >> 8) & 0x00ff00ff;
-            ga *= alfa;
-            ga += 0x00800080;
-            ga += (ga >> 8) & 0x00ff00ff;
-            ga &= 0xff00ff00;
-            *pixel = ga | (rb >> 8);
-        }
-    }
-
     // Returns the value x modulo n
     int modulus(int x, int n)
     {
@@ -132,6 +118,7 @@ namespace {
 
 class Pattern : public TiledPattern
 {
+    Allocator *_alloc;    // supplies memory for pattern image
     COLOR **_pattern;     // stored pattern image
     int _w, _h;           // width and height of image
     float _xform[6];      // affine transformation matrix
@@ -139,50 +126,52 @@ class Pattern : public TiledPattern
     FIX16 _dvdx;          // partial derivative dv/dx
     FIX16 _dudy;          // partial derivative du/dy
     FIX16 _dvdy;          // partial derivative dv/dy
+#ifdef SGFIXEDPOINT
+    long long _uxform[3]; // _xform[0], [2], [4] in 32.32 format
+    long long _vxform[3]; // _xform[1], [3], [5] in 32.32 format
+#endif
     UVPAIR _offset[4][4]; // multisampling offsets for antialiasing
     int _xscroll, _yscroll; // scroll position coordinates
 
-    // Initialization code common to both constructors
+    // Tile cache -- used only if the pattern is read from a TileSource
+    TileSource *_tilesrc; // supplies tiles on demand
+    int _tflags;          // pixel-format conversion flags for tiles
+    int _tshift;          // log2 of tile width (and height)
+    int _ntx, _nty;       // number of tile columns and rows in image
+    int *_tileslot;       // maps each tile to a cache slot, or to -1
+    TILESLOT *_slot;      // array of cache slots
+    int _nslots;          // number of cache slots
+    int _mru, _lru;       // most and least recently used slots
+    int _lasttile;        // index of most recently accessed tile
+    COLOR *_lastpix;      // pixels in most recently accessed tile
+
+    // Initialization code common to all constructors
     void Init(float u0, float v0, int flags, const float xform[6]);
+    void LoadTile(int tile);
+    COLOR GetTexel(int i, int j);
 
 public:
-    Pattern() : _w(0), _h(0)
+    Pattern() : _alloc(0), _pattern(0), _w(0), _h(0), _tilesrc(0), _slot(0)
     {
         assert(0);
     }
     Pattern(const COLOR *pattern, float u0, float v0, int w, int h,
-            int stride, int flags, const float xform[6]);
+            int stride, int flags, const float xform[6], Allocator *alloc);
     Pattern(ImageReader *imgrdr, float u0, float v0, int w, int h,
-            int flags, const float xform[6]);
+            int flags, const float xform[6], Allocator *alloc);
+    Pattern(TileSource *tilesrc, float u0, float v0, int w, int h,
+            int flags, int cachesize, const float xform[6], Allocator *alloc);
     ~Pattern();
     bool GetStatus();  // for local use only
     void FillSpan(int xs, int ys, int length, COLOR outBuf[], const COLOR inAlpha[]);
     bool SetScrollPosition(int x, int y);
 };
 
-// Contains initialization code common to both constructors
+// Contains initialization code common to all constructors. The
+// caller is responsible for converting the pattern texels to the
+// renderer's pixel format before calling this function.
 void Pattern::Init(float u0, float v0, int flags, const float xform[6])
 {
-    // Do we need to convert from RGBA (0xaabbggrr) to BGRA (0xaarrggbb),
-    // or vice versa? If so, swap the red and blue fields.
-    if (flags & FLAG_SWAP_REDBLUE)
-    {
-        for (int j = 0; j < _h; ++j)
-        {
-            COLOR *p = _pattern[j];
-            for (int i = 0; i < _w; ++i)
-            {
-                COLOR rgba = *p, rb = rgba & 0x00ff00ff;
-                *p++ = (rgba ^ rb) | (rb << 16) | (rb >> 16);
-            }
-        }
-    }
-
-    // If the pattern texels are not already in premultiplied-
-    // alpha format, convert them now...
-    if (~flags & FLAG_PREMULTALPHA)
-        PremultAlphaArray(_pattern[0], _w*_h);
-
     // Set up matrix for affine transformation from viewport's
     // x-y pixel coordinates to pattern's u-v texel coordinates
     if (xform != 0)
@@ -204,6 +193,13 @@ void Pattern::Init(float u0, float v0, int flags, const float xform[6])
     _dvdx = 65536*_xform[1];
     _dudy = 65536*_xform[2];
     _dvdy = 65536*_xform[3];
+#ifdef SGFIXEDPOINT
+    for (int i = 0; i < 3; ++i)
+    {
+        _uxform[i] = 4294967296.0*_xform[2*i];
+        _vxform[i] = 4294967296.0*_xform[2*i+1];
+    }
+#endif
 
     // For each display pixel in the four-pixel multisampling pattern,
     // calculate the corresponding four u-v sampling offsets from the
@@ -225,32 +221,37 @@ void Pattern::Init(float u0, float v0, int flags, const float xform[6])
 // Input pixels are assumed to be in either 32-bit RGBA (0xaabbggrr)
 // format or 32-bit BGRA (0xaarrggbb) format.
 Pattern::Pattern(const COLOR *pattern, float u0, float v0, int w, int h,
-                 int stride, int flags, const float xform[6]) :
-           _w(0), _h(0), _xscroll(0), _yscroll(0)
+                 int stride, int flags, const float xform[6], Allocator *alloc) :
+           _alloc(alloc), _pattern(0), _w(0), _h(0), _xscroll(0), _yscroll(0),
+           _tilesrc(0), _slot(0)
 {
     if (pattern == 0 || w < 1 || h < 1 || stride < w)
         return;  // fail - invalid input parameters
 
     // Allocate 2-D array in which to store pattern
-    COLOR *pdata = new COLOR[w*h];
+    COLOR *pdata = static_cast<COLOR*>(_alloc->Allocate(w*h*sizeof(COLOR)));
     if (pdata == 0)
     {
         assert(pdata);
         return;  // fail - out of memory
     }
-    _pattern = new COLOR*[h];  // pointers to rows of pattern
+    // Pointers to rows of pattern
+    _pattern = static_cast<COLOR**>(_alloc->Allocate(h*sizeof(COLOR*)));
     if (_pattern == 0)
     {
         assert(_pattern);
-        delete[] pdata;
+        _alloc->Free(pdata);
         return;  // fail - out of memory
     }
 
-    // Copy pattern image into internal 2-D array
-    // TODO - memcpy() call below can cause access violation
+    // Copy pattern image into internal 2-D array. If the pattern texels
+    // need to be converted from RGBA (0xaabbggrr) to BGRA (0xaarrggbb)
+    // format, or vice versa, or to premultiplied-alpha format, convert
+    // them in the same pass.
+    // TODO - ConvertPixels() call below can cause access violation
     for (int i = 0; i < h; ++i)
     {
-        memcpy(pdata, &pattern[0], w*sizeof(pattern[0]));
+        ConvertPixels(pdata, &pattern[0], w, flags);
         _pattern[i] = pdata;
         pdata = &pdata[w];
         pattern = &pattern[stride];
@@ -263,8 +264,9 @@ Pattern::Pattern(const COLOR *pattern, float u0, float v0, int w, int h,
 // an ImageReader object. Input pixels are assumed to be in either
 // 32-bit RGBA (0xaabbggrr) format or 32-bit BGRA (0xaarrggbb) format.
 Pattern::Pattern(ImageReader *imgrdr, float u0, float v0,
-                 int w, int h, int flags, const float xform[6]) :
-           _w(0), _h(0), _xscroll(0), _yscroll(0)
+                 int w, int h, int flags, const float xform[6], Allocator *alloc) :
+           _alloc(alloc), _pattern(0), _w(0), _h(0), _xscroll(0), _yscroll(0),
+           _tilesrc(0), _slot(0)
 {
     if (imgrdr == 0 || w < 1 || h < 1)
     {
@@ -273,17 +275,18 @@ Pattern::Pattern(ImageReader *imgrdr, float u0, float v0,
     }
 
     // Allocate 2-D array in which to store pattern
-    COLOR *pdata = new COLOR[w*h];
+    COLOR *pdata = static_cast<COLOR*>(_alloc->Allocate(w*h*sizeof(COLOR)));
     if (pdata == 0)
     {
         assert(pdata);
         return;  // fail - out of memory
     }
-    _pattern = new COLOR*[h];  // pointers to rows of pattern
+    // Pointers to rows of pattern
+    _pattern = static_cast<COLOR**>(_alloc->Allocate(h*sizeof(COLOR*)));
     if (_pattern == 0)
     {
         assert(_pattern);
-        delete[] pdata;
+        _alloc->Free(pdata);
         return;  // fail - out of memory
     }
     COLOR *ptmp = pdata;
@@ -298,18 +301,107 @@ Pattern::Pattern(ImageReader *imgrdr, float u0, float v0,
     if (count != w*h)
     {
         assert(count == w*h);
-        delete[] pdata;
-        delete[] _pattern;
+        _alloc->Free(pdata);
+        _alloc->Free(_pattern);
+        _pattern = 0;
         return;  // fail - unexpected end of image data
     }
+
+    // Convert the pattern texels to the renderer's pixel format
+    ConvertPixels(pdata, pdata, w*h, flags);
+    _w = w, _h = h;  // mark pattern as valid
+    Init(u0, v0, flags, xform);  // finish initializing
+}
+
+// Constructor #3: Reads the pattern image from a caller-specified
+// TileSource object. Instead of loading the entire image up front,
+// the pattern reads each tile only when the FillSpan function first
+// samples a texel in the tile, and keeps the most recently used tiles
+// in a cache. The 'cachesize' parameter is the byte budget for the
+// cached tile pixels. When the cache is full, the least recently used
+// tile is evicted to make room for the new tile. Input pixels are
+// assumed to be in either 32-bit RGBA (0xaabbggrr) format or 32-bit
+// BGRA (0xaarrggbb) format.
+Pattern::Pattern(TileSource *tilesrc, float u0, float v0, int w, int h,
+                 int flags, int cachesize, const float xform[6], Allocator *alloc) :
+           _alloc(alloc), _pattern(0), _w(0), _h(0), _xscroll(0), _yscroll(0),
+           _tilesrc(0), _tflags(flags), _tshift(0), _ntx(0), _nty(0),
+           _tileslot(0), _slot(0), _nslots(0), _mru(0), _lru(0),
+           _lasttile(-1), _lastpix(0)
+{
+    if (tilesrc == 0 || w < 1 || h < 1)
+    {
+        assert(tilesrc != 0 && w > 0 && h > 0);
+        return;  // fail - invalid input parameters
+    }
+
+    // Tile width and height must be a power of two
+    int tsize = tilesrc->GetTileSize();
+    if (tsize < 1 || (tsize & (tsize - 1)) != 0)
+    {
+        assert(tsize > 0 && (tsize & (tsize - 1)) == 0);
+        return;  // fail - invalid tile size
+    }
+    while ((1 << _tshift) < tsize)
+        ++_tshift;
+
+    _ntx = (w + tsize - 1) >> _tshift;
+    _nty = (h + tsize - 1) >> _tshift;
+    int ntiles = _ntx*_nty;
+    int tbytes = tsize*tsize*sizeof(COLOR);
+
+    // The cache size is rounded down to a whole number of tiles, but
+    // the cache never holds fewer than TILECACHE_MINLEN tiles, or more
+    // tiles than are in the image
+    _nslots = cachesize/tbytes;
+    if (_nslots < TILECACHE_MINLEN)
+        _nslots = TILECACHE_MINLEN;
+    if (_nslots > ntiles)
+        _nslots = ntiles;
+
+    // Allocate the tile map, the cache slots, and the tile pixels
+    _tileslot = static_cast<int*>(_alloc->Allocate(ntiles*sizeof(int)));
+    _slot = static_cast<TILESLOT*>(_alloc->Allocate(_nslots*sizeof(TILESLOT)));
+    COLOR *pdata = static_cast<COLOR*>(_alloc->Allocate(_nslots*tbytes));
+    if (_tileslot == 0 || _slot == 0 || pdata == 0)
+    {
+        assert(_tileslot != 0 && _slot != 0 && pdata != 0);
+        _alloc->Free(_tileslot);
+        _alloc->Free(_slot);
+        _alloc->Free(pdata);
+        _tileslot = 0, _slot = 0;
+        return;  // fail - out of memory
+    }
+    for (int i = 0; i < ntiles; ++i)
+        _tileslot[i] = -1;
+
+    // Initially, all slots are empty, and are linked in array order
+    for (int i = 0; i < _nslots; ++i)
+    {
+        _slot[i].tile = -1;
+        _slot[i].prev = i - 1;
+        _slot[i].next = i + 1;
+        _slot[i].pixels = &pdata[i*tsize*tsize];
+    }
+    _mru = 0, _lru = _nslots - 1;
+    _tilesrc = tilesrc;
     _w = w, _h = h;  // mark pattern as valid
     Init(u0, v0, flags, xform);  // finish initializing
 }
 
 Pattern::~Pattern()
 {
-    delete[] _pattern[0];
-    delete[] _pattern;
+    if (_pattern != 0)
+    {
+        _alloc->Free(_pattern[0]);
+        _alloc->Free(_pattern);
+    }
+    if (_slot != 0)
+    {
+        _alloc->Free(_slot[0].pixels);
+        _alloc->Free(_slot);
+        _alloc->Free(_tileslot);
+    }
 }
 
 // Returns true if the constructor succeeded; otherwise, returns false
@@ -325,6 +417,71 @@ bool Pattern::SetScrollPosition(int x, int y)
     return true;
 }
 
+// Private function: Makes the specified tile the most recently used
+// tile in the tile cache, and points _lastpix to the tile's pixels.
+// If the tile isn't already in the cache, the least recently used
+// tile is evicted, and the new tile is read from the tile source into
+// the slot it occupied, and converted to the renderer's pixel format.
+void Pattern::LoadTile(int tile)
+{
+    int k = _tileslot[tile];
+
+    if (k < 0)
+    {
+        // Tile cache miss: Reuse the least recently used slot
+        k = _lru;
+        if (_slot[k].tile >= 0)
+            _tileslot[_slot[k].tile] = -1;  // evict old tile
+
+        int tsize = 1 << _tshift;
+        COLOR *pixels = _slot[k].pixels;
+
+        if (!_tilesrc->ReadTile(tile % _ntx, tile/_ntx, pixels))
+        {
+            assert(0);  // tile source failed, so leave tile transparent
+            memset(pixels, 0, tsize*tsize*sizeof(COLOR));
+        }
+        ConvertPixels(pixels, pixels, tsize*tsize, _tflags);
+        _slot[k].tile = tile;
+        _tileslot[tile] = k;
+    }
+    if (k != _mru)
+    {
+        // Unlink the slot and move it to the head of the LRU list
+        TILESLOT& slot = _slot[k];
+
+        _slot[slot.prev].next = slot.next;
+        if (k == _lru)
+            _lru = slot.prev;
+        else
+            _slot[slot.next].prev = slot.prev;
+
+        slot.prev = -1;
+        slot.next = _mru;
+        _slot[_mru].prev = k;
+        _mru = k;
+    }
+    _lasttile = tile;
+    _lastpix = _slot[k].pixels;
+}
+
+// Private function: Returns the texel at column i and row j of the
+// pattern image. If the pattern was read from a tile source, the
+// texel is fetched from the tile cache.
+inline COLOR Pattern::GetTexel(int i, int j)
+{
+    if (_pattern != 0)
+        return _pattern[j][i];
+
+    int tile = (j >> _tshift)*_ntx + (i >> _tshift);
+    int mask = (1 << _tshift) - 1;
+
+    if (tile != _lasttile)
+        LoadTile(tile);
+
+    return _lastpix[((j & mask) << _tshift) + (i & mask)];
+}
+
 // Public function: Fills the pixels in a single horizontal span with
 // a tiled pattern. The span starts at pixel (xs,ys) and extends to
 // the right for len pixels. The function writes the processed
@@ -340,8 +497,13 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
 
     // Map starting point (xs,ys) to pattern u-v coordinates
     xs += _xscroll, ys += _yscroll;
+#ifdef SGFIXEDPOINT
+    FIX16 u = (_uxform[0]*xs + _uxform[1]*ys + _uxform[2]) >> 16;
+    FIX16 v = (_vxform[0]*xs + _vxform[1]*ys + _vxform[2]) >> 16;
+#else
     FIX16 u = 65536*(_xform[0]*xs + _xform[2]*ys + _xform[4]);
     FIX16 v = 65536*(_xform[1]*xs + _xform[3]*ys + _xform[5]);
+#endif
     int incr = (ys & 1) ? 2 : 0;
     UVPAIR *off[2] = { _offset[incr], _offset[incr+1] };
 
@@ -369,7 +531,7 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
 
                 i = modulus(i, _w);
                 j = modulus(j, _h);
-                texel = _pattern[j][i];
+                texel = GetTexel(i, j);
                 tmp = texel & 0x00ff00ff;
                 rb += tmp;
                 ga += (texel ^ tmp) >> 8;
@@ -389,9 +551,14 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
 //
 TiledPattern* CreateTiledPattern(const COLOR *pattern, float u0, float v0,
                                  int w, int h, int stride, int flags,
-                                 const float xform[6])
+                                 const float xform[6], Allocator *alloc)
 {
-    Pattern *pat = new Pattern(pattern, u0, v0, w, h, stride, flags, xform);
+    TRACE_SCOPE("CreateTiledPattern");
+
+    if (alloc == 0)
+        alloc = GetHeapAllocator();
+
+    Pattern *pat = new Pattern(pattern, u0, v0, w, h, stride, flags, xform, alloc);
     if (pat == 0 || pat->GetStatus() == false)
     {
         assert(pat != 0 && pat->GetStatus() == true);
@@ -402,9 +569,15 @@ TiledPattern* CreateTiledPattern(const COLOR *pattern, float u0, float v0,
 }
 
 TiledPattern* CreateTiledPattern(ImageReader *imgrdr, float u0, float v0,
-                                 int w, int h, int flags, const float xform[6])
+                                 int w, int h, int flags, const float xform[6],
+                                 Allocator *alloc)
 {
-    Pattern *pat = new Pattern(imgrdr, u0, v0, w, h, flags, xform);
+    TRACE_SCOPE("CreateTiledPattern (load image)");
+
+    if (alloc == 0)
+        alloc = GetHeapAllocator();
+
+    Pattern *pat = new Pattern(imgrdr, u0, v0, w, h, flags, xform, alloc);
     if (pat == 0 || pat->GetStatus() == false)
     {
         assert(pat != 0 && pat->GetStatus() == true);
@@ -414,7 +587,103 @@ TiledPattern* CreateTiledPattern(ImageReader *imgrdr, float u0, float v0,
     return pat;  // success
 }
 
+TiledPattern* CreateTiledPattern(TileSource *tilesrc, float u0, float v0,
+                                 int w, int h, int flags, int cachesize,
+                                 const float xform[6], Allocator *alloc)
+{
+    TRACE_SCOPE("CreateTiledPattern (tile source)");
+
+    if (alloc == 0)
+        alloc = GetHeapAllocator();
 
+    Pattern *pat = new Pattern(tilesrc, u0, v0, w, h, flags, cachesize, xform, alloc);
+    if (pat == 0 || pat->GetStatus() == false)
+    {
+        assert(pat != 0 && pat->GetStatus() == true);
+        delete pat;
+        return 0;  // constructor failed
+    }
+    return pat;  // success
+}
 
+// Statically bound entry point to the FillSpan function (see pipeline.h)
+void FillPatternSpan(PaintGen *paint, int xs, int ys, int len,
+                     COLOR outBuf[], const COLOR inAlpha[])
+{
+    static_cast<Pattern*>(paint)->Pattern::FillSpan(xs, ys, len, outBuf, inAlpha);
+}
 
+//---------------------------------------------------------------------
+//
+// RawTileSource class -- Supplies tiles from a 2-D image array
+//
+//---------------------------------------------------------------------
 
+class RawTileSource : public TileSource
+{
+    const COLOR *_pixels;  // 2-D image array
+    int _w, _h;            // width and height of image
+    int _stride;           // pitch of image array, in pixels
+    int _tsize;            // tile width and height
+
+public:
+    RawTileSource(const COLOR *pixels, int w, int h, int stride, int tilesize) :
+        _pixels(pixels), _w(w), _h(h), _stride(stride), _tsize(tilesize)
+    {
+    }
+    ~RawTileSource() {}
+    bool GetStatus()
+    {
+        return (_pixels != 0 && _w > 0 && _h > 0 && _stride >= _w &&
+                _tsize > 0 && (_tsize & (_tsize - 1)) == 0);
+    }
+    int GetTileSize()
+    {
+        return _tsize;
+    }
+    bool ReadTile(int tx, int ty, COLOR *buffer);
+};
+
+// Public function: Copies the pixels in the tile at column tx and row
+// ty from the image array. A partial tile at the right or bottom edge
+// of the image is padded with transparent pixels.
+bool RawTileSource::ReadTile(int tx, int ty, COLOR *buffer)
+{
+    int x0 = tx*_tsize, y0 = ty*_tsize;
+
+    if (tx < 0 || ty < 0 || x0 >= _w || y0 >= _h)
+        return false;  // tile lies outside image
+
+    int w = min(_tsize, _w - x0);
+    int h = min(_tsize, _h - y0);
+    const COLOR *src = &_pixels[(long long)y0*_stride + x0];
+
+    for (int j = 0; j < _tsize; ++j)
+    {
+        COLOR *dst = &buffer[j*_tsize];
+
+        if (j < h)
+        {
+            memcpy(dst, src, w*sizeof(COLOR));
+            memset(&dst[w], 0, (_tsize - w)*sizeof(COLOR));
+            src = &src[_stride];
+        }
+        else
+            memset(dst, 0, _tsize*sizeof(COLOR));
+    }
+    return true;
+}
+
+// Creates a new tile source for an image array in memory
+TileSource* CreateRawTileSource(const COLOR *pixels, int w, int h,
+                                int stride, int tilesize)
+{
+    RawTileSource *tilesrc = new RawTileSource(pixels, w, h, stride, tilesize);
+    if (tilesrc == 0 || tilesrc->GetStatus() == false)
+    {
+        assert(tilesrc != 0 && tilesrc->GetStatus() == true);
+        delete tilesrc;
+        return 0;  // constructor failed
+    }
+    return tilesrc;  // success
+}
@@ -0,0 +1,359 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// pipeline.h:
+//   Private header file for the statically bound span pipeline. A
+//   ShapeGen object normally feeds a shape to its renderer through
+//   the virtual functions in the Renderer and ShapeFeeder interfaces,
+//   and the renderer paints each span through the virtual FillSpan
+//   function in the PaintGen interface. If the renderer is the
+//   library's own antialiasing renderer, the shape feeder, renderer,
+//   and paint generator are all known concrete types, and the calls
+//   between them are bound statically instead. This header defines
+//   the edge manager's shape feeder, so that the renderer can inline
+//   its span functions, and it declares the direct entry points to
+//   the renderer and to the paint generators.
+//
+//---------------------------------------------------------------------
+
+#ifndef PIPELINE_H
+  #define PIPELINE_H
+
+#include "shapepri.h"
+#include "renderer.h"
+
+//---------------------------------------------------------------------
+//
+// Shape feeder: Breaks a shape (stored as a normalized edge list) into
+// smaller pieces to feed to a renderer
+//
+// To dispense subpixel spans for antialiasing, the feeder processes
+// one pixel row at a time. The trapezoids that are active on the row
+// are kept in a contiguous array, and each trapezoid is expanded in
+// a single pass into the spans for all the subpixel rows that it
+// covers. These spans are sorted into one span set per subpixel row,
+// and the span sets are then dispensed in y-ascending order. No
+// memory is allocated, and no edges are relinked. If a pixel row has
+// more than ACTIVE_MAXLEN active trapezoids, the feeder falls back to
+// detaching the spans one at a time from the linked edge list.
+//
+//---------------------------------------------------------------------
+
+const int ACTIVE_MAXLEN = 128;  // max trapezoids active on a pixel row
+const int SUBROW_MAXLEN = 4;    // max subpixel rows per pixel row
+
+class Feeder : ShapeFeeder
+{
+    friend EdgeMgr;
+
+    EDGE *_list, *_edgeL, *_edgeR;
+    FIX16 _xL, _xR, _dxL, _dxR;
+    int _ytop, _height;
+
+    // Pixel-row iterator state for subpixel spans
+    bool _brows;       // true if row iterator is in use
+    int _yres;         // log2(subpixel rows per pixel row)
+    int _row;          // current pixel row
+    int _nactive;      // number of trapezoids in _active array
+    int _subrow;       // subpixel row of next span to dispense
+    int _index;        // index of next span in _rowspan[_subrow]
+    int _rowcount[SUBROW_MAXLEN];  // spans in each subpixel row
+    EDGE *_active[ACTIVE_MAXLEN];  // left edges of active trapezoids
+    SGSpan _rowspan[SUBROW_MAXLEN][ACTIVE_MAXLEN];  // span sets
+
+    bool ExpandNextRow();
+    bool GetNextListSpan(SGSpan *span);
+
+protected:
+    Feeder() : _list(0), _edgeL(0), _edgeR(0), _ytop(0),
+               _height(0), _xL(0), _xR(0), _dxL(0), _dxR(0),
+               _brows(false), _yres(0), _row(0), _nactive(0),
+               _subrow(0), _index(0)
+    {
+    }
+    ~Feeder()
+    {
+    }
+    void SetEdgeList(EDGE *list, int yshift)
+    {
+        if (yshift < 16)
+        {
+            _list = list;  // antialiasing
+            _yres = 16 - yshift;
+            _brows = ((1 << _yres) <= SUBROW_MAXLEN);
+            _subrow = 1 << _yres;  // no spans waiting to be dispensed
+        }
+        else
+            _edgeL = list;  // no antialiasing
+    }
+
+public:
+    bool GetNextGDIRect(SGRect *rect);
+    bool GetNextSDLRect(SGRect *rect);
+    bool GetNextSGSpan(SGSpan *span);
+    int GetNextSGSpans(SGSpan span[], int maxspans);
+};
+
+//---------------------------------------------------------------------
+//
+// This version fills in the members of the SGSpan structure, which
+// describes a subpixel span in an A-buffer. This function is called
+// by a renderer that supports antialiasing.
+//
+//---------------------------------------------------------------------
+
+inline bool Feeder::GetNextSGSpan(SGSpan *span)
+{
+    return (Feeder::GetNextSGSpans(span, 1) != 0);
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Detaches the topmost subpixel span from the next
+// trapezoid in the linked edge list, and relinks the remainder of the
+// trapezoid into the list. This is the fallback that's used if the
+// row iterator can't be used.
+//
+//---------------------------------------------------------------------
+
+inline bool Feeder::GetNextListSpan(SGSpan *span)
+{
+    if (_list == 0 && _edgeL == 0)
+        return false;
+
+    // Are any more trapezoids left in the current scan line?
+    if (_edgeL == 0)
+    {
+        // No, the next trapezoid starts on a new scan line
+        int yscan = _list->ytop;
+        EDGE *p = _list, *q = 0;
+
+        do
+        {
+            q = p->next;
+            p = q->next;
+        } while (p != 0 && yscan == p->ytop);
+        _edgeL = _list;
+        _list = p;
+        q->next = 0;
+    }
+
+    // Detach topmost span from the next trapezoid in this scan line
+    _edgeR = _edgeL->next;
+    span->xL = _edgeL->xtop;
+    span->xR = _edgeR->xtop;
+    span->y = _edgeL->ytop;
+
+    // Are there more spans left in this trapezoid?
+    if (_edgeL->dy > 1)
+    {
+        // Yes, update and save remainder of this trapezoid
+        _edgeL->ytop = _edgeR->ytop += 1;
+        _edgeL->dy -= 1;
+        _edgeR->dy += 1;
+        _edgeL->xtop += _edgeL->dxdy;
+        _edgeR->xtop += _edgeR->dxdy;
+
+        EDGE *tmp = _edgeL;
+        _edgeL = _edgeR->next;
+        _edgeR->next = _list;
+        _list = tmp;
+    }
+    else
+        _edgeL = _edgeR->next;  // discard empty trapezoid
+
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Loads the span sets for the next pixel row that
+// contains spans. First, the trapezoids that start on this row are
+// moved from the head of the edge list to the active array. Next, each
+// active trapezoid is expanded into the spans for the subpixel rows
+// that it covers. A trapezoid that extends below the pixel row is
+// advanced to the top of the next row and stays in the active array;
+// a trapezoid that ends on this row is dropped. Returns false if no
+// spans remain. If the active array is full, the function moves the
+// active trapezoids back to the head of the edge list, switches the
+// feeder to the linked-list fallback, and returns true.
+//
+//---------------------------------------------------------------------
+
+inline bool Feeder::ExpandNextRow()
+{
+    if (_nactive == 0)
+    {
+        if (_list == 0)
+            return false;  // shape is complete
+
+        _row = _list->ytop >> _yres;  // skip any empty rows
+    }
+    else
+        ++_row;
+
+    int nsub = 1 << _yres;
+    int ybase = _row << _yres;
+    int yend = ybase + nsub;
+
+    // Add the trapezoids that start on this row to the active array
+    while (_list != 0 && _list->ytop < yend)
+    {
+        if (_nactive == ACTIVE_MAXLEN)
+        {
+            // Too many trapezoids. Relink the active trapezoids, which
+            // all start at or above the trapezoids still in the list,
+            // and finish the shape with the linked-list fallback.
+            for (int i = _nactive - 1; i >= 0; --i)
+            {
+                EDGE *p = _active[i], *q = p->next;
+
+                q->ytop = p->ytop;
+                q->dy = -p->dy;
+                q->next = _list;
+                _list = p;
+            }
+            _nactive = 0;
+            _brows = false;
+            return true;
+        }
+        _active[_nactive++] = _list;
+        _list = _list->next->next;
+    }
+
+    // Expand each active trapezoid into spans in a single pass
+    int n = 0;
+
+    for (int k = 0; k < nsub; ++k)
+        _rowcount[k] = 0;
+
+    for (int i = 0; i < _nactive; ++i)
+    {
+        EDGE *p = _active[i], *q = p->next;
+        FIX16 xL = p->xtop, xR = q->xtop;
+        int k = p->ytop - ybase;
+        int kend = min(k + p->dy, nsub);
+        int height = p->dy - (kend - k);
+
+        for (; k < kend; ++k)
+        {
+            SGSpan *span = &_rowspan[k][_rowcount[k]++];
+
+            span->xL = xL;
+            span->xR = xR;
+            span->y = ybase + k;
+            xL += p->dxdy;
+            xR += q->dxdy;
+        }
+        if (height > 0)
+        {
+            // Save remainder of trapezoid for next pixel row
+            p->ytop = yend;
+            p->dy = height;
+            p->xtop = xL;
+            q->xtop = xR;
+            _active[n++] = p;
+        }
+    }
+    _nactive = n;
+    _subrow = 0;
+    _index = 0;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Dispenses a batch of up to 'maxspans' subpixel spans in y-ascending
+// order. Returns the number of spans written to the 'span' array, or
+// zero if no spans remain.
+//
+//---------------------------------------------------------------------
+
+inline int Feeder::GetNextSGSpans(SGSpan span[], int maxspans)
+{
+    int nsub = 1 << _yres;
+    int count = 0;
+
+    while (count < maxspans && _brows)
+    {
+        // Copy spans from the span sets for the current pixel row
+        if (_subrow < nsub)
+        {
+            SGSpan *rowspan = _rowspan[_subrow];
+            int len = min(maxspans - count, _rowcount[_subrow] - _index);
+
+            for (int i = 0; i < len; ++i)
+                span[count++] = rowspan[_index++];
+
+            if (_index == _rowcount[_subrow])
+            {
+                ++_subrow;
+                _index = 0;
+            }
+        }
+        else if (ExpandNextRow() == false)
+            return count;  // shape is complete
+    }
+
+    // Use the linked-list fallback if row iterator isn't in use
+    while (count < maxspans && GetNextListSpan(&span[count]))
+        ++count;
+
+    return count;
+}
+
+//---------------------------------------------------------------------
+//
+// Statically bound entry points. If its renderer is an AA4x8Renderer
+// object (see QueryAA4x8Renderer in shapegen.h), the ShapeGen object
+// calls the RenderShapeStatic function instead of the renderer's
+// virtual RenderShape function. The renderer calls the Fill*Span
+// functions instead of the virtual PaintGen::FillSpan function. Each
+// Fill*Span function calls the FillSpan function of one concrete
+// paint generator class directly, and is defined in the same source
+// file as that class, so that the compiler can inline the call.
+//
+//---------------------------------------------------------------------
+
+void RenderShapeStatic(AA4x8Renderer *renderer, Feeder *feeder);
+
+// Concrete paint types, which the renderer uses to select the
+// statically bound Fill*Span function once per shape
+enum PAINTTYPE {
+    PAINT_SOLID,     // solid color, no paint generator
+    PAINT_PATTERN,   // tiled pattern
+    PAINT_LINEAR,    // linear gradient
+    PAINT_RADIAL,    // radial gradient
+    PAINT_CONIC,     // conic gradient
+};
+
+void FillPatternSpan(PaintGen *paint, int xs, int ys, int len,
+                     COLOR outBuf[], const COLOR inAlpha[]);
+void FillLinearSpan(PaintGen *paint, int xs, int ys, int len,
+                    COLOR outBuf[], const COLOR inAlpha[]);
+void FillRadialSpan(PaintGen *paint, int xs, int ys, int len,
+                    COLOR outBuf[], const COLOR inAlpha[]);
+void FillConicSpan(PaintGen *paint, int xs, int ys, int len,
+                   COLOR outBuf[], const COLOR inAlpha[]);
+
+#endif // PIPELINE_H
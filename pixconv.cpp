@@ -0,0 +1,250 @@
+/*
+  Copyright (C) 2022-2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// pixconv.cpp:
+//   Pixel-format conversion utilities for 32-bit pixels. These
+//   functions swap the red and blue fields (to convert between RGBA
+//   (0xaabbggrr) and BGRA (0xaarrggbb) formats), premultiply pixels
+//   by their alphas, and undo the premultiplication. The swap and the
+//   premultiplication can be fused into a single pass over the pixel
+//   data. Each function reads 'len' pixels from the 'src' array and
+//   writes the converted pixels to the 'dst' array. The two arrays can
+//   be the same array (for in-place conversion), but must otherwise
+//   not overlap. If the target processor supports SSE2, the swap and
+//   premultiply functions convert four pixels at a time. The results
+//   are identical to those of the scalar code.
+//
+//---------------------------------------------------------------------
+
+#include <assert.h>
+#include "simd.h"
+#include "renderer.h"
+
+//---------------------------------------------------------------------
+//
+// Local functions and data
+//
+//---------------------------------------------------------------------
+
+namespace {
+    // Swaps the red and blue fields in a 32-bit pixel
+    inline COLOR SwapRB(COLOR pixel)
+    {
+        COLOR rb = pixel & 0x00ff00ff;
+
+        return (pixel ^ rb) | (rb << 16) | (rb >> 16);
+    }
+
+    // Premultiplies a 32-bit pixel's color components by its alpha.
+    // The pixel is in either BGRA or RGBA format.
+    inline COLOR Premult(COLOR pixel)
+    {
+        COLOR rb, ga, alfa = pixel >> 24;
+
+        if (alfa == 255)
+            return pixel;
+
+        if (alfa == 0)
+            return 0;
+
+        pixel |= 0xff000000;
+        rb = pixel & 0x00ff00ff;
+        rb *= alfa;
+        rb += 0x00800080;
+        rb += (rb >> 8) & 0x00ff00ff;
+        rb = (rb >> 8) & 0x00ff00ff;
+        ga = (pixel >> 8) & 0x00ff00ff;
+        ga *= alfa;
+        ga += 0x00800080;
+        ga += (ga >> 8) & 0x00ff00ff;
+        ga &= 0xff00ff00;
+        return ga | rb;
+    }
+
+    // Table of reciprocals for un-premultiplying pixels. For alpha
+    // values a = 1 to 255, element a is the 16.16 fixed-point value
+    // of 255/a. Element 0 is not used.
+    struct RECIPROCALS
+    {
+        unsigned int val[256];
+
+        RECIPROCALS()
+        {
+            val[0] = 0;
+            for (int a = 1; a < 256; ++a)
+                val[a] = ((255 << 16) + a/2)/a;
+        }
+    } recip;
+
+    // Un-premultiplies a 32-bit pixel's color components. The pixel is
+    // in either BGRA or RGBA format. Components that exceed the alpha
+    // value (which is invalid for premultiplied pixels) are set to 255.
+    inline COLOR Unpremult(COLOR pixel)
+    {
+        COLOR alfa = pixel >> 24;
+
+        if (alfa == 255 || alfa == 0)
+            return pixel;
+
+        unsigned int r = recip.val[alfa];
+        COLOR c0 = ((pixel & 255)*r + 0x8000) >> 16;
+        COLOR c1 = (((pixel >> 8) & 255)*r + 0x8000) >> 16;
+        COLOR c2 = (((pixel >> 16) & 255)*r + 0x8000) >> 16;
+
+        c0 |= (255 - c0) >> 24;
+        c1 |= (255 - c1) >> 24;
+        c2 |= (255 - c2) >> 24;
+        return (alfa << 24) | ((c2 & 255) << 16) | ((c1 & 255) << 8) | (c0 & 255);
+    }
+
+#ifdef SG_USE_SSE2
+    // Swaps the red and blue fields in four pixels at a time
+    inline __m128i SwapRB4(__m128i pix)
+    {
+        __m128i rb = _mm_and_si128(pix, _mm_set1_epi32(0x00ff00ff));
+        __m128i ga = _mm_xor_si128(pix, rb);
+
+        rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        return _mm_or_si128(ga, rb);
+    }
+
+    // Premultiplies two pixels that have been unpacked to 16-bit
+    // components. Uses the same rounding as the scalar code.
+    inline __m128i Premult2(__m128i pix)
+    {
+        __m128i alfa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pix, 0xff), 0xff);
+        __m128i t = _mm_mullo_epi16(pix, alfa);
+
+        t = _mm_add_epi16(t, _mm_set1_epi16(0x80));
+        t = _mm_add_epi16(t, _mm_srli_epi16(t, 8));
+        return _mm_srli_epi16(t, 8);
+    }
+
+    // Premultiplies four pixels at a time
+    inline __m128i Premult4(__m128i pix)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i alfa = _mm_and_si128(pix, _mm_set1_epi32(0xff000000));
+        __m128i lo = Premult2(_mm_unpacklo_epi8(pix, zero));
+        __m128i hi = Premult2(_mm_unpackhi_epi8(pix, zero));
+
+        // Premult2 multiplies the alpha field by itself, so restore
+        // the original alpha values
+        pix = _mm_packus_epi16(lo, hi);
+        pix = _mm_andnot_si128(_mm_set1_epi32(0xff000000), pix);
+        return _mm_or_si128(pix, alfa);
+    }
+#endif
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions
+//
+//---------------------------------------------------------------------
+
+// Swaps the red and blue fields in each pixel, to convert RGBA pixels
+// to BGRA format, or BGRA pixels to RGBA format
+void SwapRedBlue(COLOR *dst, const COLOR *src, int len)
+{
+    assert(dst != 0 && src != 0);
+    int i = 0;
+#ifdef SG_USE_SSE2
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]), SwapRB4(pix));
+    }
+#endif
+    for (; i < len; ++i)
+        dst[i] = SwapRB(src[i]);
+}
+
+// Premultiplies each pixel's color components by its alpha
+void PremultiplyAlpha(COLOR *dst, const COLOR *src, int len)
+{
+    assert(dst != 0 && src != 0);
+    int i = 0;
+#ifdef SG_USE_SSE2
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]), Premult4(pix));
+    }
+#endif
+    for (; i < len; ++i)
+        dst[i] = Premult(src[i]);
+}
+
+// Swaps the red and blue fields in each pixel and premultiplies the
+// pixel's color components by its alpha, in a single pass
+void SwapRedBluePremultiplyAlpha(COLOR *dst, const COLOR *src, int len)
+{
+    assert(dst != 0 && src != 0);
+    int i = 0;
+#ifdef SG_USE_SSE2
+    for (; i + 4 <= len; i += 4)
+    {
+        __m128i pix = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]), Premult4(SwapRB4(pix)));
+    }
+#endif
+    for (; i < len; ++i)
+        dst[i] = Premult(SwapRB(src[i]));
+}
+
+// Converts premultiplied-alpha pixels to straight-alpha pixels. A
+// table of reciprocals replaces the per-component divisions.
+void UnpremultiplyAlpha(COLOR *dst, const COLOR *src, int len)
+{
+    assert(dst != 0 && src != 0);
+    for (int i = 0; i < len; ++i)
+        dst[i] = Unpremult(src[i]);
+}
+
+// Converts pixels as specified by the FLAG_SWAP_REDBLUE and
+// FLAG_PREMULTALPHA bits in 'flags'. If FLAG_SWAP_REDBLUE is set, the
+// red and blue fields are swapped. If FLAG_PREMULTALPHA is _not_ set,
+// the pixels are premultiplied by their alphas. Other flag bits are
+// ignored. Both steps are done in a single pass over the pixels. If
+// neither conversion is needed, the pixels are simply copied.
+void ConvertPixels(COLOR *dst, const COLOR *src, int len, int flags)
+{
+    bool bswap = (flags & FLAG_SWAP_REDBLUE) != 0;
+    bool bpremult = (flags & FLAG_PREMULTALPHA) == 0;
+
+    if (bswap && bpremult)
+        SwapRedBluePremultiplyAlpha(dst, src, len);
+    else if (bswap)
+        SwapRedBlue(dst, src, len);
+    else if (bpremult)
+        PremultiplyAlpha(dst, src, len);
+    else if (dst != src)
+    {
+        for (int i = 0; i < len; ++i)
+            dst[i] = src[i];
+    }
+}
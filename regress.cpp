@@ -0,0 +1,636 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+//  regress.cpp:
+//    Console main program that checks the demo and SVG viewer output
+//    for changes in appearance and speed. It replaces the platform-
+//    specific main program (for example, sdlmain.cpp), and is linked
+//    either with demo.cpp, to render each entry in the demo's test
+//    function table, or with svgview.cpp, to render a list of SVG
+//    files. Each image is rendered into an offscreen buffer, and its
+//    pixels are compared with a stored reference image. The rendering
+//    time is compared with a stored baseline time at the same time.
+//
+//    Usage:  regress [options] refdir [svgfile ...]
+//
+//    -record       Store the reference images and baseline times in
+//                  directory refdir instead of checking against them
+//    -tolerance n  Allow each color component of a pixel to differ
+//                  from the reference by up to n (default is 0)
+//    -slowdown f   Report a test as slow if its time exceeds the
+//                  baseline by more than fraction f (default is 0.25)
+//    -repeat n     Render each image n times and use the shortest of
+//                  the times (default is 3)
+//
+//    The reference images are stored as 32-bit BMP files, and the
+//    baseline times are stored in the text file timing.txt. The exit
+//    code is 0 if all the tests pass, and is 1 if any image differs
+//    from its reference or any test is slow.
+//
+//    When linked with demo.cpp, the program also runs display list
+//    checks, which need no reference images. Each check draws the same
+//    frame in two different ways, and compares the results pixel for
+//    pixel.
+//
+//---------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "demo.h"
+
+// Make command-line args globally accessible (see svgview.cpp)
+int _argc_ = 0;
+char **_argv_ = 0;
+
+// Sends message to user as text on the console
+void UserMessage::ShowMessage(char *text, char *caption, int msgcode)
+{
+    fprintf(stderr, "%s: %s\n", caption, text);
+}
+
+namespace {
+    const int NAME_MAXLEN = 256;
+    const int TIMING_MAXLEN = 1024;   // max entries in timing file
+    const double MIN_SLOWDOWN_MSEC = 2.0;  // ignore smaller slowdowns
+    const COLOR CLEAR_COLOR = RGBX(255,255,255);
+    const char TIMING_FILENAME[] = "timing.txt";
+
+    enum TESTRESULT { TEST_PASS, TEST_FAIL, TEST_SLOW };
+
+    // Command-line options
+    bool _brecord = false;
+    int _tolerance = 0;
+    double _slowdown = 0.25;
+    int _repeat = 3;
+
+    // Baseline times read from (or to be written to) timing file
+    struct TIMING {
+        char name[NAME_MAXLEN];
+        double msec;
+    };
+    TIMING _timing[TIMING_MAXLEN];
+    int _timingcount = 0;
+
+    //-------------------------------------------------------------------
+    //
+    // Reference images are stored in 32-bit BMP files. The pixels are
+    // stored top-down (negative height) in BGRA byte order, which is
+    // the renderer's native BGRA32 pixel format (0xaarrggbb) in little-
+    // endian memory. The header fields are written and read one byte
+    // at a time so that the file layout doesn't depend on the host.
+    //
+    //-------------------------------------------------------------------
+
+    const int BMP_HEADER_SIZE = 14 + 40;  // file header + info header
+
+    void PutInt(unsigned char *p, unsigned val, int nbytes)
+    {
+        for (int i = 0; i < nbytes; ++i)
+            p[i] = (val >> 8*i) & 255;
+    }
+
+    unsigned GetInt(const unsigned char *p, int nbytes)
+    {
+        unsigned val = 0;
+
+        for (int i = nbytes - 1; i >= 0; --i)
+            val = (val << 8) | p[i];
+
+        return val;
+    }
+
+    bool WriteImage(const char *filename, const PIXEL_BUFFER& buf)
+    {
+        unsigned char hdr[BMP_HEADER_SIZE];
+        int rowsize = buf.width*sizeof(COLOR);
+        FILE *fp = fopen(filename, "wb");
+
+        if (fp == 0)
+            return false;
+
+        memset(hdr, 0, sizeof(hdr));
+        hdr[0] = 'B', hdr[1] = 'M';
+        PutInt(&hdr[2], BMP_HEADER_SIZE + rowsize*buf.height, 4);  // file size
+        PutInt(&hdr[10], BMP_HEADER_SIZE, 4);  // offset to pixel data
+        PutInt(&hdr[14], 40, 4);               // info header size
+        PutInt(&hdr[18], buf.width, 4);
+        PutInt(&hdr[22], -buf.height, 4);      // top-down image
+        PutInt(&hdr[26], 1, 2);                // number of planes
+        PutInt(&hdr[28], 32, 2);               // bits per pixel
+        PutInt(&hdr[34], rowsize*buf.height, 4);  // size of pixel data
+        fwrite(hdr, sizeof(hdr), 1, fp);
+        for (int y = 0; y < buf.height; ++y)
+        {
+            const COLOR *row = &buf.pixels[y*buf.pitch/sizeof(COLOR)];
+
+            for (int x = 0; x < buf.width; ++x)
+            {
+                unsigned char pix[4];
+
+                PutInt(pix, row[x], 4);
+                fwrite(pix, sizeof(pix), 1, fp);
+            }
+        }
+        return (fclose(fp) == 0);
+    }
+
+    // Reads a reference image written by WriteImage into 'buf', which
+    // is already allocated. Returns false if the file can't be read or
+    // doesn't contain an image of the same size as 'buf'.
+    bool ReadImage(const char *filename, PIXEL_BUFFER *buf)
+    {
+        unsigned char hdr[BMP_HEADER_SIZE];
+        FILE *fp = fopen(filename, "rb");
+
+        if (fp == 0)
+            return false;
+
+        if (fread(hdr, sizeof(hdr), 1, fp) != 1 ||
+            hdr[0] != 'B' || hdr[1] != 'M' ||
+            GetInt(&hdr[10], 4) != BMP_HEADER_SIZE ||
+            (int)GetInt(&hdr[18], 4) != buf->width ||
+            (int)GetInt(&hdr[22], 4) != -buf->height ||
+            GetInt(&hdr[28], 2) != 32)
+        {
+            fclose(fp);
+            return false;  // not the expected image format or size
+        }
+        for (int y = 0; y < buf->height; ++y)
+        {
+            COLOR *row = &buf->pixels[y*buf->pitch/sizeof(COLOR)];
+
+            for (int x = 0; x < buf->width; ++x)
+            {
+                unsigned char pix[4];
+
+                if (fread(pix, sizeof(pix), 1, fp) != 1)
+                {
+                    fclose(fp);
+                    return false;  // file is truncated
+                }
+                row[x] = GetInt(pix, 4);
+            }
+        }
+        fclose(fp);
+        return true;
+    }
+
+    // Compares two images. Returns the number of pixels in which any
+    // color component differs by more than _tolerance, and sets
+    // *maxdiff to the largest difference in any component.
+    int CompareImages(const PIXEL_BUFFER& buf, const PIXEL_BUFFER& ref, int *maxdiff)
+    {
+        int ndiff = 0;
+
+        *maxdiff = 0;
+        for (int y = 0; y < buf.height; ++y)
+        {
+            const COLOR *row = &buf.pixels[y*buf.pitch/sizeof(COLOR)];
+            const COLOR *refrow = &ref.pixels[y*ref.pitch/sizeof(COLOR)];
+
+            for (int x = 0; x < buf.width; ++x)
+            {
+                int pixdiff = 0;
+
+                if (row[x] == refrow[x])
+                    continue;
+
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    int diff = ((row[x] >> shift) & 255) - ((refrow[x] >> shift) & 255);
+
+                    pixdiff = max(pixdiff, (diff < 0) ? -diff : diff);
+                }
+                *maxdiff = max(*maxdiff, pixdiff);
+                if (pixdiff > _tolerance)
+                    ++ndiff;
+            }
+        }
+        return ndiff;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Baseline times
+    //
+    //-------------------------------------------------------------------
+
+    void ReadTimingFile(const char *refdir)
+    {
+        char filename[NAME_MAXLEN];
+        FILE *fp;
+
+        sprintf(filename, "%.200s/%s", refdir, TIMING_FILENAME);
+        fp = fopen(filename, "r");
+        if (fp == 0)
+            return;  // no baselines, so times won't be checked
+
+        while (_timingcount < TIMING_MAXLEN &&
+               fscanf(fp, "%255s %lf", _timing[_timingcount].name,
+                      &_timing[_timingcount].msec) == 2)
+        {
+            ++_timingcount;
+        }
+        fclose(fp);
+    }
+
+    bool WriteTimingFile(const char *refdir)
+    {
+        char filename[NAME_MAXLEN];
+        FILE *fp;
+
+        sprintf(filename, "%.200s/%s", refdir, TIMING_FILENAME);
+        fp = fopen(filename, "w");
+        if (fp == 0)
+            return false;
+
+        for (int i = 0; i < _timingcount; ++i)
+            fprintf(fp, "%s %.3f\n", _timing[i].name, _timing[i].msec);
+
+        return (fclose(fp) == 0);
+    }
+
+    // Returns the baseline time for the named test, or -1 if none
+    double FindBaseline(const char *name)
+    {
+        for (int i = 0; i < _timingcount; ++i)
+            if (strcmp(_timing[i].name, name) == 0)
+                return _timing[i].msec;
+
+        return -1;
+    }
+
+    // Fills the image with the clear color
+    void ClearImage(const PIXEL_BUFFER& buf)
+    {
+        for (int y = 0; y < buf.height; ++y)
+        {
+            COLOR *row = &buf.pixels[y*buf.pitch/sizeof(COLOR)];
+
+            for (int x = 0; x < buf.width; ++x)
+                row[x] = CLEAR_COLOR;
+        }
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Test runner
+    //
+    //-------------------------------------------------------------------
+
+    // Renders the specified test _repeat times, and returns the shortest
+    // time, in milliseconds. Also returns the test number reported by
+    // RunTest, which is negative if the test could not be run.
+    double RenderTest(int testnum, const PIXEL_BUFFER& bkbuf,
+                      const SGRect& cliprect, int *result)
+    {
+        double best = 0;
+
+        for (int i = 0; i < _repeat; ++i)
+        {
+            clock_t start;
+            double msec;
+
+            ClearImage(bkbuf);
+            start = clock();
+            *result = RunTest(testnum, bkbuf, cliprect);
+            msec = 1000.0*(clock() - start)/CLOCKS_PER_SEC;
+            best = (i == 0) ? msec : min(best, msec);
+        }
+        return best;
+    }
+
+    // Forms the test name from the SVG filename (without directory or
+    // extension), or from the demo test number
+    void GetTestName(char *name, int testnum, const char *svgfile)
+    {
+        if (svgfile == 0)
+        {
+            sprintf(name, "demo-%02d", testnum);
+            return;
+        }
+
+        const char *p = strrchr(svgfile, '/');
+        const char *q = strrchr(svgfile, '\\');
+        int len;
+
+        p = (p == 0 || (q != 0 && q > p)) ? q : p;
+        p = (p == 0) ? svgfile : p + 1;
+        len = strcspn(p, ".");
+        sprintf(name, "svg-%.*s", min(len, NAME_MAXLEN - 8), p);
+    }
+
+    // Runs one test. In record mode, stores the reference image and the
+    // baseline time. Otherwise, checks the image and the time against
+    // the stored references. Returns the outcome of the test.
+    TESTRESULT CheckTest(const char *name, double msec, const PIXEL_BUFFER& bkbuf,
+                   PIXEL_BUFFER *refbuf, const char *refdir)
+    {
+        char filename[NAME_MAXLEN + 256];
+        int ndiff, maxdiff;
+        double baseline;
+        bool bslow;
+
+        sprintf(filename, "%.200s/%s.bmp", refdir, name);
+        if (_brecord)
+        {
+            if (_timingcount < TIMING_MAXLEN)
+            {
+                strcpy(_timing[_timingcount].name, name);
+                _timing[_timingcount++].msec = msec;
+            }
+            if (WriteImage(filename, bkbuf) == false)
+            {
+                printf("%-24s ERROR  can't write %s\n", name, filename);
+                return TEST_FAIL;
+            }
+            printf("%-24s RECORD %9.2f ms\n", name, msec);
+            return TEST_PASS;
+        }
+        if (ReadImage(filename, refbuf) == false)
+        {
+            printf("%-24s ERROR  can't read %s\n", name, filename);
+            return TEST_FAIL;
+        }
+        ndiff = CompareImages(bkbuf, *refbuf, &maxdiff);
+        baseline = FindBaseline(name);
+        bslow = (baseline >= 0 && msec > baseline*(1 + _slowdown) &&
+                 msec - baseline > MIN_SLOWDOWN_MSEC);
+        printf("%-24s %-6s %9.2f ms", name,
+               (ndiff != 0) ? "FAIL" : (bslow) ? "SLOW" : "PASS", msec);
+        if (baseline >= 0)
+            printf(" (baseline %.2f ms, %+.0f%%)", baseline, 100*(msec/max(baseline, 0.001) - 1));
+        if (maxdiff != 0)
+            printf(", %d pixels differ, max diff %d", ndiff, maxdiff);
+
+        printf("\n");
+        return (ndiff != 0) ? TEST_FAIL : (bslow) ? TEST_SLOW : TEST_PASS;
+    }
+
+    //-------------------------------------------------------------------
+    //
+    // Display list checks
+    //
+    //-------------------------------------------------------------------
+
+    // Records one frame of a test scene: overlapping filled and stroked
+    // shapes, some of them translucent or filled with a gradient.
+    // Between frames 0 and 1, one ellipse in the middle of the scene
+    // moves and changes color.
+    void RecordScene(DisplayList *dlist, int frame)
+    {
+        SGRect rect[] = {
+            {  40,  30, 300, 220 }, { 420, 260, 180, 160 },
+            { 250, 180, 260, 120 }, { 100, 330, 200, 100 },
+        };
+        SGPoint curve[] = {
+            { 60, 420 }, { 200, 100 }, { 420, 500 }, { 580, 120 },
+        };
+        char dash[] = { 5, 2, 1, 2, 0 };
+
+        dlist->Reset();
+        dlist->BeginPath();
+        dlist->Rectangle(rect[0]);
+        dlist->ResetColorStops();
+        dlist->AddColorStop(0, RGBX(255,220,80));
+        dlist->AddColorStop(1.0f, RGBX(40,120,240));
+        dlist->SetLinearGradient(40,30, 340,250, SPREAD_PAD);
+        dlist->FillPath();
+        for (int i = 1; i < 4; ++i)
+        {
+            dlist->BeginPath();
+            dlist->Rectangle(rect[i]);
+            dlist->SetColor(RGBX(60*i,180,255 - 60*i));
+            dlist->FillPath();
+        }
+
+        // The ellipse that changes between frames
+        SGPoint v0 = { 260 + 120*frame, 220 }, v1 = v0, v2 = v0;
+        v1.x += 90, v2.y -= 60;
+        dlist->BeginPath();
+        dlist->Ellipse(v0, v1, v2);
+        dlist->SetColor((frame == 0) ? RGBX(200,40,40) : RGBX(40,160,40));
+        dlist->FillPath();
+
+        // Translucent and stroked shapes drawn on top of the ellipse
+        SGPoint c = { 400, 200 }, c1 = { 480, 240 }, c2 = { 360, 280 };
+        dlist->BeginPath();
+        dlist->Ellipse(c, c1, c2);
+        dlist->SetColor(RGBX(0,0,128));
+        dlist->SetConstantAlpha(128);
+        dlist->FillPath();
+        dlist->SetConstantAlpha(255);
+        dlist->BeginPath();
+        dlist->Move(curve[0].x, curve[0].y);
+        dlist->Bezier3(curve[1], curve[2], curve[3]);
+        dlist->SetLineWidth(7.0f);
+        dlist->SetLineJoin(LINEJOIN_ROUND);
+        dlist->SetLineDash(dash, 0, 3.0f);
+        dlist->SetColor(RGBX(0,0,0));
+        dlist->StrokePath();
+        dlist->SetLineDash();
+    }
+
+    // Clears the image and draws the full frame in the display list
+    void DrawFrame(DisplayList *dlist, const PIXEL_BUFFER& buf,
+                   const SGRect& cliprect)
+    {
+        SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&buf));
+        SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), cliprect));
+
+        ClearImage(buf);
+        dlist->Render(&(*sg), &(*aarend));
+    }
+
+    // Prints the outcome of a display list check, which passes only if
+    // the two images are identical and 'bdone' is true (that is, the
+    // check actually exercised the code under test)
+    TESTRESULT ReportCheck(const char *name, const char *info, bool bdone,
+                           const PIXEL_BUFFER& buf, const PIXEL_BUFFER& ref)
+    {
+        int maxdiff, ndiff = CompareImages(buf, ref, &maxdiff);
+        bool bpass = (bdone && maxdiff == 0);
+
+        printf("%-24s %-6s %s", name, (bpass) ? "PASS" : "FAIL", info);
+        if (maxdiff != 0)
+            printf(", %d pixels differ, max diff %d", ndiff, maxdiff);
+
+        printf("\n");
+        return (bpass) ? TEST_PASS : TEST_FAIL;
+    }
+
+    // Draws frame 0 of the test scene, and then updates it to frame 1
+    // by redrawing only the dirty rectangles. The result is compared
+    // with a full redraw of frame 1. The frame is scrolled so that
+    // RenderRegion has to map the regions to the back buffer.
+    TESTRESULT CheckDirtyRects(const PIXEL_BUFFER& bkbuf, PIXEL_BUFFER *refbuf)
+    {
+        SGRect cliprect = { 17, 9, bkbuf.width, bkbuf.height };
+        SGRect dirty[MAX_DIRTY_RECTS];
+        DisplayList frame0, frame1;
+        char info[64];
+        int ndirty;
+
+        RecordScene(&frame0, 0);
+        RecordScene(&frame1, 1);
+        DrawFrame(&frame0, bkbuf, cliprect);
+        ndirty = frame1.FindDirtyRects(&frame0, dirty);
+        for (int i = 0; i < ndirty; ++i)
+            frame1.RenderRegion(bkbuf, cliprect, dirty[i], CLEAR_COLOR);
+
+        DrawFrame(&frame1, *refbuf, cliprect);
+        sprintf(info, "%d dirty rects", ndirty);
+        return ReportCheck("dlist-dirty-rects", info, ndirty != 0, bkbuf, *refbuf);
+    }
+
+    // Draws the test scene covered by two rectangles, one translucent
+    // and one opaque, and then draws it again after culling the shapes
+    // that the opaque rectangle hides. Culling must remove at least one
+    // shape, and must not change the image.
+    TESTRESULT CheckCulling(const PIXEL_BUFFER& bkbuf, PIXEL_BUFFER *refbuf)
+    {
+        SGRect cliprect = { 0, 0, bkbuf.width, bkbuf.height };
+        SGRect cover[] = { { 400, 240, 220, 200 }, { 80, 300, 260, 150 } };
+        DisplayList dlist;
+        char info[64];
+        int nculled;
+
+        RecordScene(&dlist, 0);
+        for (int i = 0; i < 2; ++i)
+        {
+            dlist.BeginPath();
+            dlist.Rectangle(cover[i]);
+            dlist.SetColor(RGBX(90,90,90));
+            dlist.SetConstantAlpha((i == 0) ? 160 : 255);
+            dlist.FillPath();
+        }
+        DrawFrame(&dlist, *refbuf, cliprect);
+        nculled = dlist.CullHiddenShapes();
+        DrawFrame(&dlist, bkbuf, cliprect);
+        sprintf(info, "%d shapes culled", nculled);
+        return ReportCheck("dlist-cull", info, nculled != 0, bkbuf, *refbuf);
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Main program: Parses the command line, and then runs the tests. If
+// SVG filenames are listed on the command line, the program (which
+// must be linked with svgview.cpp) renders these files. Otherwise, the
+// program (linked with demo.cpp) renders each demo test function in
+// turn until the test numbers wrap around to zero.
+//
+//---------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if (strcmp(argv[arg], "-record") == 0)
+            _brecord = true;
+        else if (strcmp(argv[arg], "-tolerance") == 0 && arg + 1 < argc)
+            _tolerance = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-slowdown") == 0 && arg + 1 < argc)
+            _slowdown = atof(argv[++arg]);
+        else if (strcmp(argv[arg], "-repeat") == 0 && arg + 1 < argc)
+        {
+            int n = atoi(argv[++arg]);  // max() is a macro
+            _repeat = max(n, 1);
+        }
+        else
+            break;  // unknown option
+    }
+    if (arg >= argc || argv[arg][0] == '-')
+    {
+        fprintf(stderr, "Usage: %s [-record] [-tolerance n] [-slowdown f] "
+                "[-repeat n] refdir [svgfile ...]\n", argv[0]);
+        return 1;
+    }
+
+    const char *refdir = argv[arg];
+    int nsvg = argc - arg - 1;
+    PIXEL_BUFFER bkbuf, refbuf;
+    SGRect cliprect = { 0, 0, DEMO_WIDTH, DEMO_HEIGHT };
+    int count[3] = { 0, 0, 0 };  // indexed by TESTRESULT value
+
+    // The SVG viewer's RunTest function reads SVG filenames from
+    // _argv_[1] through _argv_[_argc_-1]
+    _argc_ = nsvg + 1;
+    _argv_ = &argv[arg];
+
+    bkbuf.width = refbuf.width = DEMO_WIDTH;
+    bkbuf.height = refbuf.height = DEMO_HEIGHT;
+    bkbuf.depth = refbuf.depth = 32;
+    bkbuf.pitch = refbuf.pitch = DEMO_WIDTH*sizeof(COLOR);
+    bkbuf.pixels = AllocateRawPixels(DEMO_WIDTH, DEMO_HEIGHT);
+    refbuf.pixels = AllocateRawPixels(DEMO_WIDTH, DEMO_HEIGHT);
+    if (bkbuf.pixels == 0 || refbuf.pixels == 0)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if (_brecord == false)
+        ReadTimingFile(refdir);
+
+    for (int testnum = 0; ; ++testnum)
+    {
+        char name[NAME_MAXLEN];
+        int result;
+        double msec;
+
+        if (nsvg != 0 && testnum == nsvg)
+            break;  // all SVG files are done
+
+        msec = RenderTest(testnum, bkbuf, cliprect, &result);
+        if (result != testnum)
+        {
+            if (result < 0)
+                ++count[TEST_FAIL];  // test could not be run
+
+            break;  // demo test numbers have wrapped around
+        }
+        GetTestName(name, testnum, (nsvg != 0) ? argv[arg + 1 + testnum] : 0);
+        ++count[CheckTest(name, msec, bkbuf, &refbuf, refdir)];
+    }
+    if (nsvg == 0)
+    {
+        // Run the display list checks once, with the demo tests
+        ++count[CheckDirtyRects(bkbuf, &refbuf)];
+        ++count[CheckCulling(bkbuf, &refbuf)];
+    }
+    if (_brecord && WriteTimingFile(refdir) == false)
+    {
+        fprintf(stderr, "Can't write timing file in %s\n", refdir);
+        ++count[TEST_FAIL];
+    }
+    printf("%d passed, %d failed, %d slow\n",
+           count[TEST_PASS], count[TEST_FAIL], count[TEST_SLOW]);
+    DeleteRawPixels(bkbuf.pixels);
+    DeleteRawPixels(refbuf.pixels);
+    return (count[TEST_FAIL] + count[TEST_SLOW] == 0) ? 0 : 1;
+}
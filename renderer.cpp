@@ -22,11 +22,11 @@
 //---------------------------------------------------------------------
 //
 //  renderer.cpp:
-//    This file contains the implementations of the BasicRenderer and
-//    AA4x8Renderer classes declared in renderer.h. This rendering
-//    code is platform-INdependent: the renderers write directly to
-//    a window-backing buffer (or back buffer) that is described by a
-//    PIXEL_BUFFER structure. The only platform-dependent code needed
+//    This file contains the implementations of the BasicRenderer,
+//    AA4x8Renderer, and DraftRenderer classes declared in renderer.h.
+//    This rendering code is platform-INdependent: the renderers write
+//    directly to a window-backing buffer (or back buffer) that is
+//    described by a PIXEL_BUFFER structure. The only platform-dependent code needed
 //    is the BitBlt function call (contained in separate module) that
 //    copies the back buffer to the window on the display. The back
 //    buffer has a 32-bit BGRA pixel format (that is, 0xaarrggbb).
@@ -35,7 +35,12 @@
 
 #include <string.h>
 #include <assert.h>
-#include "renderer.h"
+#include <math.h>
+
+// SSE2 is used for solid fills if the target processor supports it
+#include "simd.h"
+#include "pipeline.h"
+#include "trace.h"
 
 //---------------------------------------------------------------------
 //
@@ -48,17 +53,22 @@
 // rows occupy contiguous memory. Fills the allocated memory with
 // pixel value 'fill', which is typically set to either 0 (for
 // transparent black) or 0xffffffff (for opaque white). Parameter
-// 'fill' is optional; it defaults to 0. The function returns a
-// pointer to the buffer.
-COLOR* AllocateRawPixels(int w, int h, COLOR fill)
+// 'fill' is optional; it defaults to 0. The optional 'alloc'
+// parameter specifies the allocator for the buffer; if this parameter
+// is null, the buffer is allocated from the heap. The function returns
+// a pointer to the buffer.
+COLOR* AllocateRawPixels(int w, int h, COLOR fill, Allocator *alloc)
 {
     if (w < 1 || h < 1)
     {
         assert(w > 0 && h > 0);
         return 0;  // bad parameters
     }
+    if (alloc == 0)
+        alloc = GetHeapAllocator();
+
     int len = w*h;
-    COLOR *pixbuf = new COLOR[len];
+    COLOR *pixbuf = static_cast<COLOR*>(alloc->Allocate(len*sizeof(COLOR)));
     if (!pixbuf)
     {
         assert(pixbuf);
@@ -72,10 +82,11 @@ COLOR* AllocateRawPixels(int w, int h, COLOR fill)
 }
 
 // Deletes a buffer that was previously allocated by the
-// AllocateRawPixels function. Always returns zero.
-COLOR* DeleteRawPixels(COLOR *buf)
+// AllocateRawPixels function. The 'alloc' parameter must specify the
+// same allocator as in the AllocateRawPixels call. Always returns zero.
+COLOR* DeleteRawPixels(COLOR *buf, Allocator *alloc)
 {
-    if (buf) { delete[] buf; }
+    if (buf) { (alloc ? alloc : GetHeapAllocator())->Free(buf); }
     return 0;
 }
 
@@ -114,6 +125,72 @@ bool DefineSubregion(PIXEL_BUFFER& subbuf, const PIXEL_BUFFER& bigbuf, const SGR
     return valid;
 }
 
+//---------------------------------------------------------------------
+//
+// Utility functions used by renderers to do opaque solid fills
+//
+//---------------------------------------------------------------------
+namespace {
+    // Fills rects at least this large (in pixels) with non-temporal
+    // stores, which bypass the cache. A fill this large would evict
+    // most of the cache contents anyway.
+    const int STREAM_MINAREA = 1 << 18;
+
+    // Fills a row of 'len' pixels with the value 'color'. If 'bstream'
+    // is true, the pixels are written with non-temporal stores, and
+    // the caller is responsible for issuing a store fence afterward.
+    void FillRow(COLOR *dst, COLOR color, int len, bool bstream)
+    {
+#ifdef SG_USE_SSE2
+        // Advance to a 16-byte boundary, and then write 8 pixels at a time
+        while (len > 0 && (reinterpret_cast<size_t>(dst) & 15) != 0)
+        {
+            *dst++ = color;
+            --len;
+        }
+
+        __m128i val = _mm_set1_epi32(color);
+
+        if (bstream)
+        {
+            for (; len >= 8; len -= 8, dst += 8)
+            {
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst), val);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 4), val);
+            }
+        }
+        else
+        {
+            for (; len >= 8; len -= 8, dst += 8)
+            {
+                _mm_store_si128(reinterpret_cast<__m128i*>(dst), val);
+                _mm_store_si128(reinterpret_cast<__m128i*>(dst + 4), val);
+            }
+        }
+#endif
+        while (len-- > 0)
+            *dst++ = color;
+    }
+
+    // Fills a w-by-h rectangle of pixels with the value 'color'. The
+    // 'prow' parameter points to the top-left pixel in the rectangle,
+    // and 'stride' is the pixel buffer's stride in pixels.
+    void FillRect(COLOR *prow, int stride, int w, int h, COLOR color)
+    {
+        bool bstream = (w*h >= STREAM_MINAREA);
+
+        for (int j = 0; j < h; ++j)
+        {
+            FillRow(prow, color, w, bstream);
+            prow = &prow[stride];
+        }
+#ifdef SG_USE_SSE2
+        if (bstream)
+            _mm_sfence();  // make streamed pixels visible to other threads
+#endif
+    }
+}  // end namespace
+
 //---------------------------------------------------------------------
 //
 // BasicRenderer class: A platform-independent implementation of the
@@ -160,19 +237,15 @@ bool BasicRenderer::GetStatus()
 // Fills a series of horizontal spans that comprise a shape
 void BasicRenderer::RenderShape(ShapeFeeder *feeder)
 {
+    TRACE_SCOPE("BasicRenderer::RenderShape");
+
     SGRect rect;
 
     while (feeder->GetNextSDLRect(&rect))
     {
         COLOR *prow = &_backbuf.pixels[rect.y*_stride + rect.x];
-        for (int j = 0; j < rect.h; ++j)
-        {
-            COLOR *pixel = prow;
-            for (int i = 0; i < rect.w; ++i)
-                *pixel++ = _color;
 
-            prow = &prow[_stride];
-        }
+        FillRect(prow, _stride, rect.w, rect.h, _color);
     }
 }
 
@@ -346,6 +419,81 @@ namespace {
             }
         }
     }
+
+    // Table of coverage alphas for the 33 possible per-pixel coverage
+    // counts (0/32, 1/32, ... , 32/32) in the AA-buffer. While a drop
+    // shadow is being captured, this table replaces the _lut array.
+    struct COVERAGE_LUT
+    {
+        int val[33];
+
+        COVERAGE_LUT()
+        {
+            for (int i = 0; i < 33; ++i)
+                val[i] = (255*i + 16)/32;
+        }
+    } coverage;
+
+    // Gets the next batch of subpixel spans from a shape feeder. The
+    // overload for the edge manager's Feeder class is statically
+    // bound, so its span functions can be inlined into the caller.
+    inline int GetSpans(ShapeFeeder *feeder, SGSpan span[], int maxspans)
+    {
+        return feeder->GetNextSGSpans(span, maxspans);
+    }
+
+    inline int GetSpans(Feeder *feeder, SGSpan span[], int maxspans)
+    {
+        return feeder->Feeder::GetNextSGSpans(span, maxspans);
+    }
+
+    // Paint traits for the AA4x8Renderer::RenderSpans function
+    // template. The renderer selects the traits for its current paint
+    // type once per shape. Each FillSpan function here is statically
+    // bound to the FillSpan function of a concrete paint generator.
+    struct SolidPaint
+    {
+        static void FillSpan(PaintGen *paint, int xs, int ys, int len,
+                             COLOR outBuf[], const COLOR inAlpha[])
+        {
+        }
+    };
+
+    struct PatternPaint
+    {
+        static void FillSpan(PaintGen *paint, int xs, int ys, int len,
+                             COLOR outBuf[], const COLOR inAlpha[])
+        {
+            FillPatternSpan(paint, xs, ys, len, outBuf, inAlpha);
+        }
+    };
+
+    struct LinearPaint
+    {
+        static void FillSpan(PaintGen *paint, int xs, int ys, int len,
+                             COLOR outBuf[], const COLOR inAlpha[])
+        {
+            FillLinearSpan(paint, xs, ys, len, outBuf, inAlpha);
+        }
+    };
+
+    struct RadialPaint
+    {
+        static void FillSpan(PaintGen *paint, int xs, int ys, int len,
+                             COLOR outBuf[], const COLOR inAlpha[])
+        {
+            FillRadialSpan(paint, xs, ys, len, outBuf, inAlpha);
+        }
+    };
+
+    struct ConicPaint
+    {
+        static void FillSpan(PaintGen *paint, int xs, int ys, int len,
+                             COLOR outBuf[], const COLOR inAlpha[])
+        {
+            FillConicSpan(paint, xs, ys, len, outBuf, inAlpha);
+        }
+    };
 }  // end namespace
 
 //---------------------------------------------------------------------
@@ -362,11 +510,17 @@ namespace {
 //
 //---------------------------------------------------------------------
 
+// Number of subpixel spans that RenderShape requests per feeder call
+const int SPAN_BATCH_LEN = 64;
+
 class AA4x8Renderer : public EnhancedRenderer
 {
     friend ShapeGen;
+    friend class DraftRenderer;
+    friend void RenderShapeStatic(AA4x8Renderer *renderer, Feeder *feeder);
 
     PIXEL_BUFFER _pixbuf;  // pixel buffer descriptor
+    Allocator *_alloc; // supplies memory for internal buffers
     int _stride;       // stride in pixels = pitch/sizeof(COLOR)
     bool _pixalloc;    // true if we allocated the pixel memory
     COLOR *_linebuf;   // pixel data bits in scanline buffer
@@ -378,28 +532,39 @@ class AA4x8Renderer : public EnhancedRenderer
     int *_aarow[4];    // AA-buffer organized as 4 subpixel rows
     int _lut[33];      // look-up table for source alpha/RGB values
     PaintGen *_paintgen;  // paint generator (gradients, patterns)
+    PAINTTYPE _painttype; // concrete type of _paintgen
     COLOR_STOP _cstop[STOPARRAY_MAXLEN+1];  // color-stop array
     int _stopCount;    // Number of elements in color-stop array
     float _xform[6];   // Transform matrix (gradients, patterns)
     float *_pxform;    // Pointer to transform matrix
     int _xscroll, _yscroll;  // Scroll position coordinates
+    RENDMEMREPORT _memreport;  // memory used by internal buffers
+    unsigned char *_mask;  // drop-shadow coverage mask (8-bit alphas)
+    SGRect _maskbox;   // mask location and size in device coordinates
+    float _maskdev;    // standard deviation of blur
 
+    template <class TFeeder> void RenderFeeder(TFeeder *feeder);
+    template <class TFeeder, class TPaint> void RenderSpans(TFeeder *feeder);
     void FillSubpixelSpan(int xL, int xR, int ysub);
-    void RenderAbuffer(int xmin, int xmax, int yscan);
+    template <class TPaint> void RenderAbuffer(int xmin, int xmax, int yscan);
+    void MaskSpan(int x, int y, int len, const COLOR alpha[]);
     void BlendLUT(COLOR component);
     void BlendConstantAlphaLUT();
+    void CountMemory(MEMUSAGE *usage, size_t oldsize, size_t newsize);
+    void DeletePaintGen();
 
 protected:
     void RenderShape(ShapeFeeder *feeder);
     bool SetMaxWidth(int maxwidth);
     int QueryYResolution() { return 2; }
     bool SetScrollPosition(int x, int y);
+    AA4x8Renderer* QueryAA4x8Renderer() { return this; }
 
 public:
     bool GetStatus();  // for local use only
 
     // Enhanced renderer application interface
-    AA4x8Renderer(const PIXEL_BUFFER *pixbuf);
+    AA4x8Renderer(const PIXEL_BUFFER *pixbuf, Allocator *alloc);
     ~AA4x8Renderer();
     bool GetPixelBuffer(PIXEL_BUFFER *pixbuf);
     void SetColor(COLOR color);
@@ -407,6 +572,8 @@ public:
                     int w, int h, int stride, int flags);
     bool SetPattern(ImageReader *imgrdr, float u0, float v0,
                     int w, int h, int flags);
+    bool SetPattern(TileSource *tilesrc, float u0, float v0,
+                    int w, int h, int flags, int cachesize);
     bool SetLinearGradient(float x0, float y0, float x1, float y1,
                            SPREAD_METHOD spread, int flags);
     bool SetRadialGradient(float x0, float y0, float r0,
@@ -420,13 +587,19 @@ public:
     void SetTransform(const float xform[6]);
     void SetConstantAlpha(COLOR alpha);
     void SetBlendOperation(BLENDOP blendop);
+    void GetMemoryReport(RENDMEMREPORT *report) { *report = _memreport; }
+    bool BeginShadow(const SGRect& bbox, float stddev);
+    bool EndShadow(COLOR color, int dx, int dy);
 };
 
-AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf) :
+AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf, Allocator *alloc) :
+                    _alloc((alloc != 0) ? alloc : GetHeapAllocator()),
                     _maxwidth(0), _linebuf(0), _aabuf(0), _paintgen(0),
+                    _painttype(PAINT_SOLID),
                     _stopCount(0), _pxform(0), _color(0), _alpha(255),
                     _xscroll(0), _yscroll(0), _pixalloc(false),
-                    _blendop(BLENDOP_SRC_OVER_DST)
+                    _blendop(BLENDOP_SRC_OVER_DST), _mask(0),
+                    _maskdev(0)
 {
     if (pixbuf->width < 1 || pixbuf->height < 1 || pixbuf->depth != 32 ||
         (pixbuf->pitch/sizeof(COLOR) < pixbuf->width && pixbuf->pixels))
@@ -437,11 +610,13 @@ AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf) :
         _pixbuf.pixels = 0;
         return;  // bad parameter
     }
+    memset(&_memreport, 0, sizeof(_memreport));
     _pixbuf = *pixbuf;
     if (_pixbuf.pixels == 0)
     {
         // The caller wants us to allocate a pixel buffer
-        _pixbuf.pixels = AllocateRawPixels(_pixbuf.width, _pixbuf.height, RGBA(0,0,0,0));
+        _pixbuf.pixels = AllocateRawPixels(_pixbuf.width, _pixbuf.height,
+                                           RGBA(0,0,0,0), _alloc);
         if (_pixbuf.pixels == 0)
         {
             assert(_pixbuf.pixels != 0);
@@ -449,6 +624,7 @@ AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf) :
         }
         _pixalloc = true;  // don't forget we allocated pixel memory
         _pixbuf.pitch = _pixbuf.width*sizeof(COLOR);
+        CountMemory(&_memreport.pixels, 0, _pixbuf.width*_pixbuf.height*sizeof(COLOR));
     }
     _stride = _pixbuf.pitch/sizeof(COLOR);
     memset(&_lut[0], 0, sizeof(_lut));
@@ -460,12 +636,15 @@ AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf) :
 
 AA4x8Renderer::~AA4x8Renderer()
 {
-    delete[] _aabuf;
-    delete[] _linebuf;
+    if (_aabuf != 0)
+        _alloc->Free(_aabuf);
+    if (_linebuf != 0)
+        _alloc->Free(_linebuf);
+    if (_mask != 0)
+        _alloc->Free(_mask);
     if (_pixalloc)
-        DeleteRawPixels(_pixbuf.pixels);
-    if (_paintgen)
-        _paintgen->~PaintGen();
+        DeleteRawPixels(_pixbuf.pixels, _alloc);
+    delete _paintgen;
 }
 
 // Returns true if constructor succeeded; otherwise, returns false.
@@ -496,17 +675,21 @@ bool AA4x8Renderer::SetMaxWidth(int width)
     assert(width > 0);  // assumption: width is never zero
     if (_maxwidth != width)
     {
+        CountMemory(&_memreport.linebuf, _maxwidth*sizeof(COLOR), width*sizeof(COLOR));
+        CountMemory(&_memreport.aabuf, _maxwidth*sizeof(int), width*sizeof(int));
         _maxwidth = width;
 
         // Allocate buffer to store one scan line of BGRA pixels
-        delete[] _linebuf;
-        _linebuf = new COLOR[_maxwidth];
+        if (_linebuf != 0)
+            _alloc->Free(_linebuf);
+        _linebuf = static_cast<COLOR*>(_alloc->Allocate(_maxwidth*sizeof(COLOR)));
         assert(_linebuf);
         memset(_linebuf, 0, _maxwidth*sizeof(_linebuf[0]));
 
         // Allocate the new AA-buffer
-        delete[] _aabuf;
-        _aabuf = new int[_maxwidth];
+        if (_aabuf != 0)
+            _alloc->Free(_aabuf);
+        _aabuf = static_cast<int*>(_alloc->Allocate(_maxwidth*sizeof(int)));
         assert(_aabuf);
         memset(_aabuf, 0, _maxwidth*sizeof(_aabuf[0]));
         for (int i = 0; i < 4; ++i)
@@ -515,58 +698,128 @@ bool AA4x8Renderer::SetMaxWidth(int width)
     return true;
 }
 
+// Private function: Updates the memory report when one of the internal
+// buffers is resized (or is allocated, if oldsize is zero, or freed,
+// if newsize is zero). The total is updated too. When a buffer grows,
+// the new size is counted before the old size is discounted, because
+// the old buffer is freed only after the new buffer is allocated.
+void AA4x8Renderer::CountMemory(MEMUSAGE *usage, size_t oldsize, size_t newsize)
+{
+    usage->Add(newsize);
+    usage->Remove(oldsize);
+    _memreport.total.Add(newsize);
+    _memreport.total.Remove(oldsize);
+}
+
+// Private function: Deletes the current paint generator, if any, and
+// discounts the memory held by its pattern image
+void AA4x8Renderer::DeletePaintGen()
+{
+    if (_paintgen == 0)
+        return;
+
+    delete _paintgen;
+    _paintgen = 0;
+    _painttype = PAINT_SOLID;
+    CountMemory(&_memreport.paintgen, _memreport.paintgen.current, 0);
+}
+
 // Protected function: Called by ShapeGen to fill a series of
-// horizontal spans that comprise a shape
+// horizontal spans that comprise a shape. ShapeGen itself calls the
+// statically bound RenderShapeStatic function instead, so this virtual
+// function is used only with other implementations of ShapeFeeder.
 void AA4x8Renderer::RenderShape(ShapeFeeder *feeder)
+{
+    TRACE_SCOPE("AA4x8Renderer::RenderShape");
+    RenderFeeder(feeder);
+}
+
+// Private function template: Selects the version of the RenderSpans
+// function template that is statically bound to the current paint
+// generator, and calls it to render the shape supplied by 'feeder'
+template <class TFeeder>
+void AA4x8Renderer::RenderFeeder(TFeeder *feeder)
 {
     if (_pixbuf.pixels == 0)
     {
         assert(_pixbuf.pixels);
         return;  // not a valid pixel buffer
     }
+    switch (_painttype)
+    {
+    case PAINT_SOLID:
+        RenderSpans<TFeeder, SolidPaint>(feeder);
+        break;
+    case PAINT_PATTERN:
+        RenderSpans<TFeeder, PatternPaint>(feeder);
+        break;
+    case PAINT_LINEAR:
+        RenderSpans<TFeeder, LinearPaint>(feeder);
+        break;
+    case PAINT_RADIAL:
+        RenderSpans<TFeeder, RadialPaint>(feeder);
+        break;
+    case PAINT_CONIC:
+        RenderSpans<TFeeder, ConicPaint>(feeder);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
 
+// Private function template: Fills the horizontal spans supplied by
+// 'feeder'. Template parameter TPaint is the paint traits class for
+// the current paint generator.
+template <class TFeeder, class TPaint>
+void AA4x8Renderer::RenderSpans(TFeeder *feeder)
+{
     const int FIX_BIAS = 0x00007fff;
     const int YSCAN_INVALID = 0x80000000;
     int yscan = YSCAN_INVALID;
     int xmin = 0, xmax = 0;
-    SGSpan span;
+    SGSpan span[SPAN_BATCH_LEN];
+    int count;
 
-    // To reduce memory requirements, the ShapeFeeder::GetNextSGSpan
+    // To reduce memory requirements, the ShapeFeeder::GetNextSGSpans
     // function always supplies subpixel spans in y-ascending order.
     // Thus, the AA-buffer can construct each successive scanline in
     // its entirety before starting construction on the next scanline.
-    while (feeder->GetNextSGSpan(&span))
+    while ((count = GetSpans(feeder, span, SPAN_BATCH_LEN)) != 0)
     {
-        // Preserve 3 subpixel bits in the fixed-point x coordinates.
-        // Also, replace pixel offset bias with subpixel offset bias.
-        int xL = (span.xL + FIX_BIAS/8 - FIX_BIAS) >> 13;
-        int xR = (span.xR + FIX_BIAS/8 - FIX_BIAS) >> 13;
-        int ysub = span.y;
-
-        // Is this span so tiny that it falls into a gap between subpixels?
-        if (xL == xR)
-            continue;  // yes, nothing to do here
-
-        // Are we still in the same scan line as before?
-        if (yscan != ysub/4)
+        for (int i = 0; i < count; ++i)
         {
-            // No, use the AA-buffer to render the previous scan line
-            if (yscan != YSCAN_INVALID)
-                RenderAbuffer(xmin, xmax, yscan);
-
-            // Initialize xmin/xmax values for the new scan line
-            xmin = xL;
-            xmax = xR;
-            yscan = ysub/4;
+            // Preserve 3 subpixel bits in the fixed-point x coordinates.
+            // Also, replace pixel offset bias with subpixel offset bias.
+            int xL = (span[i].xL + FIX_BIAS/8 - FIX_BIAS) >> 13;
+            int xR = (span[i].xR + FIX_BIAS/8 - FIX_BIAS) >> 13;
+            int ysub = span[i].y;
+
+            // Is this span so tiny that it falls into a gap between subpixels?
+            if (xL == xR)
+                continue;  // yes, nothing to do here
+
+            // Are we still in the same scan line as before?
+            if (yscan != ysub/4)
+            {
+                // No, use the AA-buffer to render the previous scan line
+                if (yscan != YSCAN_INVALID)
+                    RenderAbuffer<TPaint>(xmin, xmax, yscan);
+
+                // Initialize xmin/xmax values for the new scan line
+                xmin = xL;
+                xmax = xR;
+                yscan = ysub/4;
+            }
+            FillSubpixelSpan(xL, xR, ysub);
+            xmin = min(xmin, xL);
+            xmax = max(xmax, xR);
         }
-        FillSubpixelSpan(xL, xR, ysub);
-        xmin = min(xmin, xL);
-        xmax = max(xmax, xR);
     }
 
     // Flush the AA-buffer to render the final scan line
     if (yscan != YSCAN_INVALID)
-        RenderAbuffer(xmin, xmax, yscan);
+        RenderAbuffer<TPaint>(xmin, xmax, yscan);
 }
 
 // Private function: Fills a subpixel span (horizontal string of bits)
@@ -600,13 +853,17 @@ void AA4x8Renderer::FillSubpixelSpan(int xL, int xR, int ysub)
         prow[iL] |= maskL & maskR;
 }
 
-// Private function: Uses the data in the AA-buffer to paint the
-// antialiased pixels in the scan line that was just completed
+// Private function template: Uses the data in the AA-buffer to paint
+// the antialiased pixels in the scan line that was just completed.
+// Template parameter TPaint is the paint traits class for the current
+// paint generator.
+template <class TPaint>
 void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
 {
     int iL = xmin >> 5;         // index of first 4-byte block
     int iR = (xmax + 31) >> 5;  // index just past last 4-byte block
     int x = 4*iL;
+    const int *lut = (_mask != 0) ? coverage.val : _lut;
 
     assert(iL < iR);
 
@@ -641,7 +898,7 @@ void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
         {
             int index = count & 63;
 
-            _linebuf[x] = _lut[index];
+            _linebuf[x] = lut[index];
             ++x;
             count >>= 8;
         }
@@ -652,8 +909,14 @@ void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
     int len = xright - xleft;
     COLOR *srcbuf = &_linebuf[xleft];
 
-    if (_paintgen)
-        _paintgen->FillSpan(xleft, yscan, len, srcbuf, srcbuf);
+    // While a drop shadow is being captured, the scan-line buffer
+    // contains coverage alphas, which go to the mask, not the display
+    if (_mask != 0)
+    {
+        MaskSpan(xleft, yscan, len, srcbuf);
+        return;
+    }
+    TPaint::FillSpan(_paintgen, xleft, yscan, len, srcbuf, srcbuf);
 
     // Blend the painted pixels into the back buffer
     COLOR *dest = &_pixbuf.pixels[yscan*_stride + xleft];
@@ -666,6 +929,153 @@ void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
         AlphaClear(dest, srcbuf, len);
 }
 
+// Private function: Merges a span of 'len' coverage alphas, starting
+// at device pixel (x,y), into the drop-shadow mask. If 'alpha' is null,
+// all pixels in the span are fully covered. Overlapping shapes are
+// combined with the 'over' operation, as if they were painted. Parts
+// of the span that lie outside the mask are ignored.
+void AA4x8Renderer::MaskSpan(int x, int y, int len, const COLOR alpha[])
+{
+    int row = y - _maskbox.y;
+
+    if (row < 0 || row >= _maskbox.h)
+        return;
+
+    int i0 = max(_maskbox.x - x, 0);
+    int i1 = min(_maskbox.x + _maskbox.w - x, len);
+    unsigned char *pmask = &_mask[row*_maskbox.w + x - _maskbox.x];
+
+    for (int i = i0; i < i1; ++i)
+    {
+        COLOR a = (alpha != 0) ? alpha[i] : 255;
+        COLOR m = pmask[i];
+
+        pmask[i] = m + a - (m*a + 127)/255;
+    }
+}
+
+// Public function: Starts capturing a drop shadow. Until the EndShadow
+// call, the renderer doesn't paint the shapes it's given to fill, but
+// merges their coverage into an 8-bit alpha mask. The mask covers the
+// bounding box 'bbox' (in integer user coordinates). Returns false if
+// a shadow is already being captured, if the parameters are invalid,
+// or if the mask can't be allocated.
+bool AA4x8Renderer::BeginShadow(const SGRect& bbox, float stddev)
+{
+    if (_mask != 0 || bbox.w < 1 || bbox.h < 1 || !(stddev >= 0))
+    {
+        assert(_mask == 0);  // shadows can't be nested
+        assert(bbox.w > 0 && bbox.h > 0 && stddev >= 0);
+        return false;  // fail - invalid parameters
+    }
+
+    int w = bbox.w, h = bbox.h;
+
+    _mask = static_cast<unsigned char*>(_alloc->Allocate(w*h));
+    if (_mask == 0)
+    {
+        assert(_mask != 0);
+        return false;  // fail - out of memory
+    }
+    memset(_mask, 0, w*h);
+    CountMemory(&_memreport.mask, 0, w*h);
+    _maskbox.x = bbox.x - _xscroll;
+    _maskbox.y = bbox.y - _yscroll;
+    _maskbox.w = w;
+    _maskbox.h = h;
+    _maskdev = stddev;
+    return true;
+}
+
+// Public function: Finishes the drop shadow that was started by the
+// BeginShadow call. Blurs the coverage mask, and then paints it into
+// the pixel buffer, offset by (dx,dy) pixels, with the specified
+// color (in RGBA format), and the current constant alpha and blend
+// operation. The mask is blurred by an AlphaBlur object (which treats
+// it as an 8-bit alpha image, and blurs it to an 8-bit alpha image)
+// with the default kernel width for the standard deviation, and only
+// the part of the blurred shadow that lands in the pixel buffer is
+// calculated. The scan-line buffer is
+// used for the painted pixels, so rows that are wider than the device
+// clipping rectangle are painted in sections. Frees the mask. Returns
+// false if no shadow was started, or if the blur runs out of memory,
+// in which case nothing is painted.
+bool AA4x8Renderer::EndShadow(COLOR color, int dx, int dy)
+{
+    TRACE_SCOPE("AA4x8Renderer::EndShadow");
+
+    if (_mask == 0)
+    {
+        assert(_mask != 0);
+        return false;  // fail - no shadow was started
+    }
+
+    // The region of interest is the pixel buffer, in the mask's
+    // coordinate space. The blurred bounding box is relative to the
+    // mask's top-left corner, which lands on device pixel (x0,y0).
+    int w = _maskbox.w, h = _maskbox.h;
+    int x0 = _maskbox.x + dx, y0 = _maskbox.y + dy;
+    int kwidth = static_cast<int>(3*_maskdev) | 1;
+    PIXEL_BUFFER maskbuf = { reinterpret_cast<COLOR*>(_mask), w, h, 8, w };
+    SGRect bbox = { 0, 0, w, h };
+    SGRect roi = { -x0, -y0, _pixbuf.width, _pixbuf.height };
+    SGRect blurbox;
+    PIXEL_BUFFER blurbuf;
+    AlphaBlur blur(&maskbuf, roi, kwidth, _maskdev, RGBA(0,0,0,255), _alloc);
+    bool status = blur.GetBlurredImage(&blurbuf) &&
+                  blur.GetBlurredBoundingBox(&blurbox, &bbox);
+
+    if (status && _linebuf != 0 && blurbuf.width > 0 && blurbuf.height > 0)
+    {
+        // Load a table with the premultiplied BGRA shadow color for
+        // each of the 256 possible mask alphas
+        COLOR opacity = _alpha*(color >> 24), tbl[256];
+
+        opacity += 128;
+        opacity += opacity >> 8;
+        opacity >>= 8;
+        color = (color & 0x0000ff00) | ((color >> 16) & 255) | ((color & 255) << 16);
+        color = PremultAlpha((opacity << 24) | color);
+        for (COLOR a = 0; a < 256; ++a)
+        {
+            COLOR rb = (color & 0x00ff00ff)*a + 0x00800080;
+            COLOR ga = ((color >> 8) & 0x00ff00ff)*a + 0x00800080;
+
+            rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+            ga = (ga + ((ga >> 8) & 0x00ff00ff)) & 0xff00ff00;
+            tbl[a] = ga | rb;
+        }
+
+        // The blurred image holds the 8-bit blurred mask alphas
+        assert(blurbuf.depth == 8);
+        for (int j = 0; j < blurbuf.height; ++j)
+        {
+            const unsigned char *pblur = reinterpret_cast<unsigned char*>(blurbuf.pixels) + j*blurbuf.pitch;
+            int y = y0 + blurbox.y + j;
+
+            for (int i = 0; i < blurbuf.width; i += _maxwidth)
+            {
+                int len = min(blurbuf.width - i, _maxwidth);
+                COLOR *dest = &_pixbuf.pixels[y*_stride + x0 + blurbox.x + i];
+
+                for (int k = 0; k < len; ++k)
+                    _linebuf[k] = tbl[pblur[i + k]];
+
+                if (_blendop == BLENDOP_SRC_OVER_DST)
+                    AlphaBlender(dest, _linebuf, len);
+                else if (_blendop == BLENDOP_ADD_WITH_SAT)
+                    AddWithSaturation(dest, _linebuf, len);
+                else
+                    AlphaClear(dest, _linebuf, len);
+            }
+        }
+    }
+    _alloc->Free(_mask);
+    _mask = 0;
+    CountMemory(&_memreport.mask, w*h, 0);
+    return status;
+}
+
 // Private function: Loads an RGB color component or alpha value into
 // the look-up table in the _lut array. The array is loaded with 33
 // elements corresponding to all possible per-pixel alpha values
@@ -707,11 +1117,7 @@ void AA4x8Renderer::SetColor(COLOR color)
     COLOR opacity = _alpha*(color >> 24);
 
     _color = color;
-    if (_paintgen)
-    {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
-    }
+    DeletePaintGen();
     opacity += 128;
     opacity += opacity >> 8;
     opacity >>= 8;
@@ -748,18 +1154,14 @@ bool AA4x8Renderer::SetScrollPosition(int x, int y)
 bool AA4x8Renderer::SetPattern(const COLOR *pattern, float u0, float v0,
                                int w, int h, int stride, int flags)
 {
-    if (_paintgen)
-    {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
-    }
+    DeletePaintGen();
     if (~flags & FLAG_IMAGE_BGRA32)
     {
         // This renderer requires BGRA (0xaarrggbb) pixel format
         flags |= FLAG_SWAP_REDBLUE;
     }
     TiledPattern *pat;
-    pat = CreateTiledPattern(pattern, u0, v0, w, h, stride, flags, _pxform);
+    pat = CreateTiledPattern(pattern, u0, v0, w, h, stride, flags, _pxform, _alloc);
     if (pat == 0)
     {
         assert(pat != 0);
@@ -767,7 +1169,10 @@ bool AA4x8Renderer::SetPattern(const COLOR *pattern, float u0, float v0,
         return false;  // out of memory
     }
     _paintgen = pat;
+    _painttype = PAINT_PATTERN;
     _paintgen->SetScrollPosition(_xscroll, _yscroll);
+    // Count the pattern's image pixels and row pointers (see pattern.cpp)
+    CountMemory(&_memreport.paintgen, 0, w*h*sizeof(COLOR) + h*sizeof(COLOR*));
     BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
     return true;
 }
@@ -777,18 +1182,44 @@ bool AA4x8Renderer::SetPattern(const COLOR *pattern, float u0, float v0,
 bool AA4x8Renderer::SetPattern(ImageReader *imgrdr, float u0, float v0,
                                int w, int h, int flags)
 {
-    if (_paintgen)
+    DeletePaintGen();
+    if (~flags & FLAG_IMAGE_BGRA32)
     {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
+        // This renderer requires BGRA (0xaarrggbb) pixel format
+        flags |= FLAG_SWAP_REDBLUE;
     }
+    TiledPattern *pat;
+    pat = CreateTiledPattern(imgrdr, u0, v0, w, h, flags, _pxform, _alloc);
+    if (pat == 0)
+    {
+        assert(pat != 0);
+        SetColor(RGBX(0,0,0));
+        return false;  // out of memory
+    }
+    _paintgen = pat;
+    _painttype = PAINT_PATTERN;
+    _paintgen->SetScrollPosition(_xscroll, _yscroll);
+    // Count the pattern's image pixels and row pointers (see pattern.cpp)
+    CountMemory(&_memreport.paintgen, 0, w*h*sizeof(COLOR) + h*sizeof(COLOR*));
+    BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
+    return true;
+}
+
+// Public function: Sets up the renderer to do tiled-pattern fills with
+// a large image that's read from a tile source. Only the tiles that are
+// actually painted are read, and at most 'cachesize' bytes of tiles are
+// kept in memory at a time.
+bool AA4x8Renderer::SetPattern(TileSource *tilesrc, float u0, float v0,
+                               int w, int h, int flags, int cachesize)
+{
+    DeletePaintGen();
     if (~flags & FLAG_IMAGE_BGRA32)
     {
         // This renderer requires BGRA (0xaarrggbb) pixel format
         flags |= FLAG_SWAP_REDBLUE;
     }
     TiledPattern *pat;
-    pat = CreateTiledPattern(imgrdr, u0, v0, w, h, flags, _pxform);
+    pat = CreateTiledPattern(tilesrc, u0, v0, w, h, flags, cachesize, _pxform, _alloc);
     if (pat == 0)
     {
         assert(pat != 0);
@@ -796,7 +1227,11 @@ bool AA4x8Renderer::SetPattern(ImageReader *imgrdr, float u0, float v0,
         return false;  // out of memory
     }
     _paintgen = pat;
+    _painttype = PAINT_PATTERN;
     _paintgen->SetScrollPosition(_xscroll, _yscroll);
+    // Count the tile cache, which is never larger than the whole image
+    // (see pattern.cpp)
+    CountMemory(&_memreport.paintgen, 0, min((size_t)cachesize, w*h*sizeof(COLOR)));
     BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
     return true;
 }
@@ -805,11 +1240,7 @@ bool AA4x8Renderer::SetPattern(ImageReader *imgrdr, float u0, float v0,
 bool AA4x8Renderer::SetLinearGradient(float x0, float y0, float x1, float y1,
                                       SPREAD_METHOD spread, int flags)
 {
-    if (_paintgen)
-    {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
-    }
+    DeletePaintGen();
     LinearGradient *grad;
     grad = CreateLinearGradient(x0, y0, x1, y1, spread, flags, _pxform);
     if (grad == 0)
@@ -822,6 +1253,7 @@ bool AA4x8Renderer::SetLinearGradient(float x0, float y0, float x1, float y1,
         grad->AddColorStop(_cstop[i].offset, _cstop[i].color);
 
     _paintgen = grad;
+    _painttype = PAINT_LINEAR;
     _paintgen->SetScrollPosition(_xscroll, _yscroll);
     BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
     return true;
@@ -832,11 +1264,7 @@ bool AA4x8Renderer::SetRadialGradient(float x0, float y0, float r0,
                                       float x1, float y1, float r1,
                                       SPREAD_METHOD spread, int flags)
 {
-    if (_paintgen)
-    {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
-    }
+    DeletePaintGen();
     RadialGradient *grad;
     grad = CreateRadialGradient(x0, y0, r0, x1, y1, r1, spread, flags, _pxform);
     if (grad == 0)
@@ -849,6 +1277,7 @@ bool AA4x8Renderer::SetRadialGradient(float x0, float y0, float r0,
         grad->AddColorStop(_cstop[i].offset, _cstop[i].color);
 
     _paintgen = grad;
+    _painttype = PAINT_RADIAL;
     _paintgen->SetScrollPosition(_xscroll, _yscroll);
     BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
     return true;
@@ -859,11 +1288,7 @@ bool AA4x8Renderer::SetConicGradient(float x0, float y0,
                                      float astart, float asweep,
                                      SPREAD_METHOD spread, int flags)
 {
-    if (_paintgen)
-    {
-        _paintgen->~PaintGen();
-        _paintgen = 0;
-    }
+    DeletePaintGen();
     ConicGradient *grad;
     grad = CreateConicGradient(x0, y0, astart, asweep, spread, flags, _pxform);
     if (grad == 0)
@@ -876,6 +1301,7 @@ bool AA4x8Renderer::SetConicGradient(float x0, float y0,
         grad->AddColorStop(_cstop[i].offset, _cstop[i].color);
 
     _paintgen = grad;
+    _painttype = PAINT_CONIC;
     _paintgen->SetScrollPosition(_xscroll, _yscroll);
     BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
     return true;
@@ -932,6 +1358,151 @@ void AA4x8Renderer::SetBlendOperation(BLENDOP blendop)
     }
 }
 
+//---------------------------------------------------------------------
+//
+// DraftRenderer class: A second implementation of the 'EnhancedRenderer'
+// virtual base class that trades edge quality for speed. It supports
+// all the same paints, constant alpha, and blend operations as the
+// AA4x8Renderer class, from which it inherits the code that sets up
+// these paints. But, like the BasicRenderer class, it does _NOT_ do
+// antialiasing. Instead, it requests whole-pixel rectangles from the
+// shape feeder, and paints each row of each rectangle directly into
+// the scan-line buffer, with no AA-buffer. Pixels are painted if
+// their centers lie inside the shape. This renderer is intended for
+// uses such as interactive panning and thumbnails.
+//
+//---------------------------------------------------------------------
+
+class DraftRenderer : public AA4x8Renderer
+{
+    void RenderRow(int x, int y, int len);
+
+protected:
+    void RenderShape(ShapeFeeder *feeder);
+    bool SetMaxWidth(int maxwidth);
+    int QueryYResolution() { return 0; }
+    AA4x8Renderer* QueryAA4x8Renderer() { return 0; }
+
+public:
+    DraftRenderer(const PIXEL_BUFFER *pixbuf, Allocator *alloc) :
+        AA4x8Renderer(pixbuf, alloc)
+    {
+    }
+    ~DraftRenderer() {}
+};
+
+// Protected function: ShapeGen calls this function to notify the
+// renderer when the width of the device clipping rectangle changes.
+// Unlike the AA4x8Renderer version of this function, this function
+// rebuilds only the scan-line buffer; no AA-buffer is needed.
+bool DraftRenderer::SetMaxWidth(int width)
+{
+    width = (width + 3) & ~3;
+    assert(width > 0);  // assumption: width is never zero
+    if (_maxwidth != width)
+    {
+        CountMemory(&_memreport.linebuf, _maxwidth*sizeof(COLOR), width*sizeof(COLOR));
+        _maxwidth = width;
+        if (_linebuf != 0)
+            _alloc->Free(_linebuf);
+        _linebuf = static_cast<COLOR*>(_alloc->Allocate(_maxwidth*sizeof(COLOR)));
+        assert(_linebuf);
+        memset(_linebuf, 0, _maxwidth*sizeof(_linebuf[0]));
+    }
+    return true;
+}
+
+// Protected function: Called by ShapeGen to fill a series of
+// rectangles (with integer coordinates) that comprise a shape
+void DraftRenderer::RenderShape(ShapeFeeder *feeder)
+{
+    TRACE_SCOPE("DraftRenderer::RenderShape");
+
+    if (_pixbuf.pixels == 0 || _linebuf == 0)
+    {
+        assert(_pixbuf.pixels && _linebuf);
+        return;  // not a valid pixel buffer
+    }
+
+    SGRect rect;
+    bool bopaque = (_paintgen == 0 && _blendop == BLENDOP_SRC_OVER_DST &&
+                    (_lut[32] >> 24) == 255);
+
+    if (_mask != 0)
+    {
+        // Capture the coverage for a drop shadow; don't paint
+        while (feeder->GetNextSDLRect(&rect))
+        {
+            for (int j = 0; j < rect.h; ++j)
+                MaskSpan(rect.x, rect.y + j, rect.w, 0);
+        }
+        return;
+    }
+    while (feeder->GetNextSDLRect(&rect))
+    {
+        if (bopaque)
+        {
+            // Opaque solid colors are simply copied to the back buffer
+            COLOR *prow = &_pixbuf.pixels[rect.y*_stride + rect.x];
+
+            FillRect(prow, _stride, rect.w, rect.h, _lut[32]);
+            continue;
+        }
+        for (int j = 0; j < rect.h; ++j)
+            RenderRow(rect.x, rect.y + j, rect.w);
+    }
+}
+
+// Private function: Paints a row of 'len' fully covered pixels,
+// starting at pixel (x,y), and blends them into the back buffer. The
+// _lut[32] entry contains either the premultiplied solid color or, if
+// a paint generator is used, the source constant alpha.
+void DraftRenderer::RenderRow(int x, int y, int len)
+{
+    COLOR *dest = &_pixbuf.pixels[y*_stride + x];
+    COLOR *srcbuf = &_linebuf[x];
+    COLOR src = _lut[32];
+
+    if (_paintgen == 0)
+    {
+        for (int i = 0; i < len; ++i)
+            srcbuf[i] = src;
+    }
+    else if (_alpha == 255)
+        _paintgen->FillSpan(x, y, len, srcbuf);  // opaque coverage
+    else
+    {
+        for (int i = 0; i < len; ++i)
+            srcbuf[i] = src;
+
+        _paintgen->FillSpan(x, y, len, srcbuf, srcbuf);
+    }
+
+    // Blend the painted pixels into the back buffer
+    if (_blendop == BLENDOP_SRC_OVER_DST)
+        AlphaBlender(dest, srcbuf, len);
+    else if (_blendop == BLENDOP_ADD_WITH_SAT)
+        AddWithSaturation(dest, srcbuf, len);
+    else
+        AlphaClear(dest, srcbuf, len);
+}
+
+//---------------------------------------------------------------------
+//
+// Statically bound entry point to the AA4x8Renderer object: ShapeGen
+// calls this function instead of the renderer's virtual RenderShape
+// function to fill the shape supplied by its own shape feeder (see
+// pipeline.h). The Feeder and AA4x8Renderer functions, and the paint
+// generator's FillSpan function, are all called directly.
+//
+//---------------------------------------------------------------------
+
+void RenderShapeStatic(AA4x8Renderer *renderer, Feeder *feeder)
+{
+    TRACE_SCOPE("AA4x8Renderer::RenderShape");
+    renderer->RenderFeeder(feeder);
+}
+
 //---------------------------------------------------------------------
 //
 // The following functions create a SimpleRenderer or EnhancedRender
@@ -940,6 +1511,10 @@ void AA4x8Renderer::SetBlendOperation(BLENDOP blendop)
 // (hint: you can use a smart pointer; see the SmartPtr class template
 // in shapegen.h). The 'pixbuf' parameter specifies the frame buffer,
 // back buffer, or layer buffer that is to be the rendering target.
+// The optional 'alloc' parameter specifies the allocator for the
+// enhanced renderer's internal buffers (see Allocator in shapegen.h).
+// The draft renderer is an enhanced renderer that doesn't do
+// antialiasing, for use where speed matters more than edge quality.
 //
 //---------------------------------------------------------------------
 
@@ -955,9 +1530,10 @@ SimpleRenderer* CreateSimpleRenderer(const PIXEL_BUFFER *pixbuf)
     return rend;  // success
 }
 
-EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf)
+EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf,
+                                         Allocator *alloc)
 {
-    AA4x8Renderer *aarend = new AA4x8Renderer(pixbuf);
+    AA4x8Renderer *aarend = new AA4x8Renderer(pixbuf, alloc);
     if (aarend == 0 || aarend->GetStatus() == false)
     {
         assert(aarend != 0 && aarend->GetStatus() == true);
@@ -967,3 +1543,57 @@ EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf)
     return aarend;
 }
 
+EnhancedRenderer* CreateDraftRenderer(const PIXEL_BUFFER *pixbuf,
+                                      Allocator *alloc)
+{
+    DraftRenderer *rend = new DraftRenderer(pixbuf, alloc);
+    if (rend == 0 || rend->GetStatus() == false)
+    {
+        assert(rend != 0 && rend->GetStatus() == true);
+        delete rend;
+        return 0;  // constructor failed
+    }
+    return rend;
+}
+
+//---------------------------------------------------------------------
+//
+// Draws a blurred drop shadow for the current path in ShapeGen object
+// 'sg', which must be set up to draw to the enhanced renderer 'rend'.
+// The path is filled, but only its coverage is captured, in a mask
+// that's sized to the path's bounding box, clipped to the device
+// clipping rectangle. (The path is clipped before it's filled, so
+// no coverage outside this rectangle reaches the mask; see the drop
+// shadow notes in renderer.h.) Parameters 'color', 'stddev', 'dx', and 'dy'
+// are the same as for the BeginShadow and EndShadow functions. The
+// path is not altered, so the caller can fill or stroke the shape
+// itself after drawing its shadow. Returns true if successful, or if
+// the path is empty or lies entirely outside the clipping rectangle.
+//
+//---------------------------------------------------------------------
+
+bool FillShadow(ShapeGen *sg, EnhancedRenderer *rend, COLOR color,
+                float stddev, int dx, int dy)
+{
+    if (sg == 0 || rend == 0)
+    {
+        assert(sg != 0 && rend != 0);
+        return false;  // fail - invalid parameters
+    }
+
+    // Get the bounding box in integer coordinates
+    SGRect bbox;
+    int fixbits = sg->SetFixedBits(0);
+    int count = sg->GetBoundingBox(&bbox, FLAG_BBOX_CLIP);
+
+    sg->SetFixedBits(fixbits);
+    if (count == 0)
+        return true;  // nothing to draw
+
+    if (rend->BeginShadow(bbox, stddev) == false)
+        return false;
+
+    bool status = sg->FillPath();
+
+    return rend->EndShadow(color, dx, dy) && status;
+}
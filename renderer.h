@@ -112,10 +112,19 @@ struct PIXEL_BUFFER
 };
 
 // Utilities for manipulating pixel buffers
-COLOR* AllocateRawPixels(int w, int h, COLOR fill = 0);
-COLOR* DeleteRawPixels(COLOR *buf);
+COLOR* AllocateRawPixels(int w, int h, COLOR fill = 0, Allocator *alloc = 0);
+COLOR* DeleteRawPixels(COLOR *buf, Allocator *alloc = 0);
 bool DefineSubregion(PIXEL_BUFFER& subbuf, const PIXEL_BUFFER& buf, const SGRect& bbox);
 
+// Pixel-format conversions for 32-bit pixels (see pixconv.cpp). Each
+// function converts 'len' pixels from 'src' and writes them to 'dst',
+// which can be the same array as 'src'.
+void SwapRedBlue(COLOR *dst, const COLOR *src, int len);
+void PremultiplyAlpha(COLOR *dst, const COLOR *src, int len);
+void SwapRedBluePremultiplyAlpha(COLOR *dst, const COLOR *src, int len);
+void UnpremultiplyAlpha(COLOR *dst, const COLOR *src, int len);
+void ConvertPixels(COLOR *dst, const COLOR *src, int len, int flags);
+
 //---------------------------------------------------------------------
 //
 // Class ImageReader: Reads 32-bit pixel data from a .bmp file or
@@ -138,6 +147,39 @@ public:
     virtual bool RewindData() = 0;
 };
 
+//---------------------------------------------------------------------
+//
+// Class TileSource: Supplies 32-bit pixel data from a large image one
+// tile at a time, in any order. A TiledPattern object that's created
+// from a TileSource reads only the tiles that its FillSpan function
+// actually samples, and keeps the most recently used tiles in a cache
+// with a fixed byte budget. The tiles are squares whose width and
+// height, as returned by GetTileSize, must be a power of two. The
+// ReadTile function copies the pixels in the tile at column 'tx' and
+// row 'ty' to the 'buffer' array, in which the pitch is the tile
+// width. Tiles on the right and bottom edges of the image can be only
+// partially filled. Tile rows are numbered in the same order as the
+// pixel rows in the image source, so a bottom-up image is specified by
+// the FLAG_IMAGE_BOTTOMUP flag, as for an ImageReader. ReadTile returns
+// false if it can't supply the pixels.
+//
+//---------------------------------------------------------------------
+
+class TileSource
+{
+public:
+    virtual ~TileSource() {}
+    virtual int GetTileSize() = 0;
+    virtual bool ReadTile(int tx, int ty, COLOR *buffer) = 0;
+};
+
+// Creates a TileSource for a 2-D image array in memory -- for example,
+// a memory-mapped file of raw 32-bit pixels. The 'stride' parameter is
+// the pitch of the image array in pixels. Pixels are copied from the
+// array only when the tiles that contain them are read.
+TileSource* CreateRawTileSource(const COLOR *pixels, int w, int h,
+                                int stride, int tilesize = 64);
+
 //---------------------------------------------------------------------
 //
 // A simple renderer: Fills a shape with a solid color, but does _NOT_
@@ -162,6 +204,16 @@ SimpleRenderer* CreateSimpleRenderer(const PIXEL_BUFFER *pixbuf);
 //
 //---------------------------------------------------------------------
 
+// Memory used by an enhanced renderer's internal buffers
+struct RENDMEMREPORT {
+    MEMUSAGE linebuf;   // scan-line pixel buffer
+    MEMUSAGE aabuf;     // AA-buffer
+    MEMUSAGE paintgen;  // pattern image held by paint generator
+    MEMUSAGE mask;      // coverage mask for a drop shadow
+    MEMUSAGE pixels;    // pixel buffer (if allocated by renderer)
+    MEMUSAGE total;     // all of the above
+};
+
 class EnhancedRenderer : public SimpleRenderer
 {
 public:
@@ -182,14 +234,107 @@ public:
                             int w, int h, int stride, int flags) = 0;
     virtual bool SetPattern(ImageReader *imgrdr, float u0, float v0,
                             int w, int h, int flags) = 0;
+    virtual bool SetPattern(TileSource *tilesrc, float u0, float v0,
+                            int w, int h, int flags, int cachesize) = 0;
     virtual void AddColorStop(float offset, COLOR color) = 0;
     virtual void ResetColorStops() = 0;
     virtual void SetTransform(const float xform[6] = 0) = 0;
     virtual void SetConstantAlpha(COLOR alpha = 255) = 0;
     virtual void SetBlendOperation(BLENDOP blendop = BLENDOP_SRC_OVER_DST) = 0;
+    virtual void GetMemoryReport(RENDMEMREPORT *report) = 0;
+    virtual bool BeginShadow(const SGRect& bbox, float stddev) = 0;
+    virtual bool EndShadow(COLOR color, int dx = 0, int dy = 0) = 0;
 };
 
-EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf);
+EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf,
+                                         Allocator *alloc = 0);
+
+// Drop shadows: After a BeginShadow call, the shapes that the renderer
+// is given to fill are not painted. Instead, their pixel coverage is
+// captured in an 8-bit alpha mask that covers the bounding box 'bbox',
+// which is in integer user coordinates. The EndShadow call blurs the
+// mask with AlphaBlur (see below), using a Gaussian filter whose
+// standard deviation is 'stddev' pixels, and then paints the mask
+// with the specified color (in RGBA format) and the current constant
+// alpha and blend operation, offset by (dx,dy) pixels. The blur
+// expands the shadow by floor(3*stddev/2) pixels on each side of the
+// bounding box. Coverage that falls outside the bounding box is
+// discarded. The painted shadow is clipped to the pixel buffer, but
+// not to the device clipping rectangle or to the current clipping
+// region. The FillShadow function does all these steps for the
+// current path in ShapeGen object 'sg', which must draw to the
+// renderer 'rend'. Limitation: Shapes are clipped before their
+// coverage reaches the mask, so the parts of a shape that lie outside
+// the device clipping rectangle or the clipping region cast no
+// shadow. For a shape that extends past the edge of the window, the
+// shadow fades out along the edge, and an offset shadow loses the
+// part cast by the hidden part of the shape. To shadow such a shape,
+// render it into a layer, blur the layer with AlphaBlur, and paint the
+// blurred image as a pattern, as in the DropShadow example in demo.cpp.
+bool FillShadow(ShapeGen *sg, EnhancedRenderer *rend, COLOR color,
+                float stddev, int dx = 0, int dy = 0);
+
+// A draft renderer supports all the paints and blend operations of an
+// enhanced renderer, but does _NOT_ do antialiasing. It's faster than
+// an enhanced renderer, and is useful for quick previews.
+EnhancedRenderer* CreateDraftRenderer(const PIXEL_BUFFER *pixbuf,
+                                      Allocator *alloc = 0);
+
+//-----------------------------------------------------------------------
+//
+// An AlphaBlur object uses a Gaussian filter to blur images, and is
+// typically used to draw drop shadows. The AlphaBlur class is
+// implemented in alfablur.cpp, and is used by the EndShadow function.
+//
+//-----------------------------------------------------------------------
+
+class AlphaBlur : public ImageReader
+{
+    int _kwidth;            // width of Gaussian kernel (always odd)
+    float _stddev;          // standard deviation
+    COLOR *_kcoeff;         // kernel coefficients
+    float _qthresh;         // quality threshold for reduced resolution
+    int _factor;            // resolution reduction factor (1, 2, or 4)
+    COLOR _rgba, _rgb, _alpha;  // fill color components
+    PIXEL_BUFFER _blurbuf;  // buffer containing blurred image
+    SGRect _roi;            // part of full blurred image in _blurbuf
+    int _fullwidth;         // width of full blurred image
+    int _fullheight;        // height of full blurred image
+    int _numpixels;         // number of pixels in blurred image
+    int _index;             // current index into blurred image
+    Allocator *_alloc;      // supplies memory for internal buffers
+
+    static const int BLUR_MAXFACTOR = 4;  // maximum reduction factor
+
+    void ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len);
+    void ApplyFilter(COLOR dst[], const COLOR src[], int len,
+                     const COLOR kcoeff[], int rad);
+    COLOR* CreateKernelCoeffs(int rad, float stddev);
+    bool CreateFilterKernel(int kwidth, float stddev);
+    bool BlurImage(const PIXEL_BUFFER *srcimage, const SGRect *roi);
+    bool BlurReduced(const PIXEL_BUFFER *srcimage);
+    void ColorizeRow(COLOR dst[], const COLOR ablur[], int len);
+    void WriteRow(int j, const COLOR ablur[]);
+    void Init(const PIXEL_BUFFER *srcimage, const SGRect *roi,
+              int kwidth, float stddev, COLOR color);
+
+public:
+    AlphaBlur(const PIXEL_BUFFER *srcimage, int kwidth = 0,
+              float stddev = 0, COLOR color = RGBA(0,0,0,127),
+              Allocator *alloc = 0, float qthresh = 4.0f);
+    AlphaBlur(const PIXEL_BUFFER *srcimage, const SGRect& roi,
+              int kwidth = 0, float stddev = 0,
+              COLOR color = RGBA(0,0,0,127), Allocator *alloc = 0,
+              float qthresh = 4.0f);
+    ~AlphaBlur();
+    bool GetBlurParams(int *kwidth, float *stddev, COLOR *color);
+    bool GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox);
+    bool GetBlurredImage(PIXEL_BUFFER *blurbuf);
+
+    // Implement ImageReader interface
+    int ReadPixels(COLOR *buffer, int count);
+    bool RewindData();
+};
 
 //-----------------------------------------------------------------------
 //
@@ -227,6 +372,8 @@ public:
                  int stride, int flags, const float xform[6]);
     TiledPattern(ImageReader *imgrdr, float u0, float v0, int w, int h,
                  int flags, const float xform[6]);
+    TiledPattern(TileSource *tilesrc, float u0, float v0, int w, int h,
+                 int flags, int cachesize, const float xform[6]);
     virtual ~TiledPattern() {}
     virtual void FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAlpha[]) = 0;
     virtual bool SetScrollPosition(int x, int y) = 0;
@@ -234,11 +381,16 @@ public:
 
 TiledPattern* CreateTiledPattern(const COLOR *pattern, float u0, float v0,
                                  int w, int h, int stride, int flags,
-                                 const float xform[6] = 0);
+                                 const float xform[6] = 0, Allocator *alloc = 0);
 
 TiledPattern* CreateTiledPattern(ImageReader *imgrdr, float u0, float v0,
                                  int w, int h, int flags,
-                                 const float xform[6] = 0);
+                                 const float xform[6] = 0, Allocator *alloc = 0);
+
+// The 'cachesize' parameter is the byte budget for cached tiles
+TiledPattern* CreateTiledPattern(TileSource *tilesrc, float u0, float v0,
+                                 int w, int h, int flags, int cachesize,
+                                 const float xform[6] = 0, Allocator *alloc = 0);
 
 // Paint generator for linear gradient fills
 //
@@ -29,6 +29,9 @@
 #ifndef SHAPEGEN_H
   #define SHAPEGEN_H
 
+#include <stddef.h>
+#include <new>
+
 //---------------------------------------------------------------------
 //
 // Define types and constants
@@ -38,6 +41,48 @@
 typedef int FIX16;  // 16.16 fixed-point value
 typedef int SGCoord;  // ShapeGen coordinate value
 
+//---------------------------------------------------------------------
+//
+// Fixed-point-only build option: If the code is compiled with the
+// symbol SGFIXEDPOINT defined (for example, g++ -DSGFIXEDPOINT), the
+// per-edge code (polygonal edge setup, stroked line lengths and join
+// geometry) and the per-pixel paint code (gradient and tiled-pattern
+// span fills) use integer arithmetic in place of floating point. This
+// option is intended for processors that lack hardware floating-point
+// support. Floating-point arithmetic is still used to set up paths,
+// curves, and paint generators, but not in their inner loops. Images
+// rendered in the fixed-point build can differ from the default build
+// by a small amount in the color components of some pixels.
+//
+//---------------------------------------------------------------------
+
+#ifdef SGFIXEDPOINT
+
+// Returns the integer square root (rounded down) of a 64-bit value
+inline unsigned FixedSqrt(unsigned long long x)
+{
+    unsigned long long root = 0, bit = 1ULL << 62;
+
+    while (bit > x)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+
+        bit >>= 2;
+    }
+    return (unsigned)root;
+}
+
+#endif  // SGFIXEDPOINT
+
 struct SGPoint {
     SGCoord x;
     SGCoord y;
@@ -123,7 +168,13 @@ const int FLAG_BBOX_ACCUM = 4;   // accumulate multi-path bbox
 // in Windows GDI's RECT format (in spite of the somewhat misleading
 // type cast to SGRect*). The GetNextSGSpan function supports
 // antialiasing by dispensing a subpixel span that adds a horizontal
-// row of bits to the coverage bitmaps for a row of pixels.
+// row of bits to the coverage bitmaps for a row of pixels. The
+// GetNextSGSpans function dispenses up to 'maxspans' subpixel spans
+// per call, so that a renderer pays for one virtual function call per
+// batch of spans instead of one per span. It returns the number of
+// spans written to the 'span' array, or zero if the shape is used up.
+// A shape feeder can override the version below to inline its
+// GetNextSGSpan function into the batch loop.
 //
 //---------------------------------------------------------------------
 
@@ -133,6 +184,15 @@ public:
     virtual bool GetNextSDLRect(SGRect *rect) = 0;
     virtual bool GetNextGDIRect(SGRect *rect) = 0;
     virtual bool GetNextSGSpan(SGSpan *span) = 0;
+    virtual int GetNextSGSpans(SGSpan span[], int maxspans)
+    {
+        int count = 0;
+
+        while (count < maxspans && GetNextSGSpan(&span[count]))
+            ++count;
+
+        return count;
+    }
 };
 
 //---------------------------------------------------------------------
@@ -144,17 +204,110 @@ public:
 // rudimentary versions defined here. To enable pattern alignment, an
 // enhanced renderer implements its own version of the
 // SetScrollPosition function, but a renderer that does only solid-
-// color fills can inherit the version below.
+// color fills can inherit the version below. The library's own
+// antialiasing renderer implements the QueryAA4x8Renderer function,
+// which lets the ShapeGen object feed shapes to this renderer through
+// statically bound calls; all other renderers inherit the version
+// below, which returns null.
 //
 //---------------------------------------------------------------------
 
+class AA4x8Renderer;  // for internal use only
+
 class Renderer
 {
 public:
+    virtual ~Renderer() {}
     virtual void RenderShape(ShapeFeeder *feeder) = 0;
     virtual int QueryYResolution() { return 0; }
     virtual bool SetMaxWidth(int width) { return true; }
     virtual bool SetScrollPosition(int x, int y) { return true; }
+    virtual AA4x8Renderer* QueryAA4x8Renderer() { return 0; }
+};
+
+//---------------------------------------------------------------------
+//
+// Cancellation callback: Enables an application to interrupt a
+// lengthy fill or stroke operation. While the ShapeGen object
+// partitions a shape into trapezoids, it periodically calls the
+// QueryCancel function. If this function returns true, the ShapeGen
+// object discards the shape before any part of it is drawn, and the
+// FillPath or StrokePath call returns false. After QueryCancel
+// returns true, it should continue to return true until the
+// application resets the condition that caused the cancellation.
+//
+//---------------------------------------------------------------------
+
+class CancelCallback
+{
+public:
+    virtual bool QueryCancel() = 0;
+};
+
+//---------------------------------------------------------------------
+//
+// Allocator: Supplies the memory for the variable-size internal
+// buffers of a ShapeGen object or renderer -- for example, the path
+// stack, the pools of polygonal edges, the renderer's scan-line
+// buffers, and the pixel data for pattern fills. An application can
+// derive its own allocator from this class (for instance, to draw
+// from a per-job arena, or to measure the memory used by a render),
+// and pass it to CreateShapeGen or CreateEnhancedRenderer. The
+// allocator must outlive the objects that use it. The default
+// implementation of this class allocates from the C++ heap. The
+// Allocate function must return memory that is suitably aligned for
+// any data type, or a null pointer if the allocation fails.
+//
+//---------------------------------------------------------------------
+
+class Allocator
+{
+public:
+    virtual ~Allocator() {}
+    virtual void* Allocate(size_t size) { return new (std::nothrow) char[size]; }
+    virtual void Free(void *ptr) { delete[] static_cast<char*>(ptr); }
+};
+
+// Returns the allocator that is used if none is specified
+inline Allocator* GetHeapAllocator()
+{
+    static Allocator heap;
+    return &heap;
+}
+
+//---------------------------------------------------------------------
+//
+// Memory accounting: A MEMUSAGE structure reports the current size and
+// the high-water mark, in bytes, of an internal buffer or set of
+// buffers. A ShapeGen object fills in an SGMEMREPORT structure to
+// describe its edge pools and path stack. The edge pools trade roles
+// as a shape is processed, so each pool in the report is whichever
+// pool currently has that role, and its peak is the peak of that pool
+// while serving in any role.
+//
+//---------------------------------------------------------------------
+
+struct MEMUSAGE {
+    size_t current;  // bytes currently allocated
+    size_t peak;     // most bytes allocated at any one time
+
+    void Add(size_t nbytes)
+    {
+        current += nbytes;
+        if (peak < current)
+            peak = current;
+    }
+    void Remove(size_t nbytes) { current -= nbytes; }
+};
+
+struct SGMEMREPORT {
+    MEMUSAGE inpool;    // edges of shape being normalized or clipped
+    MEMUSAGE outpool;   // edges output by normalization or clipping
+    MEMUSAGE clippool;  // edges of current clipping region
+    MEMUSAGE rendpool;  // edges of shape most recently rendered
+    MEMUSAGE savepool;  // edges of saved clipping region
+    MEMUSAGE path;      // path stack
+    MEMUSAGE total;     // sums of the current and peak values above
 };
 
 //---------------------------------------------------------------------
@@ -178,6 +331,9 @@ public:
     // Renderer object
     virtual bool SetRenderer(Renderer *renderer) = 0;
 
+    // Cancellation of lengthy fill and stroke operations
+    virtual CancelCallback* SetCancelCallback(CancelCallback *cancel = 0) = 0;
+
     // Basic path construction
     virtual void BeginPath() = 0;
     virtual void CloseFigure() = 0;
@@ -228,6 +384,10 @@ public:
     virtual bool PolyBezier2(const SGPoint xy[], int npts) = 0;
     virtual bool Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3) = 0;
     virtual bool PolyBezier3(const SGPoint xy[], int npts) = 0;
+
+    // Memory accounting
+    virtual void GetMemoryReport(SGMEMREPORT *report) = 0;
+    virtual size_t TrimMemory(size_t threshold = 0) = 0;
 };
 
 //---------------------------------------------------------------------
@@ -252,10 +412,12 @@ public:
 // Creates a ShapeGen object and returns a pointer to this object.
 // The caller is responsible for deleting this object when it is no
 // longer needed (suggestion: use a smart pointer like the one just
-// above).
+// above). The optional 'alloc' parameter specifies the allocator for
+// the ShapeGen object's internal buffers (see Allocator class).
 //
 //---------------------------------------------------------------------
 
-ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect);
+ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect,
+                         Allocator *alloc = 0);
 
 #endif  // SHAPEGEN_H
@@ -57,10 +57,20 @@
 struct VERT16 {
     FIX16 x, y;
 };
+#ifdef SGFIXEDPOINT
+struct XY {  // unit vector in 16.16 fixed-point format
+    FIX16 x;
+    FIX16 y;
+};
+#else
 struct XY {
     float x;
     float y;
 };
+#endif
+struct VERTD {  // unclipped 16.16 coordinates in double precision
+    double x, y;
+};
 
 const int BIGVAL16 = 0x7FFF;  // biggest 16-bit signed integer value
 
@@ -74,6 +84,12 @@ const FIX16 FIX_BIAS = 0x7FFF;  // (1/2-1/65536) in fixed-point format
 const int KMAX = 6;        // max k for ellipse angular increment 1/2^k
 const int MAXLEVELS = 12;  // max number bezier subdivision levels
 
+// Constants used for coarse clipping of path coordinates
+const int GUARDBAND = 8192;     // guard band width (pixels) around device
+const int MAXCLIPLEVELS = 24;   // max levels to subdivide clipped curve
+const double MAXVAL16 = 65536.0*BIGVAL16;  // limit of 16.16 path coords
+const double CLIPVAL16 = 65536.0*(BIGVAL16 - GUARDBAND);  // clip box limit
+
 // Structure used to describe a figure (aka subpath or contour)
 struct FIGURE {
     bool isclosed;  // true if figure is closed
@@ -114,6 +130,9 @@ const int INITIAL_POOL_LENGTH = 2000;
 // Fixed length of POOL inventory of fully allocated blocks
 const int POOL_INVENTORY_LENGTH = 20;
 
+// Max number of edges that AttachEdges reserves in a single batch
+const int EDGE_BATCH_LEN = 256;
+
 //---------------------------------------------------------------------
 //
 // Storage pool of EDGE structures that we assume are allocated one at
@@ -123,6 +142,7 @@ const int POOL_INVENTORY_LENGTH = 20;
 
 class POOL
 {
+    Allocator *alloc;  // supplies memory for blocks
     EDGE *block;    // block currently in use for EDGE allocations
     int blklen;     // number of EDGE structures in block array
     int watermark;  // allocation watermark in current block
@@ -131,18 +151,26 @@ class POOL
     EDGE *inventory[POOL_INVENTORY_LENGTH];
     int count;  // number of EDGE structures in inventory array
     int index;  // index of next free slot in inventory array
+    MEMUSAGE usage;  // bytes of memory held by pool
 
     void AcquireBlock();  // add new block of memory to pool
 
 public:
-    POOL(int len = INITIAL_POOL_LENGTH);
+    POOL(Allocator *allocator, int len = INITIAL_POOL_LENGTH);
     ~POOL();
     void Reset();
     EDGE* Allocate(EDGE *p = 0);
+    EDGE* Reserve(int len);
+    void Commit(int len);
     int GetCount()
     {
         return (count + watermark);
     }
+    const MEMUSAGE& GetUsage() { return usage; }
+    void CopyPeak(POOL *pool)
+    {
+        usage.peak = max(usage.peak, pool->usage.peak);
+    }
 };
 
 //---------------------------------------------------------------------
@@ -161,25 +189,42 @@ class EdgeMgr
 
     EDGELIST _inlist, _outlist, _cliplist, _rendlist, _savelist;
     POOL *_inpool, *_outpool, *_clippool, *_rendpool, *_savepool;
+    Allocator *_alloc;  // supplies memory for edge pools and sorting
     Renderer *_renderer;
+    AA4x8Renderer *_aarend;  // same as _renderer if it's AA4x8Renderer
     int _yshift, _ybias, _yhalf;
+    VERT16 _gmin, _gmax;  // guard band limits in 16.16 path coordinates
 
     void SaveEdgePair(int height, EDGE *edgeL, EDGE *edgeR);
+    bool SetupEdge(EDGE *p, const VERT16 *v1, const VERT16 *v2,
+                   const VERT16 **vtop, const VERT16 **vbot);
+    bool MakeEdge(EDGE *p, const VERT16 *v1, const VERT16 *v2);
+    void ClipEdge(const VERT16 *v1, const VERT16 *v2);
+    bool IsInsideGuardBand(const VERT16 *v)
+    {
+        return (_gmin.x <= v->x && v->x <= _gmax.x &&
+                _gmin.y <= v->y && v->y <= _gmax.y);
+    }
+    size_t CompactPool(POOL **pool, EDGELIST *list, size_t threshold);
 
 protected:
-    EdgeMgr();
+    EdgeMgr(Allocator *alloc);
     ~EdgeMgr();
     bool SetRenderer(Renderer *renderer);
     bool SetClipList();
     void ReverseEdges();
     void ClipEdges(FILLRULE fillrule);
     bool FillEdgeList();
-    void NormalizeEdges(FILLRULE fillrule);
+    bool NormalizeEdges(FILLRULE fillrule, CancelCallback *cancel = 0);
     void AttachEdge(const VERT16 *v1, const VERT16 *v2);
+    void AttachEdges(const VERT16 *verts, int n, bool closed);
     void TranslateEdges(int x, int y);
+    void SetGuardBand(const VERT16& gmin, const VERT16& gmax);
     void SetDeviceClipRectangle(int width, int height, bool bsave);
     bool SaveClipRegion();
     bool SwapClipRegion();
+    void GetPoolUsage(SGMEMREPORT *report);
+    size_t TrimPools(size_t threshold);
 };
 
 //---------------------------------------------------------------------
@@ -193,10 +238,12 @@ protected:
 
 class PathMgr : virtual public ShapeGen
 {
-    friend ShapeGen* CreateShapeGen(Renderer*, const SGRect&);
+    friend ShapeGen* CreateShapeGen(Renderer*, const SGRect&, Allocator*);
 
     Renderer *_renderer; // renders filled and stroked shapes
     EdgeMgr *_edge;      // manages lists of polygonal edges
+    Allocator *_alloc;   // supplies memory for path and edge buffers
+    CancelCallback *_cancel;  // interrupts lengthy fills and strokes
     SGRect _devicecliprect;  // clipping rectangle for display device
     FIX16 _flatness;     // error tolerance for flattened arcs/curves
     int _fixshift;       // to convert user coords to 16.16 fixed-point
@@ -207,7 +254,9 @@ class PathMgr : virtual public ShapeGen
     VERT16 *_path;    // pointer to dynamically allocated path array
 
     // Path memory management functions
-    void GrowPath();
+    MEMUSAGE _pathusage;  // bytes of memory held by path stack
+    void ResizePath(int length);
+    void GrowPath() { ResizePath(2*_pathlength); }
     void PathCheck(VERT16 *ptr)
     {
         if (ptr == &_path[_pathlength])  // detect path overflow
@@ -220,6 +269,19 @@ class PathMgr : virtual public ShapeGen
     FIGURE *_figure;    // pointer to current figure in path
     FIGURE *_figtmp;    // temporary figure pointer
 
+    // Coarse clipping of points outside the 16.16 coordinate range
+    VERTD _upoint;      // current point before clipping to 16.16 range
+    VERTD _ufirst;      // first point in figure before clipping
+    VERTD _umin, _umax; // extents of points clipped to 16.16 range
+    void ClipLine(const VERTD& v);
+    void ClipPoint(VERT16 *p, const VERTD& v);
+    bool IsInsideRange(const VERTD& v)
+    {
+        return (-MAXVAL16 < v.x && v.x < MAXVAL16 &&
+                -MAXVAL16 < v.y && v.y < MAXVAL16);
+    }
+    void SetGuardBand();
+
     // Dashed line pattern parameters
     FIX16 _dasharray[DASHARRAY_MAXLEN+1];  // dash pattern storage
     FIX16 _dashoffset;  // starting offset into dashed-line pattern
@@ -233,14 +295,19 @@ class PathMgr : virtual public ShapeGen
     LINEEND _lineend;   // line end cap style
     LINEJOIN _linejoin; // line join style
     float _miterlimit;  // miter limit
+#ifdef SGFIXEDPOINT
+    FIX16 _mitercheck;  // precomputed parameter for miter-limit check
+    FIX16 _miterfix;    // miter limit in 16.16 fixed-point format
+#else
     float _mitercheck;  // precomputed parameter for miter-limit check
+#endif
     FIX16 _angle;       // angle between line segments at round join
     FIX16 _joinhint;    // hint for approximating round/miter join
 
     void FinalizeFigure(bool bclose);  // closes or ends a figure
 
 protected:
-    PathMgr(Renderer *renderer, const SGRect& cliprect);
+    PathMgr(Renderer *renderer, const SGRect& cliprect, Allocator *alloc);
     ~PathMgr();
 
 public:
@@ -249,6 +316,9 @@ public:
     // Selects the renderer to use for filling and stroking shapes
     bool SetRenderer(Renderer *renderer);
 
+    // Cancellation of lengthy fill and stroke operations
+    CancelCallback* SetCancelCallback(CancelCallback *cancel);
+
     // Basic path construction
     void BeginPath();
     void CloseFigure();
@@ -317,6 +387,8 @@ private:
     void EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
                      FIX16 xQ, FIX16 yQ, FIX16 sweep);
     int AngularInc(FIX16 xP, FIX16 yP, FIX16 xQ, FIX16 yQ);
+    void ClipArc(const VERTD& vC, const VERTD& vP, const VERTD& vQ, double sweep, int level);
+    bool IsEllipseInside(const VERTD& vC, const VERTD& vP, const VERTD& vQ);
 
 public:
     // Bezier splines (quadratic and cubic)
@@ -329,6 +401,14 @@ private:
     // Internal functions for checking flatness of splines
     bool IsFlatQuadratic(const VERT16 v[3]);
     bool IsFlatCubic(const VERT16 v[4]);
+    void FlattenQuadratic(VERT16 v[3][3]);
+    void FlattenCubic(VERT16 v[4][4]);
+    void ClipBezier(const VERTD v[4], int degree, int level);
+
+public:
+    // Memory accounting
+    void GetMemoryReport(SGMEMREPORT *report);
+    size_t TrimMemory(size_t threshold);
 };
 
 #endif SHAPEPRI_H
@@ -0,0 +1,41 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// simd.h:
+//   Private header file that detects whether the target processor
+//   supports the SSE2 instruction set. If it does, this header defines
+//   the symbol SG_USE_SSE2 and includes the SSE2 intrinsics. A source
+//   file must include this header before renderer.h or shapepri.h,
+//   which define min/max macros that break the intrinsics headers.
+//
+//---------------------------------------------------------------------
+
+#ifndef SIMD_H
+  #define SIMD_H
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define SG_USE_SSE2
+  #include <emmintrin.h>
+#endif
+
+#endif // SIMD_H
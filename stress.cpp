@@ -0,0 +1,345 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// stress.cpp:
+//   Synthetic stress-scene generator for scaling studies. Draws
+//   deterministic, parameterized workloads -- random polygons, star
+//   polygons with many self-intersections, dense hairline plots,
+//   heavily dashed lines, walls of text, and deeply nested clipping
+//   regions -- so that the time and memory used by ShapeGen and the
+//   renderer can be measured as a function of the workload size.
+//
+//---------------------------------------------------------------------
+
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include "demo.h"
+
+namespace {
+    // Converts a floating-point pixel coordinate to 16.16 fixed point
+    inline SGCoord Fix16(float x)
+    {
+        return (SGCoord)(65536*x);
+    }
+
+    // Names of the workload types, in STRESSTYPE order
+    const char *stressname[] = {
+        "random polygon", "star polygon", "hairline plot",
+        "dashed line", "text wall", "clip stack",
+    };
+
+    // Characters used to fill a wall of text
+    const char textchars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                             "abcdefghijklmnopqrstuvwxyz0123456789 ";
+
+    const int TEXTWALL_COLUMNS = 64;  // characters per line of text
+}
+
+//---------------------------------------------------------------------
+//
+// StressScene constructor and destructor. Parameters width and height
+// are the dimensions of the scene, in pixels. Parameter seed is the
+// initial seed for the pseudo-random number generator.
+//
+//---------------------------------------------------------------------
+
+StressScene::StressScene(int width, int height, unsigned seed) :
+            _width(width), _height(height), _seed(seed), _state(seed)
+{
+    _txt = new TextApp;
+    assert(_txt != 0);
+}
+
+StressScene::~StressScene()
+{
+    delete _txt;
+}
+
+// Private function: Returns the next value from a 32-bit linear
+// congruential generator. The low-order 8 bits, which have the
+// shortest periods, are discarded.
+unsigned StressScene::Random()
+{
+    _state = 1664525*_state + 1013904223;
+    return _state >> 8;
+}
+
+// Private function: Returns a pseudo-random value in the range lo to hi
+float StressScene::RandomFloat(float lo, float hi)
+{
+    return lo + (hi - lo)*(Random() & 0xffff)/65535.0f;
+}
+
+// Private function: Returns a pseudo-random, partially transparent color
+COLOR StressScene::RandomColor()
+{
+    COLOR color = Random();
+
+    return RGBA(color, color >> 8, color >> 16, 192);
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Returns the name of the specified workload type
+//
+//---------------------------------------------------------------------
+
+const char* StressScene::GetName(STRESSTYPE type)
+{
+    if (type < 0 || type >= STRESS_TYPE_COUNT)
+    {
+        assert(type >= 0 && type < STRESS_TYPE_COUNT);
+        return "unknown";
+    }
+    return stressname[type];
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Draws a workload of the specified type and size.
+// The pseudo-random number generator is reseeded before each call, so
+// that the same seed, type, and size always produce the same scene.
+// The caller's ShapeGen attributes are restored before the function
+// returns. The return value is the actual workload size, which can
+// differ slightly from parameter n if the workload type can't be
+// sized exactly (for example, the number of self-intersections in a
+// star polygon), or is zero if parameter n is out of range.
+//
+//---------------------------------------------------------------------
+
+int StressScene::Draw(ShapeGen *sg, EnhancedRenderer *aarend, STRESSTYPE type, int n)
+{
+    if (n < 1)
+    {
+        assert(n >= 1);
+        return 0;  // bad parameter
+    }
+
+    int nbits = sg->SetFixedBits(16);
+    float linewidth = sg->SetLineWidth();
+    int size = 0;
+
+    _state = _seed;
+    switch (type)
+    {
+    case STRESS_RANDOM_POLYGON:
+        size = DrawRandomPolygon(sg, aarend, n);
+        break;
+    case STRESS_STAR_POLYGON:
+        size = DrawStarPolygon(sg, aarend, n);
+        break;
+    case STRESS_HAIRLINE_PLOT:
+        size = DrawHairlinePlot(sg, aarend, n);
+        break;
+    case STRESS_DASHED_LINE:
+        size = DrawDashedLine(sg, aarend, n);
+        break;
+    case STRESS_TEXT_WALL:
+        size = DrawTextWall(sg, aarend, n);
+        break;
+    case STRESS_CLIP_STACK:
+        size = DrawClipStack(sg, aarend, n);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+    sg->SetFixedBits(nbits);  // restore caller's original settings
+    sg->SetLineWidth(linewidth);
+    return size;
+}
+
+// Private function: Fills a polygon with n vertices at random locations
+// in the scene. The number of edge intersections grows as n squared.
+int StressScene::DrawRandomPolygon(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    aarend->SetColor(RandomColor());
+    sg->BeginPath();
+    for (int i = 0; i < n; ++i)
+    {
+        SGCoord x = Fix16(RandomFloat(0.05f*_width, 0.95f*_width));
+        SGCoord y = Fix16(RandomFloat(0.05f*_height, 0.95f*_height));
+
+        if (i == 0)
+            sg->Move(x, y);
+        else
+            sg->Line(x, y);
+    }
+    sg->CloseFigure();
+    sg->FillPath();
+    return n;
+}
+
+// Private function: Fills a star polygon {v/m} whose v = 2m+1 vertices
+// are connected by edges that skip m vertices at a time. The edges of
+// this star polygon cross each other at v*(m-1) points. The function
+// chooses the m value that most closely produces n self-intersections.
+int StressScene::DrawStarPolygon(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    int m = (int)(sqrt(n/2.0) + 1.5);
+    int v = 2*m + 1;
+    float r = 0.45f*min(_width, _height);
+    float xc = _width/2.0f + RandomFloat(-0.02f, 0.02f)*_width;
+    float yc = _height/2.0f + RandomFloat(-0.02f, 0.02f)*_height;
+    float phase = RandomFloat(0, 2*PI);
+
+    aarend->SetColor(RandomColor());
+    sg->BeginPath();
+    for (int i = 0; i < v; ++i)
+    {
+        float angle = phase + 2*PI*((i*m) % v)/v;
+        SGCoord x = Fix16(xc + r*cos(angle));
+        SGCoord y = Fix16(yc + r*sin(angle));
+
+        if (i == 0)
+            sg->Move(x, y);
+        else
+            sg->Line(x, y);
+    }
+    sg->CloseFigure();
+    sg->FillPath();
+    return v*(m - 1);
+}
+
+// Private function: Strokes a plot of n data points with a hairline
+// (zero-width) line. The x coordinates are evenly spaced across the
+// scene, and the y coordinates follow a random walk.
+int StressScene::DrawHairlinePlot(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    float dx = 0.96f*_width/max(n - 1, 1);
+    float ylo = 0.05f*_height, yhi = 0.95f*_height;
+    float y = _height/2.0f;
+
+    aarend->SetColor(RandomColor());
+    sg->SetLineWidth(0);
+    sg->BeginPath();
+    sg->Move(Fix16(0.02f*_width), Fix16(y));
+    for (int i = 1; i < n; ++i)
+    {
+        y += RandomFloat(-0.05f, 0.05f)*_height;
+        y = min(max(y, ylo), yhi);
+        sg->Line(Fix16(0.02f*_width + i*dx), Fix16(y));
+    }
+    sg->EndFigure();
+    sg->StrokePath();
+    return n;
+}
+
+// Private function: Strokes a zigzag line with a dash pattern that is
+// scaled so that the line contains n dashes
+int StressScene::DrawDashedLine(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    const int NSEGS = 16;
+    const char dash[] = { 1, 1, 0 };  // equal dashes and gaps
+    float dx = 0.9f*_width/NSEGS;
+    float length = 0;
+    SGPoint xy[NSEGS + 1];
+
+    for (int i = 0; i <= NSEGS; ++i)
+    {
+        float x = 0.05f*_width + i*dx;
+        float y = RandomFloat(0.05f*_height, 0.95f*_height);
+
+        xy[i].x = Fix16(x);
+        xy[i].y = Fix16(y);
+        if (i != 0)
+        {
+            float ddy = (xy[i].y - xy[i-1].y)/65536.0f;
+
+            length += sqrt(dx*dx + ddy*ddy);
+        }
+    }
+    aarend->SetColor(RandomColor());
+    sg->SetLineWidth(2.0f);
+    sg->SetLineDash(dash, 0, length/(2*n));
+    sg->BeginPath();
+    sg->Move(xy[0].x, xy[0].y);
+    sg->PolyLine(&xy[1], NSEGS);
+    sg->StrokePath();
+    sg->SetLineDash(0);  // restore solid lines
+    return n;
+}
+
+// Private function: Draws a wall of text that contains n characters of
+// random text, arranged in lines of TEXTWALL_COLUMNS characters. The
+// text is scaled so that the wall fills the scene.
+int StressScene::DrawTextWall(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    const int nchars = ARRAY_LEN(textchars) - 1;
+    int nrows = (n + TEXTWALL_COLUMNS - 1)/TEXTWALL_COLUMNS;
+    char str[TEXTWALL_COLUMNS + 1];
+    float scale, rowheight = (float)_height/nrows;
+    SGPoint xystart;
+
+    memset(str, 'W', TEXTWALL_COLUMNS);
+    str[TEXTWALL_COLUMNS] = '\0';
+    scale = _width/_txt->GetTextWidth(1.0f, str);
+    aarend->SetColor(RandomColor());
+    sg->SetLineWidth(max(0.1f*rowheight, 1.0f));
+    for (int row = 0; row < nrows; ++row)
+    {
+        int len = min(n - row*TEXTWALL_COLUMNS, TEXTWALL_COLUMNS);
+
+        for (int i = 0; i < len; ++i)
+            str[i] = textchars[Random() % nchars];
+
+        str[len] = '\0';
+        xystart.x = 0;
+        xystart.y = (SGCoord)((row + 0.8f)*rowheight);
+        _txt->DisplayText(sg, xystart, min(scale, rowheight/120), str);
+    }
+    return n;
+}
+
+// Private function: Sets n nested, elliptical clipping regions, each
+// of which is slightly smaller than the last, and fills the innermost
+// region
+int StressScene::DrawClipStack(ShapeGen *sg, EnhancedRenderer *aarend, int n)
+{
+    float rmax = 0.48f*min(_width, _height);
+    float rmin = 0.1f*min(_width, _height);
+
+    for (int i = 0; i < n; ++i)
+    {
+        float r = rmax - (rmax - rmin)*i/n;
+        float xc = _width/2.0f + RandomFloat(-0.02f, 0.02f)*rmax;
+        float yc = _height/2.0f + RandomFloat(-0.02f, 0.02f)*rmax;
+        SGPoint v0 = { Fix16(xc), Fix16(yc) };
+        SGPoint v1 = { Fix16(xc + r), Fix16(yc) };
+        SGPoint v2 = { Fix16(xc), Fix16(yc + RandomFloat(0.8f, 1.0f)*r) };
+
+        sg->BeginPath();
+        sg->Ellipse(v0, v1, v2);
+        sg->SetClipRegion();
+    }
+
+    SGRect rect = { 0, 0, Fix16(_width), Fix16(_height) };
+
+    aarend->SetColor(RandomColor());
+    sg->BeginPath();
+    sg->Rectangle(rect);
+    sg->FillPath();
+    sg->ResetClipRegion();
+    return n;
+}
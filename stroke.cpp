@@ -58,6 +58,97 @@ namespace {
         val *= sqrt(1.0 - x);
         return (negate) ? PI - val : val;
     }
+#endif
+#ifdef SGFIXEDPOINT
+    //-----------------------------------------------------------------
+    //
+    // Fixed-point version of the arccosine approximation above. Input
+    // range is -1 <= x <= 1, and the output range is 0 <= angle <= pi,
+    // where both the input and output are 16.16 fixed-point values.
+    //
+    //-----------------------------------------------------------------
+    FIX16 FixedAcos(FIX16 x)
+    {
+        const FIX16 a0 = 102939;  // 1.5707288 in 16.16 format
+        const FIX16 a1 = -13901;  // -0.2121144
+        const FIX16 a2 =   4867;  // 0.0742610
+        const FIX16 a3 =  -1227;  // -0.0187293
+        long long val = a3;
+        bool negate = x < 0;
+
+        if (negate)
+            x = -x;
+
+        val = ((val*x) >> 16) + a2;
+        val = ((val*x) >> 16) + a1;
+        val = ((val*x) >> 16) + a0;
+        val = (val*FixedSqrt((long long)(0x00010000 - x) << 16)) >> 16;
+        return (negate) ? FIX_PI - (FIX16)val : (FIX16)val;
+    }
+
+    // A RATIO value is a ratio of two fixed-point values, or is a
+    // component of a unit vector (type XY), in 16.16 fixed-point format
+    typedef FIX16 RATIO;
+
+    // Returns the ratio numer/denom, which is clamped to the FIX16 range
+    RATIO Ratio(long long numer, long long denom)
+    {
+        long long t = (numer << 16)/denom;
+
+        return (FIX16)min(max(t, -0x7fffffffLL), 0x7fffffffLL);
+    }
+
+    // Multiplies a fixed-point value by a ratio
+    inline FIX16 Scale(RATIO t, FIX16 x)
+    {
+        return ((long long)t*x) >> 16;
+    }
+
+    // Adds the product of a ratio and a fixed-point value to v
+    inline void AddScaled(FIX16& v, RATIO t, FIX16 x)
+    {
+        v += ((long long)t*x) >> 16;
+    }
+
+    // Returns dot product u.v of two vectors, divided by 65536
+    inline FIX16 DotProduct(const VERT16& u, const VERT16& v)
+    {
+        return ((long long)u.x*v.x + (long long)u.y*v.y)/65536;
+    }
+
+    // Returns cross product u x v of two vectors, divided by 65536
+    inline FIX16 CrossProduct(const VERT16& u, const VERT16& v)
+    {
+        return ((long long)u.x*v.y - (long long)u.y*v.x)/65536;
+    }
+#else
+    // Ratio of two fixed-point values, or a unit-vector component
+    typedef float RATIO;
+
+    inline RATIO Ratio(float numer, float denom)
+    {
+        return numer/denom;
+    }
+
+    inline FIX16 Scale(RATIO t, FIX16 x)
+    {
+        return t*x;
+    }
+
+    inline void AddScaled(FIX16& v, RATIO t, FIX16 x)
+    {
+        v += t*x;
+    }
+
+    inline FIX16 DotProduct(const VERT16& u, const VERT16& v)
+    {
+        return ((float)u.x*v.x + (float)u.y*v.y)/65536;
+    }
+
+    inline FIX16 CrossProduct(const VERT16& u, const VERT16& v)
+    {
+        return ((float)u.x*v.y - (float)u.y*v.x)/65536;
+    }
 #endif
     //-----------------------------------------------------------------
     //
@@ -70,6 +161,13 @@ namespace {
     //-----------------------------------------------------------------
     FIX16 GetAngle(const XY& u, const XY& v)
     {
+#ifdef SGFIXEDPOINT
+        long long cosine = ((long long)u.x*v.x + (long long)u.y*v.y) >> 16;
+        if (cosine > 0x00010000 || cosine < -0x00010000)
+            return FIX_PI;
+
+        return FixedAcos((FIX16)cosine);
+#else
         float cosine = u.x*v.x + u.y*v.y;
         if (fabs(cosine) > 1.0f)
             return FIX_PI;
@@ -78,6 +176,7 @@ namespace {
         FIX16 angle = 65536*theta;
 
         return angle;
+#endif
     }
 
     //-----------------------------------------------------------------
@@ -209,7 +308,13 @@ float PathMgr::SetMiterLimit(float mlim)
 
     mlim = max(mlim, MITERLIMIT_MINIMUM);
     _miterlimit = mlim;
+#ifdef SGFIXEDPOINT
+    mlim = min(mlim, BIGVAL16);  // avoid fixed-point overflow
+    _mitercheck = 65536*sqrt(mlim*mlim - 1);
+    _miterfix = 65536*mlim;
+#else
     _mitercheck = sqrt(mlim*mlim - 1);
+#endif
     return oldmlim;
 }
 
@@ -329,6 +434,26 @@ bool PathMgr::InitLineDash()
 
 FIX16 PathMgr::LineLength(const VERT16& vs, const VERT16& ve, XY *u, VERT16 *a)
 {
+#ifdef SGFIXEDPOINT
+    long long dx = (long long)ve.x - vs.x;
+    long long dy = (long long)ve.y - vs.y;
+    int shift = (max(llabs(dx), llabs(dy)) >> 31) ? 1 : 0;  // avoid overflow
+    long long len = (long long)FixedSqrt((dx >> shift)*(dx >> shift) +
+                                         (dy >> shift)*(dy >> shift)) << shift;
+
+    if (len == 0)
+    {
+        u->x = u->y = 0;
+        a->x = a->y = 0;
+        return 0;
+    }
+    u->x = 65536*dx/len;
+    u->y = 65536*dy/len;
+    a->x = dx*(_linewidth/2)/len;
+    a->y = dy*(_linewidth/2)/len;
+    FIX16 length = len;
+    return length;
+#else
     float dx = ve.x - vs.x;
     float dy = ve.y - vs.y;
     float len = sqrt(dx*dx + dy*dy);
@@ -345,6 +470,7 @@ FIX16 PathMgr::LineLength(const VERT16& vs, const VERT16& ve, XY *u, VERT16 *a)
     a->y = u->y*_linewidth/2;
     FIX16 length = len;
     return length;
+#endif
 }
 
 //---------------------------------------------------------------------
@@ -376,8 +502,8 @@ void PathMgr::DashedLine(const VERT16& ve, const XY& u, const VERT16& a, FIX16 l
 
         // Calculate displacement to start of next dash or gap
         linelen -= _dashlen;
-        dx = linelen*u.x;
-        dy = linelen*u.y;
+        dx = Scale(u.x, linelen);
+        dy = Scale(u.y, linelen);
         if (_dashon)
         {
             // Construct a stroked dash of the specified line width
@@ -472,7 +598,7 @@ void PathMgr::DashedLine(const VERT16& ve, const XY& u, const VERT16& a, FIX16 l
 
 void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
 {
-    VERT16 *p, *q, v1, v2;
+    VERT16 v1, v2;
     int count;
 
     // Path should be properly terminated with empty figure
@@ -503,10 +629,8 @@ void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
     _cpoint->y = v0.y + v2.y;
 
     // Convert points in path to polygonal edges
-    p = q = _fpoint;
     count = _cpoint - _fpoint;
-    for (int i = 0; i < count; ++i)
-        _edge->AttachEdge(p++, ++q);
+    _edge->AttachEdges(_fpoint, count + 1, false);
 
     // Restore temp buffer on path stack to empty state
     _cpoint = 0;
@@ -525,7 +649,7 @@ void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
 
 void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
 {
-    const FIX16 dotprod = ((float)ain.x*aout.x + (float)ain.y*aout.y)/65536;
+    const FIX16 dotprod = DotProduct(ain, aout);
     VERT16 v1, v2, v3, v4;
 
     // Begin by extending normals to v0 from points v1, v2, v3, v4 on
@@ -566,7 +690,7 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
     // intersect. Connecting through v0 improves the appearance of a
     // wide dashed line when the join abuts a dash-gap transition.
 
-    const FIX16 xprod = ((float)ain.x*aout.y - (float)ain.y*aout.x)/65536;
+    const FIX16 xprod = CrossProduct(ain, aout);
     if (xprod < 0)
     {
         // Stroke turns left (CCW) at join
@@ -617,32 +741,34 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
     // This is a miter join. Determine whether the miter length
     // exceeds the current miter limit. If the denominator is
     // too small, we'll just assume the miter limit is exceeded.
-    float t, numer, denom;
+    RATIO t;
+    int numer, denom;
 
     denom = abs(ain.x + aout.x) + abs(ain.y + aout.y);
-    if (fabs(denom) > 0.00025f)
+    if (denom != 0)
     {
         numer = abs(ain.x - aout.x) + abs(ain.y - aout.y);
-        t = numer/denom;  // linear interpolation param
+        t = Ratio(numer, denom);  // linear interpolation param
         if (t <= _mitercheck)
         {
             // Miter length is within miter limit, so draw full miter
-            FIX16 dx = t*(ain.x - aout.x);
-            FIX16 dy = t*(ain.y - aout.y);
+            FIX16 dx = Scale(t, ain.x - aout.x);
+            FIX16 dy = Scale(t, ain.y - aout.y);
 
+            // Sums are 64-bit to avoid overflow far from the origin
             if (xprod < 0)
             {
                 // Stroke turns left (CCW) at join
-                v4.x = (v2.x + v4.x + dx)/2;
-                v4.y = (v2.y + v4.y + dy)/2;
+                v4.x = ((long long)v2.x + v4.x + dx)/2;
+                v4.y = ((long long)v2.y + v4.y + dy)/2;
                 _edge->AttachEdge(&_vin, &v1);
                 _edge->AttachEdge(&v4, &_vout);
             }
             else
             {
                 // Stroke turns right (CW) at join
-                v3.x = (v1.x + v3.x + dx)/2;
-                v3.y = (v1.y + v3.y + dy)/2;
+                v3.x = ((long long)v1.x + v3.x + dx)/2;
+                v3.y = ((long long)v1.y + v3.y + dy)/2;
                 _edge->AttachEdge(&_vin, &v3);
                 _edge->AttachEdge(&v2, &_vout);
             }
@@ -699,36 +825,41 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
     VERT16 am, vz = { 0, 0 };
     XY unused;
     LineLength(vz, vm, &unused, &am);
+#ifdef SGFIXEDPOINT
+    am.x = Scale(_miterfix, am.x);
+    am.y = Scale(_miterfix, am.y);
+#else
     am.x *= _miterlimit;
     am.y *= _miterlimit;
+#endif
 
     // Extend sides of stroked lines to miter limit
     denom = abs(ain.x - aout.x) + abs(ain.y - aout.y);
     if (xprod < 0)
     {
         // Stroke turns left (CCW) at join
-        if (fabs(denom) > 0.00025f)  // is denominator big enough?
+        if (denom != 0)  // is denominator big enough?
         {
             numer = abs(2*am.x + ain.y + aout.y) + abs(2*am.y - ain.x - aout.x);
-            t = numer/denom;  // linear interpolation parameter
-            v2.x += t*ain.x;
-            v2.y += t*ain.y;
-            v4.x -= t*aout.x;
-            v4.y -= t*aout.y;
+            t = Ratio(numer, denom);  // linear interpolation parameter
+            AddScaled(v2.x, t, ain.x);
+            AddScaled(v2.y, t, ain.y);
+            AddScaled(v4.x, -t, aout.x);
+            AddScaled(v4.y, -t, aout.y);
         }
         _edge->AttachEdge(&v4, &v2);
     }
     else
     {
         // Stroke turns right (CW) at join
-        if (fabs(denom) > 0.00025f)  // is denominator big enough?
+        if (denom != 0)  // is denominator big enough?
         {
             numer = abs(2*am.x - ain.y - aout.y) + abs(2*am.y + ain.x + aout.x);
-            t = numer/denom;  // linear interpolation parameter
-            v1.x += t*ain.x;
-            v1.y += t*ain.y;
-            v3.x -= t*aout.x;
-            v3.y -= t*aout.y;
+            t = Ratio(numer, denom);  // linear interpolation parameter
+            AddScaled(v1.x, t, ain.x);
+            AddScaled(v1.y, t, ain.y);
+            AddScaled(v3.x, -t, aout.x);
+            AddScaled(v3.y, -t, aout.y);
         }
         _edge->AttachEdge(&v1, &v3);
     }
@@ -36,18 +36,21 @@
 #include "demo.h"
 
 namespace {
+    // Maximum time to spend in each call to render the display list
+    const int RENDER_SLICE_MSEC = 50;
+
     //-------------------------------------------------------------------
     //
     // Prepares the paint to be used for a filled or stroked shape
     //
     //-------------------------------------------------------------------
-    void PreparePaint(NSVGpaint *paint, float scale, EnhancedRenderer *aarend)
+    void PreparePaint(NSVGpaint *paint, float scale, DisplayList *dlist)
     {
         assert(paint->type != NSVG_PAINT_NONE);
         switch (paint->type)
         {
         case NSVG_PAINT_COLOR:
-            aarend->SetColor(paint->color);
+            dlist->SetColor(paint->color);
             break;
         case NSVG_PAINT_LINEAR_GRADIENT:
         case NSVG_PAINT_RADIAL_GRADIENT:
@@ -57,10 +60,10 @@ namespace {
                 SPREAD_METHOD spread;
                 float xform[6];
 
-                aarend->ResetColorStops();
+                dlist->ResetColorStops();
                 for (int i = 0; i < grad->nstops; ++i)
                 {
-                    aarend->AddColorStop(stop->offset, stop->color);
+                    dlist->AddColorStop(stop->offset, stop->color);
                     ++stop;
                 }
                 switch (grad->spread)
@@ -79,17 +82,17 @@ namespace {
                 for (int i = 0; i < 6; ++i)
                     xform[i] = scale*grad->xform[i];
 
-                aarend->SetTransform(xform);
+                dlist->SetTransform(xform);
                 if (paint->type == NSVG_PAINT_LINEAR_GRADIENT)
-                    aarend->SetLinearGradient(0,0, 0,1, spread,
+                    dlist->SetLinearGradient(0,0, 0,1, spread,
                                               FLAG_EXTEND_START | FLAG_EXTEND_END);
                 else
-                    aarend->SetRadialGradient(grad->fx,grad->fy,grad->fr, 0,0,1, spread,
+                    dlist->SetRadialGradient(grad->fx,grad->fy,grad->fr, 0,0,1, spread,
                                               FLAG_EXTEND_START | FLAG_EXTEND_END);
             }
             break;
         default:
-            aarend->SetColor(RGBX(128,128,128));
+            dlist->SetColor(RGBX(128,128,128));
             break;
         }
     }
@@ -113,6 +116,7 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
     NSVGimage* image;
     float scale, scale16;
     UserMessage umsg;
+    DisplayList dlist(16);  // 16.16 fixed-point coordinates
 
     if (_argc_ < 2)
     {
@@ -157,13 +161,12 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
         scale = 1;  // we'll honor the viewport defined in the SVG file
 
     scale16 = 65536*scale;  // to scale 16.16 fixed-point SGCoord values
-    sg->SetFixedBits(16);
 
-    // Render the image data
+    // Record the image data in a display list
     for (NSVGshape *shape = image->shapes; shape != NULL; shape = shape->next)
     {
         // Construct the path -- push shape coordinates onto path stack
-        sg->BeginPath();
+        dlist.BeginPath();
         for (NSVGpath *path = shape->paths; path != NULL; path = path->next)
         {
             float* p = &path->pts[0];
@@ -171,7 +174,7 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
 
             // if primitive == cubic bezier, then...
             v[0].x = scale16*p[0], v[0].y = scale16*p[1];
-            sg->Move(v[0].x, v[0].y);
+            dlist.Move(v[0].x, v[0].y);
             for (int i = 0; i < path->npts-1; i += 3)
             {
                 p = &path->pts[i*2];
@@ -181,24 +184,24 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
                 v[2].y = scale16*p[5];
                 v[3].x = scale16*p[6];
                 v[3].y = scale16*p[7];
-                sg->Bezier3(v[1], v[2], v[3]);
+                dlist.Bezier3(v[1], v[2], v[3]);
             }
             if (path->closed)
-                sg->CloseFigure();
+                dlist.CloseFigure();
         }
 
         // If fill paint is specified, fill the path
         int alpha = shape->opacity*255.99;
-        aarend->SetConstantAlpha(alpha);
+        dlist.SetConstantAlpha(alpha);
         if (shape->fill.type != NSVG_PAINT_NONE)
         {
-            PreparePaint(&shape->fill, scale, &(*aarend));
+            PreparePaint(&shape->fill, scale, &dlist);
             if (shape->fillRule == NSVG_FILLRULE_EVENODD)
-                sg->SetFillRule(FILLRULE_EVENODD);
+                dlist.SetFillRule(FILLRULE_EVENODD);
             else
-                sg->SetFillRule(FILLRULE_WINDING);
+                dlist.SetFillRule(FILLRULE_WINDING);
 
-            sg->FillPath();
+            dlist.FillPath();
         }
 
         // If stroke paint is specified, stroke the path
@@ -209,7 +212,7 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
             char dashArray[8+1];
             int dashCount = shape->strokeDashCount;
 
-            sg->SetLineWidth(scale*shape->strokeWidth);
+            dlist.SetLineWidth(scale*shape->strokeWidth);
             switch (shape->strokeLineJoin)
             {
             case NSVG_JOIN_BEVEL:
@@ -224,10 +227,10 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
             case NSVG_JOIN_MITER:
             default:
                 join = LINEJOIN_SVG_MITER;
-                sg->SetMiterLimit(shape->miterLimit);
+                dlist.SetMiterLimit(shape->miterLimit);
                 break;
             }
-            sg->SetLineJoin(join);
+            dlist.SetLineJoin(join);
             switch (shape->strokeLineCap)
             {
             case NSVG_CAP_ROUND:
@@ -241,7 +244,7 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
                 cap = LINEEND_FLAT;
                 break;
             }
-            sg->SetLineEnd(cap);
+            dlist.SetLineEnd(cap);
             if (dashCount != 0)
             {
                 assert(dashCount <= 8);
@@ -249,15 +252,33 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
                     dashArray[i] = 10*shape->strokeDashArray[i];
 
                 dashArray[dashCount] = 0;
-                sg->SetLineDash(dashArray, shape->strokeDashOffset, scale/10);
+                dlist.SetLineDash(dashArray, shape->strokeDashOffset, scale/10);
             }
             else
-                sg->SetLineDash(0,0,0);
+                dlist.SetLineDash(0,0,0);
 
-            PreparePaint(&shape->stroke, scale, &(*aarend));
-            sg->StrokePath();
+            PreparePaint(&shape->stroke, scale, &dlist);
+            dlist.StrokePath();
         }
     }
+
+    // SVG drawings often paint opaque background rectangles over
+    // earlier shapes, so skip the shapes that can't be seen
+    dlist.CullHiddenShapes();
+
+    // Render the display list in a series of time slices. Between
+    // slices, an interactive application could respond to user input
+    // and abandon the rest of the scene if it's no longer needed. No
+    // preview is drawn, because this function returns only after the
+    // frame is finished, so a preview would never be presented.
+    CancelToken token;
+    int next = 0;
+    do
+    {
+        token.SetDeadline(RENDER_SLICE_MSEC);
+        next = dlist.Render(&(*sg), &(*aarend), next, &token);
+    } while (next < dlist.GetCount());
+
     // Delete
     nsvgDelete(image);
     return testnum;
@@ -1969,40 +1969,29 @@ void TextApp::DrawGlyph(ShapeGen *sg, char *displist, SGPoint xy[])
 
 //---------------------------------------------------------------------
 //
-// Public function: Draws the glyphs for the specified character
-// string (pointed to by parameter str). Parameter sg is a pointer to
-// a ShapeGen object. Parameter xform is the 6-element affine trans-
-// formation matrix to apply to the glyphs before they are displayed,
-// and is defined as in the SVG standard. Elements xform[4] and
-// xform[5] specify the x and y coordinates at which to start drawing
-// the string on the display; the starting point is located at the
-// intersection of the baseline with the left edge of the displayed
-// string. The other four xform elements specify the scaling,
-// rotation, etc., to apply to the glyphs. Glyphs are drawn with the
-// current stroke width.
+// Private function: Adds the glyphs for the specified character string
+// (pointed to by parameter str) to the current path. Parameter xform
+// is the transformation matrix, as described for the DisplayText
+// function. The caller is responsible for beginning and stroking the
+// path, and for setting up the ShapeGen object's fixed-point format
+// (16 fractional bits), line ends, and line joins.
 //
 //---------------------------------------------------------------------
 
-void TextApp::DisplayText(ShapeGen *sg, const float xform[], const char *str)
+void TextApp::AddTextToPath(ShapeGen *sg, const float xform[], const char *str)
 {
     const int MAXLEN = 256;
-    int nbits = sg->SetFixedBits(16);
-    LINEEND saveLineEnd = sg->SetLineEnd(LINEEND_ROUND);
-    LINEJOIN saveLineJoin = sg->SetLineJoin(LINEJOIN_ROUND);
     int len = strnlen(str, MAXLEN);
     float lbear = _xspace*leftbearing;
     float rbear = _xspace*rightbearing;
     float advance;
     XY pos;
 
-    _width = sg->SetLineWidth(0);
-    sg->SetLineWidth(_width);
     assert(len < MAXLEN);
     pos.x = xform[0]*lbear + xform[4];
     pos.y = xform[1]*lbear + xform[5];
 
     // Each iteration of this for-loop draws one character
-    sg->BeginPath();
     for (int i = 0; i < len; ++i)
     {
         int cc = str[i];
@@ -2040,6 +2029,34 @@ void TextApp::DisplayText(ShapeGen *sg, const float xform[], const char *str)
         pos.x += xform[0]*advance;
         pos.y += xform[1]*advance;
     }
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Draws the glyphs for the specified character
+// string (pointed to by parameter str). Parameter sg is a pointer to
+// a ShapeGen object. Parameter xform is the 6-element affine trans-
+// formation matrix to apply to the glyphs before they are displayed,
+// and is defined as in the SVG standard. Elements xform[4] and
+// xform[5] specify the x and y coordinates at which to start drawing
+// the string on the display; the starting point is located at the
+// intersection of the baseline with the left edge of the displayed
+// string. The other four xform elements specify the scaling,
+// rotation, etc., to apply to the glyphs. Glyphs are drawn with the
+// current stroke width.
+//
+//---------------------------------------------------------------------
+
+void TextApp::DisplayText(ShapeGen *sg, const float xform[], const char *str)
+{
+    int nbits = sg->SetFixedBits(16);
+    LINEEND saveLineEnd = sg->SetLineEnd(LINEEND_ROUND);
+    LINEJOIN saveLineJoin = sg->SetLineJoin(LINEJOIN_ROUND);
+
+    _width = sg->SetLineWidth(0);
+    sg->SetLineWidth(_width);
+    sg->BeginPath();
+    AddTextToPath(sg, xform, str);
     sg->StrokePath();
     sg->SetFixedBits(nbits);  // restore caller's original settings
     sg->SetLineEnd(saveLineEnd);
@@ -2069,6 +2086,65 @@ void TextApp::DisplayText(ShapeGen *sg, SGPoint xystart, float scale, const char
     DisplayText(sg, xform, str);
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Draws a batch of text strings that share the same
+// transformation and stroke width. Array item contains count elements,
+// each of which specifies a text string and the x-y coordinates at
+// which to start drawing the string. Parameter xform is defined as in
+// the single-string version of DisplayText, except that each string's
+// starting point is offset from (xform[4],xform[5]) by the item's
+// xystart coordinates. The result is identical to that of drawing
+// the strings one at a time.
+//
+//---------------------------------------------------------------------
+
+void TextApp::DisplayText(ShapeGen *sg, const float xform[], const TEXTITEM item[], int count)
+{
+    int nbits = sg->SetFixedBits(16);
+    LINEEND saveLineEnd = sg->SetLineEnd(LINEEND_ROUND);
+    LINEJOIN saveLineJoin = sg->SetLineJoin(LINEJOIN_ROUND);
+    float xfitem[6];
+
+    _width = sg->SetLineWidth(0);
+    sg->SetLineWidth(_width);
+    for (int i = 0; i < 4; ++i)
+        xfitem[i] = xform[i];
+
+    for (int i = 0; i < count; ++i)
+    {
+        xfitem[4] = xform[4] + item[i].xystart.x;
+        xfitem[5] = xform[5] + item[i].xystart.y;
+        sg->BeginPath();
+        AddTextToPath(sg, xfitem, item[i].str);
+        sg->StrokePath();
+    }
+    sg->SetFixedBits(nbits);  // restore caller's original settings
+    sg->SetLineEnd(saveLineEnd);
+    sg->SetLineJoin(saveLineJoin);
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Draws a batch of horizontal text strings. This
+// version of the function supports scaling (by the scale parameter
+// value), and draws each string at the item's xystart coordinates.
+//
+//---------------------------------------------------------------------
+
+void TextApp::DisplayText(ShapeGen *sg, float scale, const TEXTITEM item[], int count)
+{
+    float xform[6];
+
+    xform[0] = scale;
+    xform[1] = 0;
+    xform[2] = 0;
+    xform[3] = scale;
+    xform[4] = 0;
+    xform[5] = 0;
+    DisplayText(sg, xform, item, count);
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Calculates what the x-y coordinates would be at
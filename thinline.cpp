@@ -72,6 +72,10 @@ namespace {
     const VERT16 offset[] = {
         { 0, -FIX_HALF }, { FIX_HALF, 0 }, { 0, FIX_HALF }, { -FIX_HALF, 0 }, { 0, 0 }
     };
+
+    // Max number of points in each of the two offset polylines that
+    // ThinStroke passes to AttachEdges in a single call
+    const int THIN_RUN_LEN = 64;
 }
 
 //----------------------------------------------------------------------
@@ -173,7 +177,17 @@ bool PathMgr::ThinStroke()
             vs = ve++;
         }
 
-        // Each for-loop iteration constructs one line segment
+        // Each for-loop iteration constructs one line segment. The
+        // stroked edges are offset 1/2 pixel from the line segment.
+        // Successive segments in the same quadrant have the same
+        // offsets, so their stroked edges join end to end to form two
+        // polylines: one that runs forward on the left side (array
+        // lpts), and one that runs backward on the right (rpts, which
+        // is filled from the end). Each polyline is passed to the
+        // edge manager when the quadrant changes or the array fills.
+        VERT16 lpts[THIN_RUN_LEN], rpts[THIN_RUN_LEN];
+        int npts = 0, runquad = -1;
+
         for (int i = 0; i < nlines; ++i)
         {
             dx = ve->x - vs->x;
@@ -181,19 +195,26 @@ bool PathMgr::ThinStroke()
             assert((dx | dy) != 0);
             int quad = getquadrant(dx, dy);
             VERT16 dir = offset[quad];
-            VERT16 xy[4];
-
-            // Offset stroked edges 1/2 pixel from line segment
-            xy[0].x = vs->x + dir.x;
-            xy[0].y = vs->y + dir.y;
-            xy[1].x = xy[0].x + dx;
-            xy[1].y = xy[0].y + dy;
-            xy[2].x = ve->x - dir.x;
-            xy[2].y = ve->y - dir.y;
-            xy[3].x = xy[2].x - dx;
-            xy[3].y = xy[2].y - dy;
-            _edge->AttachEdge(&xy[0], &xy[1]);
-            _edge->AttachEdge(&xy[2], &xy[3]);
+
+            if (quad != runquad || npts == THIN_RUN_LEN)
+            {
+                if (npts > 1)
+                {
+                    _edge->AttachEdges(lpts, npts, false);
+                    _edge->AttachEdges(&rpts[THIN_RUN_LEN - npts], npts, false);
+                }
+                lpts[0].x = vs->x + dir.x;
+                lpts[0].y = vs->y + dir.y;
+                rpts[THIN_RUN_LEN-1].x = vs->x - dir.x;
+                rpts[THIN_RUN_LEN-1].y = vs->y - dir.y;
+                npts = 1;
+                runquad = quad;
+            }
+            lpts[npts].x = ve->x + dir.x;
+            lpts[npts].y = ve->y + dir.y;
+            rpts[THIN_RUN_LEN-1 - npts].x = ve->x - dir.x;
+            rpts[THIN_RUN_LEN-1 - npts].y = ve->y - dir.y;
+            ++npts;
 
             if (quad != prevquad)
             {
@@ -203,6 +224,11 @@ bool PathMgr::ThinStroke()
             }
             vs = ve++;
         }
+        if (npts > 1)
+        {
+            _edge->AttachEdges(lpts, npts, false);
+            _edge->AttachEdges(&rpts[THIN_RUN_LEN - npts], npts, false);
+        }
         if (fig->isclosed == false)
             JoinThinLines(vs, prevquad, 4);  // "4" means "cap this line end"
     }
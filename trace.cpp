@@ -0,0 +1,181 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// trace.cpp:
+//   Optional tracing layer that records timed events and writes them
+//   to a file in the Chrome trace-event JSON format. Tracing is enabled
+//   only if this file and the traced modules are compiled with the
+//   symbol SGTRACE defined. The tracing code requires C++11 support
+//   for atomics, thread-local storage, and a steady clock.
+//
+//   Each thread that records events gets its own ring buffer, which
+//   only that thread writes to, so recording an event needs no locks.
+//   When a ring buffer fills up, new events overwrite the oldest ones.
+//   The ring buffers are kept in a linked list that new threads add
+//   their buffers to with an atomic compare-and-swap. The buffers are
+//   never freed, so the events recorded by a thread remain available
+//   after the thread exits.
+//
+//---------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+
+#ifdef SGTRACE
+
+#include <atomic>
+#include <chrono>
+
+namespace {
+    // Number of events in each per-thread ring buffer (power of 2)
+    const unsigned TRACE_RING_LEN = 1 << 16;
+
+    struct TRACE_EVENT {
+        const char *name;  // name of traced operation
+        long long start;   // start time, in microseconds
+        long long dur;     // duration, in microseconds
+    };
+
+    struct TRACE_RING {
+        TRACE_RING *next;             // next ring buffer in list
+        int tid;                      // thread id used in trace file
+        std::atomic<unsigned> count;  // total events recorded by thread
+        TRACE_EVENT event[TRACE_RING_LEN];
+    };
+
+    std::atomic<TRACE_RING*> _ringlist(0);  // list of all ring buffers
+    std::atomic<int> _nexttid(1);           // next thread id to assign
+    const std::chrono::steady_clock::time_point _epoch = std::chrono::steady_clock::now();
+
+    // Called at program exit to write the trace file
+    void WriteTraceAtExit()
+    {
+        const char *filename = getenv("SGTRACE_FILE");
+
+        WriteTraceFile((filename != 0) ? filename : "sgtrace.json");
+    }
+
+    // Returns the time, in microseconds, since the program started
+    long long GetTraceTime()
+    {
+        std::chrono::steady_clock::duration t = std::chrono::steady_clock::now() - _epoch;
+
+        return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+    }
+
+    // Returns the calling thread's ring buffer, which is created on
+    // the thread's first call to this function
+    TRACE_RING* GetTraceRing()
+    {
+        static thread_local TRACE_RING *ring = 0;
+
+        if (ring == 0)
+        {
+            static bool batexit = (atexit(WriteTraceAtExit) == 0);
+
+            ring = new TRACE_RING;
+            ring->tid = _nexttid++;
+            ring->count = 0;
+            ring->next = _ringlist.load();
+            while (_ringlist.compare_exchange_weak(ring->next, ring) == false)
+                ;
+        }
+        return ring;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// TraceScope implementation
+//
+//---------------------------------------------------------------------
+
+TraceScope::TraceScope(const char *name) : _name(name)
+{
+    _start = GetTraceTime();
+}
+
+// Records the completed event in the calling thread's ring buffer. The
+// release store to the ring's event count ensures that WriteTraceFile
+// sees the event's contents if it sees the updated count.
+TraceScope::~TraceScope()
+{
+    TRACE_RING *ring = GetTraceRing();
+    unsigned count = ring->count.load(std::memory_order_relaxed);
+    TRACE_EVENT& ev = ring->event[count & (TRACE_RING_LEN - 1)];
+
+    ev.name = _name;
+    ev.start = _start;
+    ev.dur = GetTraceTime() - _start;
+    ring->count.store(count + 1, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Writes the events in all the ring buffers to a
+// JSON file in the Chrome trace-event format. Each event is written as
+// a complete ("X") event with a start time and duration. The trace
+// also names each thread so that the trace viewer labels its track.
+//
+//---------------------------------------------------------------------
+
+bool WriteTraceFile(const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+
+    if (fp == 0)
+        return false;  // can't open file
+
+    const char *sep = "";
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (TRACE_RING *ring = _ringlist.load(); ring != 0; ring = ring->next)
+    {
+        unsigned count = ring->count.load(std::memory_order_acquire);
+        unsigned first = (count > TRACE_RING_LEN) ? count - TRACE_RING_LEN : 0;
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"thread %d\"}}", sep, ring->tid, ring->tid);
+        sep = ",\n";
+        for (unsigned i = first; i != count; ++i)
+        {
+            const TRACE_EVENT& ev = ring->event[i & (TRACE_RING_LEN - 1)];
+
+            fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"shapegen\",\"ph\":\"X\","
+                    "\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}",
+                    sep, ev.name, ring->tid, ev.start, ev.dur);
+        }
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return (fclose(fp) == 0);
+}
+
+#else
+
+bool WriteTraceFile(const char *filename)
+{
+    return false;  // tracing is disabled
+}
+
+#endif  // SGTRACE
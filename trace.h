@@ -0,0 +1,78 @@
+/*
+  Copyright (C) 2024 Jerry R. VanAken
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+
+  3. This notice may not be removed or altered from any source distribution.
+*/
+//---------------------------------------------------------------------
+//
+// trace.h:
+//   Header file for the optional tracing layer. When the code is
+//   compiled with the symbol SGTRACE defined (for example, g++ -DSGTRACE
+//   or cl -DSGTRACE), the TRACE_SCOPE macro records the start time and
+//   duration of each traced operation, together with the id of the
+//   calling thread. The events are later written to a JSON file in the
+//   Chrome trace-event format, which can be loaded into a trace viewer
+//   such as chrome://tracing or ui.perfetto.dev. When SGTRACE is not
+//   defined, TRACE_SCOPE expands to nothing and tracing costs nothing.
+//
+//---------------------------------------------------------------------
+
+#ifndef TRACE_H
+  #define TRACE_H
+
+#ifdef SGTRACE
+
+//---------------------------------------------------------------------
+//
+// A TraceScope object records one trace event that starts when the
+// object is constructed and ends when the object is destroyed. The
+// 'name' string must be a literal (or otherwise remain valid until
+// the trace is written), because only the pointer is recorded.
+//
+//---------------------------------------------------------------------
+
+class TraceScope
+{
+    const char *_name;
+    long long _start;  // start time, in microseconds
+
+public:
+    TraceScope(const char *name);
+    ~TraceScope();
+};
+
+#define TRACE_CONCAT2(a,b)  a##b
+#define TRACE_CONCAT(a,b)   TRACE_CONCAT2(a,b)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(_tracescope,__LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name)
+
+#endif  // SGTRACE
+
+// Writes all recorded trace events to the specified JSON file. Call
+// this function while no other thread is rendering. Returns false if
+// tracing is disabled or the file cannot be written. If SGTRACE is
+// defined, the events are also written automatically at program exit
+// to the file named by environment variable SGTRACE_FILE, if set, or
+// else to the file sgtrace.json in the current directory.
+bool WriteTraceFile(const char *filename);
+
+#endif  // TRACE_H
@@ -43,6 +43,7 @@ int main(int argc, char *argv[])
     int testnum = 0;
     SGRect cliprect = { 0, 0, DEMO_WIDTH, DEMO_HEIGHT};
     bool formatsMatch = false;
+    bool swapRedBlue = false;
 
     printf("Starting SDL2 app...\n");
     _argc_ = argc;
@@ -77,6 +78,13 @@ int main(int argc, char *argv[])
                    winsurf->format->Rmask == 0x00ff0000 &&
                    winsurf->format->Gmask == 0x0000ff00 &&
                    winsurf->format->Bmask == 0x000000ff;
+    // If the two formats differ only in the order of the red and
+    // blue fields, the back buffer can be copied to the window's
+    // surface with a fast swizzle instead of a converting blit.
+    swapRedBlue = winsurf->format->BitsPerPixel == 32 &&
+                  winsurf->format->Rmask == 0x000000ff &&
+                  winsurf->format->Gmask == 0x0000ff00 &&
+                  winsurf->format->Bmask == 0x00ff0000;
     // Begin main loop
     for (;;)
     {
@@ -242,7 +250,20 @@ int main(int argc, char *argv[])
             {
                 // Copy back buffer to screen
                 if (!formatsMatch)
-                    SDL_BlitSurface(rgbsurf, 0, winsurf, 0);
+                {
+                    if (swapRedBlue && SDL_LockSurface(winsurf) == 0)
+                    {
+                        for (int y = 0; y < rgbsurf->h; ++y)
+                        {
+                            char *src = (char*)rgbsurf->pixels + y*rgbsurf->pitch;
+                            char *dst = (char*)winsurf->pixels + y*winsurf->pitch;
+                            SwapRedBlue((COLOR*)dst, (COLOR*)src, rgbsurf->w);
+                        }
+                        SDL_UnlockSurface(winsurf);
+                    }
+                    else
+                        SDL_BlitSurface(rgbsurf, 0, winsurf, 0);
+                }
 
                 SDL_UpdateWindowSurface(window);
 